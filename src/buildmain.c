@@ -54,11 +54,13 @@ int stepu(int, int, char *);
 int stepb(int, int, char *);
 int dc2(int, int, char *);
 int pgen16(int, int, char *);
+int pgen1k(int, int, char *);
 int pwmin4(int, int, char *);
 int quad2(int, int, char *);
 int qtr4(int, int, char *);
 int qtr8(int, int, char *);
 int roten(int, int, char *);
+int roten4(int, int, char *);
 int count4(int, int, char *);
 int ping4(int, int, char *);
 int irio(int, int, char *);
@@ -68,6 +70,8 @@ int espi(int, int, char *);
 int adc12(int, int, char *);
 int out4(int, int, char *);
 int out4l(int, int, char *);
+int out4t(int, int, char *);
+int out4lt(int, int, char *);
 int serout4(int, int, char *);
 int serout8(int, int, char *);
 int hostserial(int, int, char *);
@@ -82,7 +86,34 @@ int in32(int, int, char *);
 int ei2c(int, int, char *);
 int null(int, int, char *);
 int ws2812(int, int, char *);
+int la8(int, int, char *);
+int regseq(int, int, char *);
 void printbus(int, char *);     // bus lines common to all peripherals
+void printtrig(int);            // trigger input from an optional pin
+int  printserout(int, int, int, int); // serout4 and serout8
+int  printqtr(int, int, int);    // qtr4 and qtr8
+int  printout4(int, int, char *); // out4 and its variants
+
+// Highest numbered FPGA pin.  See PIN_xx in protomain
+#define MAXPIN   35
+
+// Trigger pin given as "peri:pin" in the perilist, -1 if none
+int   trigpin = -1;
+
+// FIFO depth given as "peri@depth" in the perilist, 0 if none
+int   fifodepth = 0;
+
+// Read-only pin taps given as "peri:pin,pin,..." in the perilist.
+// The first tap is also the trigger pin.
+#define MAXTAP   4
+int   tappin[MAXTAP];
+int   ntap = 0;
+
+// Shared module the peripheral needs in the includes, (char *)0 if none
+char *sharedinc = (char *)0;
+
+// Set if the design has a register sequencer.  There can be only one.
+int   nregseq = 0;
 
 
 struct ENUMERATORS {
@@ -108,11 +139,13 @@ struct ENUMERATORS enumerators[] = {
     {"aamp", "out4", "aamp", out4 },
     {"pgen16", "pgen16", "pgen16", pgen16 },
     {"pwmout4", "pgen16", "pwmout4", pgen16 },
+    {"pgen1k", "pgen1k", "pgen1k", pgen1k },
     {"pwmin4", "pwmin4", "pwmin4", pwmin4 },
     {"quad2", "quad2", "quad2", quad2 },
-    {"qtr4", "qtr4", "qtr4", qtr4 },
-    {"qtr8", "qtr8", "qtr8", qtr8 },
+    {"qtr4", "qtr", "qtr4", qtr4 },
+    {"qtr8", "qtr", "qtr8", qtr8 },
     {"roten", "roten", "roten", roten },
+    {"roten4", "roten4", "roten4", roten4 },
     {"count4", "count4", "count4", count4 },
     {"touch4", "count4", "touch4", count4 },
     {"ping4", "ping4", "ping4", ping4 },
@@ -125,12 +158,14 @@ struct ENUMERATORS enumerators[] = {
     {"adc812", "adc12", "adc812", adc12 },
     {"slide4", "adc12", "slide4", adc12 },
     {"out4", "out4", "out4", out4 },
-    {"out4l", "out4l", "out4l", out4l },
+    {"out4l", "out4", "out4l", out4l },
+    {"out4t", "out4", "out4t", out4t },
+    {"out4lt", "out4", "out4lt", out4lt },
     {"serout4", "serout", "serout4", serout4 },
     {"serout8", "serout", "serout8", serout8 },
     {"hostserial", "hostserial", "hostserial", hostserial },
     {"ws2812", "ws2812", "ws2812", ws2812 },
-    {"rly4", "out4l", "rly4", out4l },
+    {"rly4", "out4", "rly4", out4l },
     {"drv4", "out4", "drv3", out4 },
     {"hub4", "out4", "hub4", out4 },
     {"gpio4", "gpio4", "gpio4", gpio4 },
@@ -145,6 +180,8 @@ struct ENUMERATORS enumerators[] = {
     {"ei2c", "ei2c", "ei2c", ei2c },
     {"rcrx", "rcrx", "rcrx", rcrx },
     {"rfob", "rfob", "rfob", rfob },
+    {"la8", "la8", "la8", la8 },
+    {"regseq", "regseq", "regseq", regseq },
     {"null", "null", "null", null },
 };
 
@@ -165,6 +202,8 @@ int main(int argc, char *argv[])
     int   romindx = 0;      // How many bytes of rom are used
     int   lnlen,j;          // Library Name LENgth, char index into lib name
     char  romstr[ROMSTRLN]; // string to be copied to the enumerator ROM
+    char *popt;             // Pointer to the ':pin' option in a peripheral name
+    char *pdepth;           // Pointer to the '@depth' option in a peripheral name
 
 
     if (argc != 2) {
@@ -221,6 +260,15 @@ int main(int argc, char *argv[])
         if (ret == EOF) {   // no more peripherals to process
             fclose(pdescfile);
             fclose(pincludes);
+            // Without a sequencer the bus interface is the only bus master
+            if (nregseq == 0) {
+                fprintf(stdout, "\n    // No register sequencer\n");
+                fprintf(stdout, "    assign sq0req = 1'b0;\n");
+                fprintf(stdout, "    assign sq0addr = 12'h000;\n");
+                fprintf(stdout, "    assign sq0datout = 8'h00;\n");
+                fprintf(stdout, "    assign sq0rdwr = 1'b0;\n");
+                fprintf(stdout, "    assign sq0strobe = 1'b0;\n");
+            }
             fprintf(stdout, "\nendmodule\n");
             break;
         }
@@ -233,6 +281,48 @@ int main(int argc, char *argv[])
         if (peri[0] == '#')
             continue;
 
+        // An optional ":pin" after the name is the trigger input pin
+        // and an optional "@depth" is the FIFO depth.
+        trigpin = -1;
+        fifodepth = 0;
+        ntap = 0;
+        sharedinc = (char *)0;
+        popt = strchr(peri, ':');
+        pdepth = strchr(peri, '@');
+        if (pdepth != (char *)0) {
+            fifodepth = atoi(pdepth + 1);
+            *pdepth = (char) 0;
+            if (fifodepth <= 0) {
+                fprintf(stderr, "FATAL: %s: Bad FIFO depth for %s\n",
+                        argv[0], peri);
+                exit(1);
+            }
+        }
+        if (popt != (char *)0) {
+            *popt = (char) 0;
+            trigpin = atoi(popt + 1);
+            if ((trigpin < 0) || (trigpin > MAXPIN)) {
+                fprintf(stderr, "FATAL: %s: Bad trigger pin for %s\n",
+                        argv[0], peri);
+                exit(1);
+            }
+            while (popt != (char *)0) {
+                if (ntap == MAXTAP) {
+                    fprintf(stderr, "FATAL: %s: Too many pin taps for %s\n",
+                            argv[0], peri);
+                    exit(1);
+                }
+                tappin[ntap] = atoi(popt + 1);
+                if ((tappin[ntap] < 0) || (tappin[ntap] > MAXPIN)) {
+                    fprintf(stderr, "FATAL: %s: Bad tap pin for %s\n",
+                            argv[0], peri);
+                    exit(1);
+                }
+                ntap++;
+                popt = strchr(popt + 1, ',');
+            }
+        }
+
         for (i = 0; i < NPERI; i++) {
             if (0 == strncmp(peri, enumerators[i].periname, (PERILEN - 1)))
                 break;
@@ -242,11 +332,35 @@ int main(int argc, char *argv[])
                     argv[0], peri);
             exit(1);
         }
+        // Only the la8 takes a list of pin taps
+        if ((ntap > 1) && (0 != strcmp(enumerators[i].periname, "la8"))) {
+            fprintf(stderr, "FATAL: %s: Pin taps are only for the la8: %s\n",
+                    argv[0], peri);
+            exit(1);
+        }
+        // Only peripherals with a trigger input take a ":pin"
+        if ((ntap > 0) && (enumerators[i].invoke != pgen16) &&
+            (enumerators[i].invoke != pgen1k) &&
+            (enumerators[i].invoke != pulse2) &&
+            (enumerators[i].invoke != la8)) {
+            fprintf(stderr, "FATAL: %s: No trigger input on %s\n",
+                    argv[0], peri);
+            exit(1);
+        }
+        // Only the serout FIFOs take a "@depth"
+        if ((pdepth != (char *)0) && (enumerators[i].invoke != serout4) &&
+            (enumerators[i].invoke != serout8)) {
+            fprintf(stderr, "FATAL: %s: FIFO depth is only for serout: %s\n",
+                    argv[0], peri);
+            exit(1);
+        }
         // Found the peripheral.  Invoke it with its slot # and starting pin #
         pin = (enumerators[i].invoke)(slot, pin, peri);
 
         // add it to the includes file
         fprintf(pincludes, "`include \"%s.v\"\n", enumerators[i].incname);
+        if (sharedinc != (char *)0)
+            fprintf(pincludes, "`include \"%s.v\"\n", sharedinc);
 
         // Put the library name in the rom image
         romindx += sprintf(&(rom[romindx]), "%s%c", enumerators[i].libname,
@@ -366,7 +480,8 @@ int pgen16(int addr, int startpin, char * peri)
     printbus(addr, "pgen16");
     fprintf(stdout, "    p%02dm100clk,p%02dm10clk,p%02dm1clk,",addr,addr,addr);
     fprintf(stdout, "    p%02du100clk,p%02du10clk,p%02du1clk,p%02dn100clk,",addr,addr,addr,addr);
-    fprintf(stdout, "    p%02dpattern);\n", addr);
+    fprintf(stdout, "    p%02dtrig,p%02dpattern);\n", addr, addr);
+    printtrig(addr);
     fprintf(stdout, "    assign p%02dm100clk = bc0m100clk;\n", addr);
 		fprintf(stdout, "    assign p%02dm10clk = bc0m10clk;\n", addr);
     fprintf(stdout, "    assign p%02dm1clk = bc0m1clk;\n", addr);
@@ -382,6 +497,29 @@ int pgen16(int addr, int startpin, char * peri)
 }
 
 
+int pgen1k(int addr, int startpin, char * peri)
+{
+    fprintf(stdout,"\n    wire [3:0] p%02dpattern;", addr);
+    printbus(addr, "pgen1k");
+    fprintf(stdout, "    p%02dm100clk,p%02dm10clk,p%02dm1clk,",addr,addr,addr);
+    fprintf(stdout, "    p%02du100clk,p%02du10clk,p%02du1clk,p%02dn100clk,",addr,addr,addr,addr);
+    fprintf(stdout, "    p%02dtrig,p%02dpattern);\n", addr, addr);
+    printtrig(addr);
+    fprintf(stdout, "    assign p%02dm100clk = bc0m100clk;\n", addr);
+    fprintf(stdout, "    assign p%02dm10clk = bc0m10clk;\n", addr);
+    fprintf(stdout, "    assign p%02dm1clk = bc0m1clk;\n", addr);
+    fprintf(stdout, "    assign p%02du100clk = bc0u100clk;\n", addr);
+    fprintf(stdout, "    assign p%02du10clk = bc0u10clk;\n", addr);
+    fprintf(stdout, "    assign p%02du1clk = bc0u1clk;\n", addr);
+    fprintf(stdout, "    assign p%02dn100clk = bc0n100clk;\n", addr);
+    fprintf(stdout, "    assign `PIN_%02d = p%02dpattern[0];\n", startpin, addr);
+    fprintf(stdout, "    assign `PIN_%02d = p%02dpattern[1];\n", startpin+1, addr);
+    fprintf(stdout, "    assign `PIN_%02d = p%02dpattern[2];\n", startpin+2, addr);
+    fprintf(stdout, "    assign `PIN_%02d = p%02dpattern[3];\n", startpin+3, addr);
+    return(startpin +4);
+}
+
+
 int pwmin4(int addr, int startpin, char * peri)
 {
     fprintf(stdout,"\n    wire [3:0] p%02dpwm;", addr);
@@ -424,48 +562,44 @@ int quad2(int addr, int startpin, char * peri)
     return(startpin +4);
 }
 
-int qtr4(int addr, int startpin, char * peri)
+// qtr4 and qtr8 differ only in the number of sensors
+int printqtr(int addr, int startpin, int nsens)
 {
+    char  inst[80];
+    int   i;
+
+    sprintf(inst, "qtr #(.NSENS(%d))", nsens);
     fprintf(stdout,"\n    wire p%02dm10clk;", addr);
     fprintf(stdout,"\n    wire p%02du10clk;", addr);
-    fprintf(stdout,"\n    tri [3:0] p%02dq;", addr);
-    printbus(addr, peri);
-    fprintf(stdout, "    p%02dm10clk,p%02du10clk,p%02dq);\n", addr, addr, addr);
+    fprintf(stdout,"\n    wire p%02du1clk;", addr);
+    fprintf(stdout,"\n    tri [%d:0] p%02dq;", nsens - 1, addr);
+    printbus(addr, inst);
+    fprintf(stdout, "    p%02dm10clk,p%02du10clk,p%02du1clk,p%02dq);\n", addr, addr, addr, addr);
     fprintf(stdout, "    assign p%02dm10clk = bc0m10clk;\n", addr);
     fprintf(stdout, "    assign p%02du10clk = bc0u10clk;\n", addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dq[0];\n", startpin, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dq[1];\n", startpin+1, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dq[2];\n", startpin+2, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dq[3];\n", startpin+3, addr);
-    return(startpin +4);
+    fprintf(stdout, "    assign p%02du1clk = bc0u1clk;\n", addr);
+    for (i = 0; i < nsens; i++)
+        fprintf(stdout, "    assign `PIN_%02d = p%02dq[%d];\n", startpin+i, addr, i);
+    return(startpin + nsens);
+}
+
+int qtr4(int addr, int startpin, char * peri)
+{
+    return(printqtr(addr, startpin, 4));
 }
 
 int qtr8(int addr, int startpin, char * peri)
 {
-    fprintf(stdout,"\n    wire p%02dm10clk;", addr);
-    fprintf(stdout,"\n    wire p%02du10clk;", addr);
-    fprintf(stdout,"\n    tri [7:0] p%02dq;", addr);
-    printbus(addr, peri);
-    fprintf(stdout, "    p%02dm10clk,p%02du10clk,p%02dq);\n", addr, addr, addr);
-    fprintf(stdout, "    assign p%02dm10clk = bc0m10clk;\n", addr);
-    fprintf(stdout, "    assign p%02du10clk = bc0u10clk;\n", addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dq[0];\n", startpin, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dq[1];\n", startpin+1, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dq[2];\n", startpin+2, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dq[3];\n", startpin+3, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dq[4];\n", startpin+4, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dq[5];\n", startpin+5, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dq[6];\n", startpin+6, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dq[7];\n", startpin+7, addr);
-    return(startpin +8);
+    return(printqtr(addr, startpin, 8));
 }
 
 int roten(int addr, int startpin, char * peri)
 {
     printbus(addr, peri);
-    fprintf(stdout, "    p%02dbtn,p%02dq1,p%02dq2,p%02dled);\n",
-           addr,addr,addr,addr);
+    fprintf(stdout, "    p%02dm1clk,p%02dbtn,p%02dq1,p%02dq2,p%02dled);\n",
+           addr,addr,addr,addr,addr);
     fprintf(stdout, "    assign p%02dpollevt = bc0pollevt;\n", addr);
+    fprintf(stdout, "    assign p%02dm1clk = bc0m1clk;\n", addr);
     fprintf(stdout, "    assign p%02dbtn = `PIN_%02d;\n", addr, startpin);
     fprintf(stdout, "    assign p%02dq1 = `PIN_%02d;\n", addr, startpin+1);
     fprintf(stdout, "    assign p%02dq2 = `PIN_%02d;\n", addr, startpin+2);
@@ -473,6 +607,26 @@ int roten(int addr, int startpin, char * peri)
     return(startpin +4);
 }
 
+int roten4(int addr, int startpin, char * peri)
+{
+    fprintf(stdout,"\n    wire p%02du10clk;", addr);
+    fprintf(stdout,"\n    wire p%02dm1clk;", addr);
+    fprintf(stdout,"\n    wire p%02dpin2;", addr);
+    fprintf(stdout,"\n    wire p%02dpin4;", addr);
+    fprintf(stdout,"\n    wire p%02dpin6;", addr);
+    fprintf(stdout,"\n    wire p%02dpin8;", addr);
+    printbus(addr, peri);
+    fprintf(stdout, "    p%02du10clk,p%02dm1clk, ", addr, addr);
+    fprintf(stdout, "    p%02dpin2,p%02dpin4,p%02dpin6,p%02dpin8);\n", addr,addr,addr,addr);
+    fprintf(stdout, "    assign p%02du10clk = bc0u10clk;\n", addr);
+    fprintf(stdout, "    assign p%02dm1clk = bc0m1clk;\n", addr);
+    fprintf(stdout, "    assign `PIN_%02d = p%02dpin2;\n", startpin, addr);
+    fprintf(stdout, "    assign `PIN_%02d = p%02dpin4;\n", startpin+1, addr);
+    fprintf(stdout, "    assign `PIN_%02d = p%02dpin6;\n", startpin+2, addr);
+    fprintf(stdout, "    assign p%02dpin8 = `PIN_%02d;\n", addr, startpin+3);
+    return(startpin +4);
+}
+
 int count4(int addr, int startpin, char * peri)
 {
     printbus(addr, "count4");
@@ -495,8 +649,9 @@ int pulse2(int addr, int pin, char * peri)
     fprintf(stdout,"\n    wire p%02dp2p;", addr);
     fprintf(stdout,"\n    wire p%02dp2n;", addr);
     printbus(addr, peri);
-    fprintf(stdout, "        p%02dp1p,p%02dp1n,p%02dp2p,p%02dp2n);\n",
-                     addr,addr,addr,addr);
+    fprintf(stdout, "        p%02dtrig,p%02dp1p,p%02dp1n,p%02dp2p,p%02dp2n);\n",
+                     addr,addr,addr,addr,addr);
+    printtrig(addr);
     fprintf(stdout, "    assign `PIN_%02d = p%02dp1p;\n", pin, addr);
     fprintf(stdout, "    assign `PIN_%02d = p%02dp1n;\n", pin+1, addr);
     fprintf(stdout, "    assign `PIN_%02d = p%02dp2p;\n", pin+2, addr);
@@ -633,10 +788,12 @@ int ws2812(int addr, int pin, char * peri)
 }
 
 
-int out4(int addr, int pin, char * peri)
+// The out4 variants differ in the power on value and in having the
+// one-shot timers and sequencer.
+int printout4(int addr, int pin, char * inst)
 {
     fprintf(stdout,"\n    wire [3:0] p%02dbitout;", addr);
-    printbus(addr, "out4");
+    printbus(addr, inst);
     fprintf(stdout, "        p%02dbitout);\n", addr);
     fprintf(stdout, "    assign `PIN_%02d = p%02dbitout[0];\n", pin, addr);
     fprintf(stdout, "    assign `PIN_%02d = p%02dbitout[1];\n", pin+1, addr);
@@ -645,49 +802,36 @@ int out4(int addr, int pin, char * peri)
     return(pin +4);
 }
 
+int out4(int addr, int pin, char * peri)
+{
+    return(printout4(addr, pin, "out4"));
+}
 
 int out4l(int addr, int pin, char * peri)
 {
-    fprintf(stdout,"\n    wire [3:0] p%02dbitout;", addr);
-    printbus(addr, "out4l");
-    fprintf(stdout, "        p%02dbitout);\n", addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dbitout[0];\n", pin, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dbitout[1];\n", pin+1, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dbitout[2];\n", pin+2, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dbitout[3];\n", pin+3, addr);
-    return(pin +4);
+    return(printout4(addr, pin, "out4 #(.INITVAL(4'h0))"));
+}
+
+int out4t(int addr, int pin, char * peri)
+{
+    return(printout4(addr, pin, "out4 #(.TIMERS(1))"));
+}
+
+int out4lt(int addr, int pin, char * peri)
+{
+    return(printout4(addr, pin, "out4 #(.INITVAL(4'h0), .TIMERS(1))"));
 }
 
 
 int serout4(int addr, int pin, char * peri)
 {
-    fprintf(stdout,"\n    wire [3:0] p%02dtxd;", addr);
-    printbus(addr, "serout #(.NPORT(4), .LOGNPORT(2))");
-    fprintf(stdout, "    p%02du1clk,p%02dtxd);\n", addr,addr);
-    fprintf(stdout, "    assign p%02du1clk = bc0u1clk;\n", addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dtxd[0];\n", pin, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dtxd[1];\n", pin+1, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dtxd[2];\n", pin+2, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dtxd[3];\n", pin+3, addr);
-    return(pin +4);
+    return(printserout(addr, pin, 4, 2));
 }
 
 
 int serout8(int addr, int pin, char * peri)
 {
-    fprintf(stdout,"\n    wire [7:0] p%02dtxd;", addr);
-    printbus(addr, "serout #(.NPORT(8), .LOGNPORT(3))");
-    fprintf(stdout, "    p%02du1clk,p%02dtxd);\n", addr,addr);
-    fprintf(stdout, "    assign p%02du1clk = bc0u1clk;\n", addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dtxd[0];\n", pin, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dtxd[1];\n", pin+1, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dtxd[2];\n", pin+2, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dtxd[3];\n", pin+3, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dtxd[4];\n", pin+4, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dtxd[5];\n", pin+5, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dtxd[6];\n", pin+6, addr);
-    fprintf(stdout, "    assign `PIN_%02d = p%02dtxd[7];\n", pin+7, addr);
-    return(pin +8);
+    return(printserout(addr, pin, 8, 3));
 }
 
 
@@ -713,11 +857,13 @@ int gpio4(int addr, int pin, char * peri)
 {
     fprintf(stdout,"\n    tri [3:0] p%02dsbio;", addr);
     printbus(addr, peri);
-    fprintf(stdout, "        p%02dsbio);\n", addr);
+    fprintf(stdout, "        p%02du1clk,p%02dsbio);\n", addr, addr);
+    fprintf(stdout, "    assign p%02du1clk = bc0u1clk;\n", addr);
     fprintf(stdout, "    assign `PIN_%02d = p%02dsbio[0];\n", pin, addr);
     fprintf(stdout, "    assign `PIN_%02d = p%02dsbio[1];\n", pin+1, addr);
     fprintf(stdout, "    assign `PIN_%02d = p%02dsbio[2];\n", pin+2, addr);
     fprintf(stdout, "    assign `PIN_%02d = p%02dsbio[3];\n", pin+3, addr);
+    sharedinc = "evfifo";            // event FIFO module
     return(pin +4);
 }
 
@@ -726,12 +872,14 @@ int in4(int addr, int startpin, char * peri)
 {
     fprintf(stdout,"\n    wire [3:0] p%02din;", addr);
     printbus(addr, "in4");
-    fprintf(stdout, "        p%02din);\n", addr);
+    fprintf(stdout, "        p%02du1clk,p%02din);\n", addr, addr);
+    fprintf(stdout, "    assign p%02du1clk = bc0u1clk;\n", addr);
     fprintf(stdout, "    assign p%02dpollevt = bc0pollevt;\n", addr);
     fprintf(stdout, "    assign p%02din[0] = `PIN_%02d;\n", addr, startpin);
     fprintf(stdout, "    assign p%02din[1] = `PIN_%02d;\n", addr, startpin+1);
     fprintf(stdout, "    assign p%02din[2] = `PIN_%02d;\n", addr, startpin+2);
     fprintf(stdout, "    assign p%02din[3] = `PIN_%02d;\n", addr, startpin+3);
+    sharedinc = "evfifo";            // event FIFO module
     return(startpin +4);
 }
 
@@ -755,6 +903,7 @@ int out32(int addr, int startpin, char * peri)
     printbus(addr, peri);
     fprintf(stdout, "    p%02du10clk, ", addr);
     fprintf(stdout, "    p%02dpin2,p%02dpin4,p%02dpin6,p%02dpin8);\n", addr,addr,addr,addr);
+    fprintf(stdout, "    assign p%02du10clk = bc0u10clk;\n", addr);
     fprintf(stdout, "    assign `PIN_%02d = p%02dpin2;\n", startpin, addr);
     fprintf(stdout, "    assign `PIN_%02d = p%02dpin4;\n", startpin+1, addr);
     fprintf(stdout, "    assign `PIN_%02d = p%02dpin6;\n", startpin+2, addr);
@@ -812,6 +961,7 @@ int tif(int addr, int startpin, char * peri)
     fprintf(stdout, "    assign `PIN_%02d = p%02dpin4;\n", startpin+1, addr);
     fprintf(stdout, "    assign `PIN_%02d = p%02dpin6;\n", startpin+2, addr);
     fprintf(stdout, "    assign p%02dpin8 = `PIN_%02d;\n", addr, startpin+3);
+    sharedinc = "evfifo";            // event FIFO module
     return(startpin +4);
 }
 
@@ -879,6 +1029,66 @@ int null(int addr, int pin, char * peri)
 }
 
 
+int la8(int addr, int startpin, char * peri)
+{
+    int   i;
+
+    fprintf(stdout,"\n    wire [3:0] p%02dpins;", addr);
+    fprintf(stdout,"\n    wire [3:0] p%02dtap;", addr);
+    printbus(addr, "la8");
+    fprintf(stdout, "    p%02dm100clk,p%02dm10clk,p%02dm1clk,",addr,addr,addr);
+    fprintf(stdout, "    p%02du100clk,p%02du10clk,p%02du1clk,p%02dn100clk,",addr,addr,addr,addr);
+    fprintf(stdout, "    p%02dpins,p%02dtap);\n", addr, addr);
+    fprintf(stdout, "    assign p%02dm100clk = bc0m100clk;\n", addr);
+    fprintf(stdout, "    assign p%02dm10clk = bc0m10clk;\n", addr);
+    fprintf(stdout, "    assign p%02dm1clk = bc0m1clk;\n", addr);
+    fprintf(stdout, "    assign p%02du100clk = bc0u100clk;\n", addr);
+    fprintf(stdout, "    assign p%02du10clk = bc0u10clk;\n", addr);
+    fprintf(stdout, "    assign p%02du1clk = bc0u1clk;\n", addr);
+    fprintf(stdout, "    assign p%02dn100clk = bc0n100clk;\n", addr);
+    fprintf(stdout, "    assign p%02dpins[0] = `PIN_%02d;\n", addr, startpin);
+    fprintf(stdout, "    assign p%02dpins[1] = `PIN_%02d;\n", addr, startpin+1);
+    fprintf(stdout, "    assign p%02dpins[2] = `PIN_%02d;\n", addr, startpin+2);
+    fprintf(stdout, "    assign p%02dpins[3] = `PIN_%02d;\n", addr, startpin+3);
+    // Taps only read the pins so they may be shared with other slots
+    for (i = 0; i < MAXTAP; i++) {
+        if (i < ntap)
+            fprintf(stdout, "    assign p%02dtap[%d] = `PIN_%02d;\n", addr, i, tappin[i]);
+        else
+            fprintf(stdout, "    assign p%02dtap[%d] = 1'b0;\n", addr, i);
+    }
+    return(startpin +4);
+}
+
+
+int regseq(int addr, int pin, char * peri)
+{
+    if (nregseq != 0) {
+        fprintf(stderr, "FATAL: Only one regseq is allowed\n");
+        exit(1);
+    }
+    nregseq = 1;
+    fprintf(stdout,"\n    wire [11:0] p%02dmaddr;", addr);
+    fprintf(stdout,"\n    wire [7:0] p%02dmdatout;", addr);
+    fprintf(stdout,"\n    wire [7:0] p%02dmdatin;", addr);
+    printbus(addr, "regseq");
+    fprintf(stdout, "        p%02dmreq,p%02dmgnt,p%02dmaddr,p%02dmdatout,p%02dmrdwr,\n",
+           addr,addr,addr,addr,addr);
+    fprintf(stdout, "        p%02dmstrobe,p%02dmdatin,p%02dmbusy,p%02dmmatch);\n",
+           addr,addr,addr,addr);
+    fprintf(stdout, "    assign sq0req = p%02dmreq;\n", addr);
+    fprintf(stdout, "    assign p%02dmgnt = sq0gnt;\n", addr);
+    fprintf(stdout, "    assign sq0addr = p%02dmaddr;\n", addr);
+    fprintf(stdout, "    assign sq0datout = p%02dmdatout;\n", addr);
+    fprintf(stdout, "    assign sq0rdwr = p%02dmrdwr;\n", addr);
+    fprintf(stdout, "    assign sq0strobe = p%02dmstrobe;\n", addr);
+    fprintf(stdout, "    assign p%02dmdatin = bi0datin;\n", addr);
+    fprintf(stdout, "    assign p%02dmbusy = bi0busy;\n", addr);
+    fprintf(stdout, "    assign p%02dmmatch = bi0addr_match;\n", addr);
+    return(pin);
+}
+
+
 void printbus(int slot, char * peri)
 {
     fprintf(stdout, "\n    // %s\n", peri);
@@ -888,3 +1098,40 @@ void printbus(int slot, char * peri)
     fprintf(stdout, "p%02daddr_match_out,p%02ddatin,p%02ddatout,\n", slot,slot,slot);
 }
 
+
+void printtrig(int slot)
+{
+    if (trigpin < 0)
+        fprintf(stdout, "    assign p%02dtrig = 1'b0;\n", slot);
+    else
+        fprintf(stdout, "    assign p%02dtrig = `PIN_%02d;\n", slot, trigpin);
+}
+
+
+// serout4 and serout8 differ only in the number of ports.  The FIFO
+// depth per port is a power of two and all FIFOs share one RAMB16.
+int printserout(int addr, int pin, int nport, int lognport)
+{
+    char  inst[PERILEN * 4];
+    int   logdepth = 5;          // default of 32 characters per port
+    int   i;
+
+    if (fifodepth != 0) {
+        for (logdepth = 4; (1 << logdepth) < fifodepth; logdepth++)
+            ;
+        if (((1 << logdepth) != fifodepth) || ((nport * fifodepth) > 2048)) {
+            fprintf(stderr, "FATAL: Bad FIFO depth %d for serout%d\n",
+                    fifodepth, nport);
+            exit(1);
+        }
+    }
+    sprintf(inst, "serout #(.NPORT(%d), .LOGNPORT(%d), .LOGDEPTH(%d))",
+            nport, lognport, logdepth);
+
+    fprintf(stdout,"\n    tri [%d:0] p%02dsio;", nport - 1, addr);
+    printbus(addr, inst);
+    fprintf(stdout, "    p%02dsio);\n", addr);
+    for (i = 0; i < nport; i++)
+        fprintf(stdout, "    assign `PIN_%02d = p%02dsio[%d];\n", pin+i, addr, i);
+    return(pin + nport);
+}
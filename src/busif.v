@@ -33,6 +33,13 @@
 //  Description:  This bus interface accepts command and data from
 //       the host compute and translates those commands into reads
 //       and writes onto the DPCore bus. 
+//       The bus interface is normally the only bus master.  A register
+//       sequencer, if present, raises sqreq to ask for the bus and may
+//       drive it while sqgnt is high.  The grant is given only when we
+//       are idle with no host byte waiting, and is taken back as soon
+//       as the sequencer drops its request.  The sequencer must keep
+//       sqreq low for at least one clock between transfers so that
+//       host commands and autosend polling are never starved.
 //
 /////////////////////////////////////////////////////////////////////////
 
@@ -84,7 +91,7 @@
 
 module busif(clk, phydatin, phyrxf_, phyrd_, pkt_in, phydatout,
     phytxe_, phywr, pkt_out, addr, datout, rdwr, strobe, busy, u100clk,
-    addr_match, datin);
+    addr_match, datin, sqreq, sqgnt);
     // Lines to and from the bus controller
     input  clk;              // 50MHz system clock
     // Lines to and from the physical (slip) interface
@@ -105,6 +112,9 @@ module busif(clk, phydatin, phyrxf_, phyrd_, pkt_in, phydatout,
     input  u100clk;          // ==1 if it's time to start a peripheral poll cycle
     input  addr_match;       // ==1 if target peripheral claims the address
     input  [7:0] datin;      // Data INto the bus interface;
+    // Lines to and from a register sequencer
+    input  sqreq;            // ==1 if the sequencer wants the bus
+    output sqgnt;            // ==1 while the sequencer owns the bus
 
 
     reg  [3:0] state;        // state of the interface
@@ -114,12 +124,15 @@ module busif(clk, phydatin, phyrxf_, phyrd_, pkt_in, phydatout,
     reg  sendingpkt;         // Set high when we are sending a packet.
     reg  [7:0] data;         // The data to/from the peripheral
     reg  [3:0] polladdr;     // Poll address.  Cycle to each peripheral asking for new data
+    reg  gnt;                // Set high when the sequencer has the bus
+    wire polling;            // ==1 if the poll looks at paddr on this clock
 
     initial
     begin
         state = `BI_WT_CMD;
         sendingpkt = 0;
         polladdr = 0;
+        gnt = 0;
     end
 
 
@@ -132,7 +145,13 @@ module busif(clk, phydatin, phyrxf_, phyrd_, pkt_in, phydatout,
         // Main bus state machine .....
         if (state == `BI_WT_CMD)    // Idle.  Waiting for a new command from the host
         begin
-            if (pkt_in && (phyrxf_ == 0))
+            if (gnt)
+            begin
+                // The sequencer has the bus.  Wait for it to let go.
+                if (sqreq == 0)
+                    gnt <= 0;
+            end
+            else if (pkt_in && (phyrxf_ == 0))
             begin
                 // set phyrd_ = 0
                 cmd <= phydatin;
@@ -147,7 +166,7 @@ module busif(clk, phydatin, phyrxf_, phyrd_, pkt_in, phydatout,
             begin
                 //  This is where we do the background polling for new data
                 //  from the peripherals that needs to be sent up to the host
-                if ((polladdr != 0) && (sendingpkt == 0))
+                if (polling)
                 begin
                     // Any bytes to transfer up to the host?
                     if (datin != 0)
@@ -164,6 +183,10 @@ module busif(clk, phydatin, phyrxf_, phyrd_, pkt_in, phydatout,
                     end
                     paddr[7:0] <= 0;
                 end
+
+                // Give the bus to the sequencer if the poll does not need it
+                if (sqreq && ~(polling && (datin != 0)))
+                    gnt <= 1;
             end
         end
         else if (state == `BI_WT_HIAD)   // Got a command.  Get the high address
@@ -354,7 +377,7 @@ module busif(clk, phydatin, phyrxf_, phyrd_, pkt_in, phydatout,
 
     // Deal with the output lines toward the USB receiver
     assign phyrd_ = ~(pkt_in && (phyrxf_ == 0) &&
-                 ((state == `BI_WT_CMD) || (state == `BI_WT_HIAD) || (state == `BI_WT_LOAD) ||
+                 (((state == `BI_WT_CMD) && (gnt == 0)) || (state == `BI_WT_HIAD) || (state == `BI_WT_LOAD) ||
                   //(state == `BI_WT_WDCT) || (state == `BI_WR_HIDA) ||(state == `BI_WR_LODA) ||
                   (state == `BI_WT_WDCT) || (state == `BI_WR_LODA) ||
                   (state == `BI_WR_ABORT)));
@@ -373,11 +396,18 @@ module busif(clk, phydatin, phyrxf_, phyrd_, pkt_in, phydatout,
                                        (state == `BI_RD_LODA) ||
                                        (state == `BI_SN_DCNT)));
 
-    // Deal with output lines to the peripherals
-    assign addr = paddr;      // address of target peripheral
+    // Deal with output lines to the peripherals.  The address is parked
+    // on the enumerator at slot 0 except during a transfer or a poll so
+    // that a peripheral sees its address without a strobe only when we
+    // look at its reply, and any non-zero reply starts the autosend.
+    assign polling = (state == `BI_WT_CMD) && (polladdr != 0) && (sendingpkt == 0) &&
+                     (gnt == 0) && ~(pkt_in && (phyrxf_ == 0));
+    assign addr = (strobe) ? paddr :
+                  (polling) ? {paddr[11:8], 8'h00} : 12'h000;
     assign datout = (state == `BI_WR_WRIT) ? data : 8'h00;     // Data OUT to the peripherals
     assign rdwr = (state == `BI_RD_WORD);
     assign strobe = (((state == `BI_RD_WORD) || (state == `BI_WR_WRIT)) && (count != 0));
+    assign sqgnt = gnt;
 
 endmodule
 
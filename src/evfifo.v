@@ -0,0 +1,150 @@
+// *********************************************************
+// Copyright (c) 2020 Demand Peripherals, Inc.
+// 
+// This file is licensed separately for private and commercial
+// use.  See LICENSE.txt which should have accompanied this file
+// for details.  If LICENSE.txt is not available please contact
+// support@demandperipherals.com to receive a copy.
+// 
+// In general, you may use, modify, redistribute this code, and
+// use any associated patent(s) as long as
+// 1) the above copyright is included in all redistributions,
+// 2) this notice is included in all source redistributions, and
+// 3) this code or resulting binary is not sold as part of a
+//    commercial product.  See LICENSE.txt for definitions.
+// 
+// DPI PROVIDES THE SOFTWARE "AS IS," WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING
+// WITHOUT LIMITATION ANY WARRANTIES OR CONDITIONS OF TITLE,
+// NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR
+// PURPOSE.  YOU ARE SOLELY RESPONSIBLE FOR DETERMINING THE
+// APPROPRIATENESS OF USING OR REDISTRIBUTING THE SOFTWARE (WHERE
+// ALLOWED), AND ASSUME ANY RISKS ASSOCIATED WITH YOUR EXERCISE OF
+// PERMISSIONS UNDER THIS AGREEMENT.
+// 
+// This software may be covered by US patent #10,324,889. Rights
+// to use these patents is included in the license agreements.
+// See LICENSE.txt for more information.
+// *********************************************************
+
+//////////////////////////////////////////////////////////////////////////
+//
+//  File: evfifo.v;   Input event FIFO and its autosend
+//
+//      The gpio4, in4, and tif can queue input changes as timestamped
+//  events.  This is the event FIFO and the autosend of its entries
+//  that they share.  The FIFO holds 15 entries of three bytes.  The
+//  peripheral builds each entry, including the lost event flag from
+//  evlost, and queues it with evwr.  If the FIFO is full the entry is
+//  dropped and evlost is set until the next entry is queued.
+//      On a poll of Reg 0 with enable set and entries in the FIFO we
+//  ask to send all of the entries.  The autosend reads the registers
+//  in order from Reg 0 and each in-order read returns the next byte
+//  of the entries.  An entry leaves the FIFO when its last byte is
+//  read.  Any other access to the peripheral ends the autosend and
+//  leaves the unread entries, including a partly read one, in the
+//  FIFO.  This keeps a host read of a configuration register from
+//  taking events out of the FIFO.
+//      The peripheral claims the bus cycle and puts evdatout on the
+//  bus when evsel is set.
+//
+/////////////////////////////////////////////////////////////////////////
+module evfifo(clk,rdwr,strobe,our_addr,addr,enable,evwr,evdata,evlost,
+       evsel,evdatout);
+    input  clk;              // system clock
+    input  rdwr;             // direction of this transfer. Read=1; Write=0
+    input  strobe;           // true on full valid command
+    input  [3:0] our_addr;   // high byte of our assigned address
+    input  [11:0] addr;      // address of target peripheral
+    input  enable;           // ==1 in event mode
+    input  evwr;             // ==1 to queue evdata
+    input  [23:0] evdata;    // the entry to queue
+    output evlost;           // ==1 if events were lost to a full FIFO
+    output evsel;            // ==1 on a poll or read of the event autosend
+    output [7:0] evdatout;   // autosend byte count or the next event byte
+
+    reg    lost;             // ==1 if events were lost to a full FIFO
+    reg    [23:0] evram [15:0]; // the event FIFO
+    reg    [3:0] evwp;       // FIFO write pointer
+    reg    [3:0] evrp;       // FIFO read pointer
+    wire   [3:0] evnext;     // next write pointer
+    wire   [3:0] evcnt;      // number of entries in the FIFO
+    wire   [23:0] evhead;    // entry at the read pointer
+    reg    upopen;           // ==1 while an autosend of events is open
+    reg    [3:0] upleft;     // entries left in the autosend
+    reg    [5:0] upbytes;    // bytes in the autosend
+    reg    [1:0] upbyte;     // byte of the entry to read next
+    reg    [5:0] upidx;      // register of the next autosend read
+    wire   myslot;           // ==1 if the address is in our slot
+    wire   poll;             // ==1 on an autosend poll
+    wire   evrd;             // ==1 on an in-order read of an event byte
+
+    initial
+    begin
+        lost = 0;
+        evwp = 0;
+        evrp = 0;
+        upopen = 0;
+        upleft = 0;
+        upbytes = 0;
+        upbyte = 0;
+        upidx = 0;
+    end
+
+    always @(posedge clk)
+    begin
+        // Queue the new entry if there is room
+        if (evwr)
+        begin
+            if (evnext != evrp)
+            begin
+                evram[evwp] <= evdata;
+                evwp <= evnext;
+                lost <= 0;
+            end
+            else
+                lost <= 1;
+        end
+
+        // Latch the number of events to send on a poll
+        if (~upopen & enable & (evcnt != 0) & poll)
+        begin
+            upopen <= 1;
+            upleft <= evcnt;
+            upbytes <= {evcnt, 1'b0} + {2'h0, evcnt};
+            upbyte <= 0;
+            upidx <= 0;
+        end
+        else if (evrd)
+        begin
+            upidx <= upidx + 6'h01;
+            if (upbyte == 2)
+            begin
+                upbyte <= 0;
+                evrp <= evrp + 4'h1;
+                upleft <= upleft - 4'h1;
+                if (upleft == 1)
+                    upopen <= 0;
+            end
+            else
+                upbyte <= upbyte + 2'h1;
+        end
+        else if (upopen & strobe & myslot)
+            upopen <= 0;     // any other access ends the autosend
+    end
+
+    assign evnext = evwp + 4'h1;
+    assign evcnt = evwp - evrp;
+    assign evhead = evram[evrp];
+    assign evlost = lost;
+
+    assign myslot = (addr[11:8] == our_addr);
+    assign poll = myslot & ~strobe & (addr[7:0] == 8'h00);
+    assign evrd = strobe & rdwr & myslot & upopen & (addr[7:0] == {2'h0,upidx});
+    assign evsel = evrd | (poll & (upopen | (enable & (evcnt != 0))));
+    assign evdatout = (~strobe & upopen) ? {2'h0,upbytes} :
+                      (~strobe) ? ({4'h0,evcnt} + {3'h0,evcnt,1'b0}) :
+                      (upbyte == 0) ? evhead[23:16] :
+                      (upbyte == 1) ? evhead[15:8] : evhead[7:0];
+
+endmodule
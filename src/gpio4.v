@@ -35,12 +35,26 @@
 //    Addr=0    Data In/Out
 //    Addr=1    Data direction register.  1==output,  default=0 (input)
 //    Addr=2    Update on change register.  If set, input change send auto update
+//    Addr=3    Event mode.  If bit 0 is set input changes are queued
+//              with a microsecond timestamp instead of sending the
+//              pin values.
+//    Addr=4    Debounce time in units of 100 microseconds.  An input
+//              must hold a new value this long before it is seen.
+//              Zero, the default, turns debouncing off.
 //
 // NOTES:
+//    In event mode each change on an input with its update on change
+//  bit set is put into a 15 entry FIFO.  Each entry is three bytes.
+//  Bit 7 of the first byte is the new pin level, bit 6 is set if
+//  events were lost to a full FIFO before this one, bits 5-4 are the
+//  pin number, and bits 3-0 and the next two bytes are a 20 bit
+//  microsecond timestamp.  The timestamp counts u1clk so all of the
+//  peripherals share the same timebase.  See evfifo.v for how the
+//  entries are sent to the host.
 //
 /////////////////////////////////////////////////////////////////////////
 module gpio4(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
-       addr_match_in,addr_match_out,datin,datout,sbio);
+       addr_match_in,addr_match_out,datin,datout,u1clk,sbio);
     input  clk;              // system clock
     input  rdwr;             // direction of this transfer. Read=1; Write=0
     input  strobe;           // true on full valid command
@@ -52,6 +66,7 @@ module gpio4(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     output addr_match_out;   // ==1 if we claim the above address, pass through otherwise
     input  [7:0] datin ;     // Data INto the peripheral;
     output [7:0] datout ;    // Data OUTput from the peripheral, = datin if not us.
+    input  u1clk;            // one sysclk pulse per microsecond
     inout  [3:0] sbio;       // Simple Bidirectional I/O 
  
     wire   myaddr;           // ==1 if a correct read/write on our address
@@ -62,35 +77,92 @@ module gpio4(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     reg    [3:0] meta;       // Used to bring the inputs into our clock domain
     reg    [3:0] meta1;      // Used to bring the inputs into our clock domain and for edge detection
 
+    // Debounce filter
+    reg    [7:0] debtime;    // debounce time in 100 microsecond units, 0 is off
+    reg    [6:0] dbpre;      // prescale u1clk to 100 microseconds
+    reg    [7:0] dbcnt [3:0];   // ticks that the input has differed from dbin
+    reg    [3:0] dbin;       // debounced inputs
+    reg    [3:0] dbin1;      // debounced inputs for edge detection
+    integer j;               // loop counter
+
+    // Edge event FIFO
+    reg    evmode;           // ==1 to queue edge events
+    reg    [19:0] usec;      // microsecond timebase for the timestamps
+    wire   [3:0] edges;      // inputs that changed and are watched
+    reg    [3:0] evpend;     // ==1 if the pin has an event to queue
+    reg    [3:0] evlevel;    // the pin level after the edge
+    wire   [1:0] evpin;      // pin of the event to queue next
+    wire   evlost;           // ==1 if events were lost to a full FIFO
+    wire   evsel;            // ==1 on a poll or read of the event autosend
+    wire   [7:0] evdatout;   // event autosend data to the host
+
     initial
     begin
         val = 0;
         dir = 0;
         mask = 0;
         marked = 0;
+        evmode = 0;
+        debtime = 0;
+        dbpre = 0;
+        dbin = 0;
+        dbin1 = 0;
+        for (j = 0; j < 4; j = j + 1)
+            dbcnt[j] = 0;
+        usec = 0;
+        evpend = 0;
     end
 
     always @(posedge clk)
     begin
         if (strobe & myaddr & ~rdwr)  // latch data on a write
         begin
-            if (addr[1:0] == 0)
+            if (addr[2:0] == 0)
                 val <= datin[3:0];
-            if (addr[1:0] == 1)
+            if (addr[2:0] == 1)
                 dir <= datin[3:0];
-            if (addr[1:0] == 2)
+            if (addr[2:0] == 2)
                 mask <= datin[3:0];
+            if (addr[2:0] == 3)
+                evmode <= datin[0];
+            if (addr[2:0] == 4)
+                debtime <= datin;
         end
 
-        if (((meta ^ meta1) & mask & ~dir) != 0)   // do edge detection
+        if ((edges != 0) & ~evmode)   // do edge detection
             marked <= 1;
         else if (strobe & myaddr & rdwr)  // clear marked register on any read
             marked <= 0;
 
+        // Queue one pending event per clock and note new edges
+        if (u1clk)
+            usec <= usec + 20'h00001;
+        evpend <= (evpend & ~((evpend != 0) ? (4'h1 << evpin) : 4'h0)) |
+                  ((evmode) ? edges : 4'h0);
+        evlevel <= (evlevel & ~edges) | (dbin & edges);
+
         // Get the inputs
         meta   <= sbio; 
         meta1  <= meta;
 
+        // Debounce.  An input must differ from its debounced value for
+        // debtime ticks before the debounced value changes.
+        if (u1clk)
+            dbpre <= (dbpre == 7'd99) ? 7'h00 : dbpre + 7'h01;
+        for (j = 0; j < 4; j = j + 1)
+        begin
+            if (meta1[j] == dbin[j])
+                dbcnt[j] <= 8'h00;
+            else if (dbcnt[j] >= debtime)
+            begin
+                dbin[j] <= meta1[j];
+                dbcnt[j] <= 8'h00;
+            end
+            else if (u1clk && (dbpre == 7'd99))
+                dbcnt[j] <= dbcnt[j] + 8'h01;
+        end
+        dbin1 <= dbin;
+
     end
 
     // Assign the outputs.
@@ -99,12 +171,22 @@ module gpio4(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     assign sbio[1] = (dir[1]) ? val[1] : 1'bz;
     assign sbio[0] = (dir[0]) ? val[0] : 1'bz;
 
-    assign myaddr = (addr[11:8] == our_addr) && (addr[7:2] == 0);
+    assign edges = (dbin ^ dbin1) & mask & ~dir;
+    assign evpin = (evpend[0]) ? 2'h0 : (evpend[1]) ? 2'h1 : (evpend[2]) ? 2'h2 : 2'h3;
+
+    // The event FIFO and its autosend
+    evfifo gpioev(clk,rdwr,strobe,our_addr,addr,evmode,(evpend != 0),
+            {evlevel[evpin], evlost, evpin, usec},evlost,evsel,evdatout);
+
+    assign myaddr = (addr[11:8] == our_addr) && ((addr[7:3] == 0) || evsel);
     assign datout = (~myaddr) ? datin : 
+                    (evsel) ? evdatout :           // send the queued events
                     (~strobe & marked) ? 8'h01 :   // send up one byte if data available
-                     (strobe && (addr[1:0] == 0)) ? {4'h0,meta1} :
-                     (strobe && (addr[1:0] == 1)) ? {4'h0,dir} :
-                     (strobe && (addr[1:0] == 2)) ? {4'h0,mask} :
+                     (strobe && (addr[2:0] == 0)) ? {4'h0,dbin1} :
+                     (strobe && (addr[2:0] == 1)) ? {4'h0,dir} :
+                     (strobe && (addr[2:0] == 2)) ? {4'h0,mask} :
+                     (strobe && (addr[2:0] == 3)) ? {7'h0,evmode} :
+                     (strobe && (addr[2:0] == 4)) ? debtime :
                      8'h00;
 
     // Loop in-to-out where appropriate
@@ -32,40 +32,29 @@
 //  File: in32.v;   Thirty-two channel digital input
 //
 //  Registers: 8 bit, read-write
-//      Reg 0:  Bit 0 is the value at pin 1 and is read-only.
+//      Reg 0:  Input state of pins 32 to 25 (read-only)
+//      Reg 1:  Input state of pins 24 to 17 (read-only)
+//      Reg 2:  Input state of pins 16 to 9 (read-only)
+//      Reg 3:  Input state of pins 8 to 1 (read-only)
+//      Reg 4-7: Changed-since-last-read bitmap in the same order as
+//              the state.  Reading a byte clears it.  Reading Reg 7
+//              acknowledges an autosend.
+//      Reg 8-11: Interrupt on change mask in the same order
+//      Reg 12: Scan configuration.  Bits 6-0 are the dwell time of each
+//              state of the scan in sysclks.  Zero gives the original
+//              10 microsecond dwell for long cables.  Bit 7 set keeps
+//              scanning while an autosend is pending.
+//      Reg 13: Debounce count.  An input must read a new value on this
+//              many more scans in a row before the change is accepted.
+//              Zero, the default, turns debouncing off.  The time
+//              constant is the count times the scan time.
+//      Reg 32: Bit 0 is the value at pin 1 and is read-only.
 //              Bit 1 is set to enable interrupt on change and is read-write
-//      Reg 1:  As above for pin 2
-//      Reg 2:  As above for pin 3
-//      Reg 3:  As above for pin 4
-//      Reg 4:  As above for pin 5
-//      Reg 5:  As above for pin 6
-//      Reg 6:  As above for pin 7
-//      Reg 7:  As above for pin 8
-//      Reg 8:  As above for pin 9
-//      Reg 9:  As above for pin 10
-//      Reg 10: As above for pin 11
-//      Reg 11: As above for pin 12
-//      Reg 12: As above for pin 13
-//      Reg 13: As above for pin 14
-//      Reg 14: As above for pin 15
-//      Reg 15: As above for pin 16
-//      Reg 16: As above for pin 17
-//      Reg 17: As above for pin 18
-//      Reg 18: As above for pin 19
-//      Reg 19: As above for pin 20
-//      Reg 20: As above for pin 21
-//      Reg 21: As above for pin 22
-//      Reg 22: As above for pin 23
-//      Reg 23: As above for pin 24
-//      Reg 24: As above for pin 25
-//      Reg 25: As above for pin 26
-//      Reg 26: As above for pin 27
-//      Reg 27: As above for pin 28
-//      Reg 28: As above for pin 29
-//      Reg 29: As above for pin 30
-//      Reg 30: As above for pin 31
-//      Reg 31: As above for pin 32
+//      Reg 33: As above for pin 2
+//      ....
+//      Reg 63: As above for pin 32
 //
+//  An autosend is the eight bytes of state and change bitmap.
 //
 //  HOW THIS WORKS
 //      The in32 card has four 74HC165 parallel-to-serial shift
@@ -91,15 +80,18 @@
 // #2       0/0/1     Set D input to 1 and lo clock to SH/LD~ flipflop
 // #3       1/0/1     SH/LD~ goes hi (pin6 clocked in a one) grab the data
 // #4       1/1/1     CLK goes hi (pin 4 clocked in a one) shifting data one bit, check for data change
-// #5       0/0/1     CLK goes lo (pin 2 clears FF) write data to RAM
+// #5       0/0/1     CLK goes lo (pin 2 clears FF)
 //                    (repeat 3, 4 & 5 for each bit)
 //
-//  If we detect a change on a watched pin we set a flag to
+//  Any change on a pin sets its bit in the change bitmap.  If
+//  we detect a change on a watched pin we set a flag to
 //  Indicate that a change is pending.  We wait until we've
 //  transferred all 32 bits before looking at changepending
 //  and setting another flag to request an autosend of the
 //  data.  We stop reading the pins while waiting for an
-//  autosend up to the host.
+//  autosend up to the host unless continuous scan is set.
+//  With a 50 ns dwell a full scan of the 32 inputs takes
+//  about 5 microseconds instead of about 1 millisecond.
 //
 /////////////////////////////////////////////////////////////////////////
 module in32(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
@@ -129,14 +121,21 @@ module in32(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     reg    dataready;        // set=1 to wait for an autosend to host
     reg    changepending;    // set=1 while finishing all 32 bits to then set dataready
     reg    sample;           // used to bring pin8 into our clock domain
+    reg    [31:0] state;     // input values, bit 0 is pin 1
+    reg    [31:0] changed;   // inputs changed since last read
+    reg    [31:0] mask;      // interrupt on change enable
+    reg    [7:0] scancfg;    // dwell time and continuous scan
+    reg    [6:0] dwcnt;      // counts sysclks in a scan state
+    reg    [3:0] debcnt;     // debounce count in scans
+    reg    [3:0] dbcnt [31:0];  // scans that the input has differed from state
+    integer i;               // loop counter
+    wire   tick;             // advance the scan state machine
 
     // Addressing and bus interface lines 
     wire   myaddr;           // ==1 if a correct read/write on our address
-    wire   [1:0] rout;       // RAM output lines
-    wire   [4:0] raddr;      // RAM address lines
-    wire   [1:0] rin;        // RAM input lines
-    wire   wen;              // RAM write enable
-    ram32x2in32 ram(rout,raddr,rin,clk,wen); // Register array in RAM
+    wire   [31:0] rword;     // packed register selected by addr[3:2]
+    wire   [7:0] rbyte;      // byte of rword selected by addr[1:0]
+    wire   [31:0] bytemask;  // bits of the byte selected by addr[1:0]
 
 
     initial
@@ -145,25 +144,66 @@ module in32(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
         bst = 0;
         dataready = 0;
         changepending = 0;
+        state = 32'h00000000;
+        changed = 32'h00000000;
+        mask = 32'h00000000;
+        scancfg = 8'h00;
+        dwcnt = 7'h00;
+        debcnt = 4'h0;
+        for (i = 0; i < 32; i = i + 1)
+            dbcnt[i] = 4'h0;
     end
 
     always @(posedge clk)
     begin
-        // reading reg 31 clears the dataready flag
-        if (strobe && rdwr && myaddr && (addr[4:0] == 31))
+        // reading the change bitmap clears the bytes read
+        if (strobe && rdwr && myaddr && (addr[5:2] == 4'h1))
+            changed <= changed & ~bytemask;
+
+        // host writes to the interrupt mask
+        if (strobe && ~rdwr && myaddr)
+        begin
+            if (addr[5:2] == 4'h2)
+                mask <= (mask & ~bytemask) | ({datin,datin,datin,datin} & bytemask);
+            else if (addr[5] == 1'b1)
+                mask[addr[4:0]] <= datin[1];
+            else if (addr[5:0] == 12)
+                scancfg <= datin;
+            else if (addr[5:0] == 13)
+                debcnt <= datin[3:0];
+        end
+
+        // dwell counter for short cables
+        if (dwcnt == 0)
+            dwcnt <= scancfg[6:0] - 7'h01;
+        else
+            dwcnt <= dwcnt - 7'h01;
+
+        // reading reg 7 clears the dataready flag
+        if (strobe && rdwr && myaddr && (addr[5:0] == 7))
         begin
             dataready <= 0;
         end
 
         // else if host is not rd/wr our regs and we're not waiting for autosend
-        else if (~(strobe & myaddr & ~rdwr) && (u10clk == 1) && ~dataready)
+        else if (~(strobe & myaddr & ~rdwr) && tick && (~dataready || scancfg[7]))
         begin
             // was there a change on an input?
-            // grab the input on 3, compare to old value on 4, write to RAM on 5
+            // grab the input on 3, compare to old value on 4
             if (gst == 3)
                 sample <= pin8;
-            if (rout[1] && (sample != rout[0]) && (gst == 4))
-                changepending <= 1;
+            if ((gst == 4) && (sample == state[bst]))
+                dbcnt[bst] <= 4'h0;
+            else if ((gst == 4) && (dbcnt[bst] < debcnt))
+                dbcnt[bst] <= dbcnt[bst] + 4'h1;   // wait for it to settle
+            else if (gst == 4)
+            begin
+                state[bst] <= sample;
+                changed[bst] <= 1;
+                dbcnt[bst] <= 4'h0;
+                if (mask[bst])
+                    changepending <= 1;
+            end
             if (gst < 5)
                 gst <= gst + 4'h1;
             else
@@ -186,21 +226,29 @@ module in32(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
 
 
     // Assign the outputs.
+    assign tick = (scancfg[6:0] == 0) ? u10clk : (dwcnt == 0);
     assign pin2 = ~((gst == 0) || (gst == 1));
     assign pin4 = (gst == 4);
     assign pin6 = ~((gst == 0) || (gst == 2) || (gst == 5));
 
-    // assign RAM signals
-    assign wen   = (strobe & myaddr & ~rdwr) ||  // latch data on a write
-                   (~dataready && (gst == 5));
-    assign raddr = (strobe & myaddr) ? addr[4:0] : bst ;
-    assign rin[1] = (strobe & myaddr & ~rdwr) ? datin[1] : rout[1];
-    assign rin[0] = sample;
+    // Packed registers are high byte first
+    assign rword = (addr[3:2] == 2'h0) ? state :
+                   (addr[3:2] == 2'h1) ? changed :
+                   (addr[3:2] == 2'h2) ? mask : 32'h00000000;
+    assign rbyte = (addr[1:0] == 2'h0) ? rword[31:24] :
+                   (addr[1:0] == 2'h1) ? rword[23:16] :
+                   (addr[1:0] == 2'h2) ? rword[15:8] : rword[7:0];
+    assign bytemask = (addr[1:0] == 2'h0) ? 32'hff000000 :
+                      (addr[1:0] == 2'h1) ? 32'h00ff0000 :
+                      (addr[1:0] == 2'h2) ? 32'h0000ff00 : 32'h000000ff;
 
-    assign myaddr = (addr[11:8] == our_addr) && (addr[7:5] == 0);
+    assign myaddr = (addr[11:8] == our_addr) && (addr[7:6] == 0);
     assign datout = (~myaddr) ? datin :
-                     (~strobe && myaddr && (dataready)) ? 8'h20 :  // Send 32 bytes if ready
-                      (strobe) ? {6'h00,rout} : 
+                     (~strobe && myaddr && (dataready)) ? 8'h08 :  // Send 8 bytes if ready
+                      (strobe && (addr[5] == 1)) ? {6'h00,mask[addr[4:0]],state[addr[4:0]]} :
+                      (strobe && (addr[5:0] == 12)) ? scancfg :
+                      (strobe && (addr[5:0] == 13)) ? {4'h0,debcnt} :
+                      (strobe && (addr[5:4] == 0)) ? rbyte :
                        8'h00 ; 
 
     // Loop in-to-out where appropriate
@@ -209,39 +257,3 @@ module in32(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
 
 endmodule
 
-
-
-module ram32x2in32(dout,addr,din,wclk,wen);
-   output [1:0] dout;
-   input  [4:0] addr;
-   input  [1:0] din;
-   input  wclk;
-   input  wen;
-
-   // RAM32X2S: 32 x 2 posedge write distributed (LUT) RAM
-   //           Virtex-II/II-Pro, Spartan-3/3E/3A
-   // Xilinx HDL Language Template, version 10.1
-
-   RAM32X2S #(
-      .INIT_00(32'h00000000), // INIT for bit 0 of RAM
-      .INIT_01(32'h00000000)  // INIT for bit 1 of RAM
-   ) RAM32X2S_inst (
-      .O0(dout[0]),     // RAM data[0] output
-      .O1(dout[1]),     // RAM data[1] output
-      .A0(addr[0]),     // RAM address[0] input
-      .A1(addr[1]),     // RAM address[1] input
-      .A2(addr[2]),     // RAM address[2] input
-      .A3(addr[3]),     // RAM address[3] input
-      .A4(addr[4]),     // RAM address[4] input
-      .D0(din[0]),      // RAM data[0] input
-      .D1(din[1]),      // RAM data[1] input
-      .WCLK(wclk),      // Write clock input
-      .WE(wen)          // Write enable input
-   );
-
-  // End of RAM32X2S_inst instantiation
-
-endmodule
-
-
-
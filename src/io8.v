@@ -31,17 +31,31 @@
 //
 //  File: io8.v;   Eight independent channels of input and output
 //
-//  Registers: 8 bit, read-write
-//      Reg 0:  Bit 0 is the value at pin 1 and is read-only.
+//  Registers: 8 bit, read-write.  Bit 0 is pin 1.
+//      Reg 0:  Input values (read-only)
+//      Reg 1:  Inputs changed since last read.  Reading clears it and
+//              acknowledges an autosend.
+//      Reg 2:  Output values.  A write loads all outputs.
+//      Reg 3:  Set the outputs that are set in the mask
+//      Reg 4:  Clear the outputs that are set in the mask
+//      Reg 5:  Toggle the outputs that are set in the mask
+//      Reg 6:  Direction.  An output whose bit is clear is held low
+//              so the channel can be used as an input only.
+//      Reg 7:  Interrupt on change mask
+//      Reg 8:  Scan configuration.  Bits 6-0 are the dwell time of each
+//              state of the scan in sysclks.  Zero gives the original
+//              10 microsecond dwell for long cables.  Bit 7 set keeps
+//              scanning while an autosend is pending.
+//      Reg 16: Bit 0 is the value at pin 1 and is read-only.
 //              Bit 1 is set to enable interrupt on change and is read-write
 //              Bit 2 is the data out value and is read-write
-//      Reg 1:  As above for pin 2
-//      Reg 2:  As above for pin 3
-//      Reg 3:  As above for pin 4
-//      Reg 4:  As above for pin 5
-//      Reg 5:  As above for pin 6
-//      Reg 6:  As above for pin 7
-//      Reg 7:  As above for pin 8
+//      Reg 17: As above for pin 2
+//      ....
+//      Reg 23: As above for pin 8
+//
+//  An autosend is the two bytes of inputs and changed inputs.
+//  The outputs are copied at the start of each shift cycle so
+//  all of the changes from one write appear together.
 //
 //
 //  HOW THIS WORKS
@@ -92,12 +106,13 @@
 // #9       1/0/0     Lower clock line to flip-flop controlling shift clocks
 // #10      0/0/0     QB (SCK, CLK) goes low
 //                    (repeat 6-10 for each bit)
+//  Any change on an input sets its bit in the change register.
 //  If we detect a change on a watched pin we set a flag to
 //  Indicate that a change is pending.  We wait until we've
 //  transferred all 8 bits before looking at changepending
 //  and setting another flag to request an autosend of the
 //  data.  We stop reading the pins while waiting for an
-//  autosend up to the host.
+//  autosend up to the host unless continuous scan is set.
 //
 /////////////////////////////////////////////////////////////////////////
 module io8(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
@@ -127,17 +142,19 @@ module io8(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     reg    dataready;        // set=1 to wait for an autosend to host
     reg    changepending;    // set=1 while finishing all 16 bits to then set dataready
     reg    sample;           // used to bring pin8 into our clock domain
+    reg    [7:0] scancfg;    // dwell time and continuous scan
+    reg    [6:0] dwcnt;      // counts sysclks in a scan state
+    wire   tick;             // advance the scan state machine
+    reg    [7:0] inval;      // input values
+    reg    [7:0] changed;    // inputs changed since last read
+    reg    [7:0] outval;     // output values from the host
+    reg    [7:0] outdir;     // ==1 to enable the output
+    reg    [7:0] outshift;   // outputs being shifted out this cycle
+    reg    [7:0] irqmask;    // interrupt on change enable
 
     // Addressing and bus interface lines 
     wire   myaddr;           // ==1 if a correct read/write on our address
-    wire   [2:0] rout;       // RAM output lines
-    wire   [2:0] ramedge;    // Edge transition output info
-    wire   [3:0] raddr;      // RAM address lines
-    wire   [2:0] rin;        // RAM input lines
-    wire   wen;              // RAM write enable
-    io8_16x1   io8_in_bit(rout[2],raddr,rin[2],clk,wen);
-    io8_16x1   io8_intr_bit(rout[1],raddr,rin[1],clk,wen);
-    io8_16x1   io8_out_bit(rout[0],raddr,rin[0],clk,wen);
+    wire   mywrite;          // ==1 on a host write to us
 
 
     initial
@@ -146,26 +163,76 @@ module io8(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
         bst = 0;
         dataready = 0;
         changepending = 0;
+        scancfg = 8'h00;
+        dwcnt = 7'h00;
+        inval = 8'h00;
+        changed = 8'h00;
+        outval = 8'h00;
+        outdir = 8'hff;
+        outshift = 8'h00;
+        irqmask = 8'h00;
     end
 
     always @(posedge clk)
     begin
+        // reading the change register clears it
+        if (strobe && rdwr && myaddr && (addr[4:0] == 1))
+            changed <= 8'h00;
+
+        // host writes
+        if (mywrite)
+        begin
+            if (addr[4] == 1'b1)
+            begin
+                // per pin registers
+                irqmask[addr[2:0]] <= datin[1];
+                outval[addr[2:0]] <= datin[2];
+            end
+            else if (addr[3:0] == 2)
+                outval <= datin;
+            else if (addr[3:0] == 3)
+                outval <= outval | datin;
+            else if (addr[3:0] == 4)
+                outval <= outval & ~datin;
+            else if (addr[3:0] == 5)
+                outval <= outval ^ datin;
+            else if (addr[3:0] == 6)
+                outdir <= datin;
+            else if (addr[3:0] == 7)
+                irqmask <= datin;
+            else if (addr[3:0] == 8)
+                scancfg <= datin;
+        end
 
-        // reading reg 7 clears the dataready flag
-        if (strobe && rdwr && myaddr && (addr[2:0] == 7))
+        // dwell counter for short cables
+        if (dwcnt == 0)
+            dwcnt <= scancfg[6:0] - 7'h01;
+        else
+            dwcnt <= dwcnt - 7'h01;
+
+        // reading reg 1 clears the dataready flag
+        if (strobe && rdwr && myaddr && (addr[4:0] == 1))
         begin
             dataready <= 0;
         end
 
         // else if host is not rd/wr our regs and we're not waiting for autosend
-        else if ((u10clk == 1) && ~dataready)
+        else if (~(strobe & myaddr) && tick && (~dataready || scancfg[7]))
         begin
+            // latch the outputs for this shift cycle
+            if (gst == 0)
+                outshift <= outval & outdir;
             // was there a change at an input?
-            // grab the input on 4, compare to old value on 5, write to RAM on 6
+            // grab the input on 4, compare to old value on 5
             if (gst == 4)
                 sample <= pin8;
-            if ((gst == 5) && rout[1] && (sample != rout[0]))
-                changepending <= 1;
+            if ((gst == 5) && (sample != inval[bst]))
+            begin
+                inval[bst] <= sample;
+                changed[bst] <= 1;
+                if (irqmask[bst])
+                    changepending <= 1;
+            end
 
             if (gst < 8)
                 gst <= gst + 4'h1;
@@ -186,26 +253,27 @@ module io8(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     end
 
     // Assign the outputs.
+    assign tick = (scancfg[6:0] == 0) ? u10clk : (dwcnt == 0);
     assign pin2 = (gst == 2) || (gst == 3) ||                    // LD == 0
-                   (((gst == 4) || (gst == 5)) && rout[2]) ||    // data out value
+                   (((gst == 4) || (gst == 5)) && outshift[bst]) ||  // data out value
                    (gst == 6) || (gst == 7) || (gst == 8);       // LD == 1
     assign pin4 = (gst == 5);
     assign pin6 = (gst == 1) || (gst == 3) || (gst == 4) || (gst == 5) ||
                   (gst == 6) || (gst == 8);
 
-           // assign RAM signals
-    assign wen   = (strobe & myaddr & ~rdwr) ||  // latch data on a write
-                   (~dataready && (gst == 6));
-    assign raddr = (strobe & myaddr) ? {1'h0,addr[2:0]} : {1'h0,bst[2:0]} ;
-    assign rin[2] = (strobe & myaddr & ~rdwr) ? datin[2] : rout[2];
-    assign rin[1] = (strobe & myaddr & ~rdwr) ? datin[1] : rout[1];
-    assign rin[0] = sample;
-
-    assign myaddr = (addr[11:8] == our_addr) && (addr[7:3] == 0);
+    assign myaddr = (addr[11:8] == our_addr) && (addr[7:5] == 0) &&
+                    ((addr[4] == 1) ? (addr[3] == 0) : (addr[3:0] < 9));
+    assign mywrite = strobe & myaddr & ~rdwr;
     assign datout = (~myaddr) ? datin :
-                     (~strobe && myaddr && (dataready)) ? 8'h08 :  // send up 8 bytes when ready
-                      (strobe) ? {5'h00,rout} : 
-                       8'h00 ; 
+                     (~strobe && myaddr && (dataready)) ? 8'h02 :  // send up 2 bytes when ready
+                      (~strobe) ? 8'h00 :
+                      (addr[4] == 1) ? {5'h00,outval[addr[2:0]],irqmask[addr[2:0]],inval[addr[2:0]]} :
+                      (addr[3:0] == 0) ? inval :
+                      (addr[3:0] == 1) ? changed :
+                      (addr[3:0] == 6) ? outdir :
+                      (addr[3:0] == 7) ? irqmask :
+                      (addr[3:0] == 8) ? scancfg :
+                      outval ; 
 
     // Loop in-to-out where appropriate
     assign busy_out = busy_in;
@@ -213,30 +281,3 @@ module io8(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
 
 endmodule
 
-
-module io8_16x1(dout,addr,din,wclk,clken);
-    output dout;
-    input  [3:0] addr;
-    input  din;
-    input  wclk;
-    input  clken;
-
-    // RAM16X1S_1: 16 x 1 positive edge write, asynchronous read single-port distributed RAM
-    //             Spartan-3E
-    // Xilinx HDL Libraries Guide, version 12.1
-
-    RAM16X1S #(
-    ) RAM16X1S_inst (
-       .O(dout),        // 1-bit data output
-       .A0(addr[0]),    // Address[0] input bit
-       .A1(addr[1]),    // Address[1] input bit
-       .A2(addr[2]),    // Address[2] input bit
-       .A3(addr[3]),    // Address[3] input bit
-       .D(din),         // 1-bit data input
-       .WCLK(wclk),     // Write clock input
-       .WE(clken)       // Write enable input
-    );
-endmodule
-
-
-
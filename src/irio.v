@@ -39,11 +39,30 @@
 //      :::::::::::::::::::::::::::::::::::::::::
 //      Reg 30: IR data bit in bit 0
 //      Reg 31: IR data bit in bit 0
+//      Reg 32: Protocol.  0=raw bits (default), 1=NEC, 2=RC5, 3=RC6
+//              mode 0, 4=Sony SIRC
+//      Reg 33: Transmit flags.  Bit 7 sends an NEC repeat code, bit 6
+//              is the RC5/RC6 toggle bit, bits 5-4 are the Sony SIRC
+//              length, 0=12 bits, 1=15 bits, 2=20 bits.
+//      Reg 34: Transmit address high byte
+//      Reg 35: Transmit address low byte
+//      Reg 36: Transmit command.  A write starts the transmit.
 //
 //      There are up to 32 bits of IR packet data.
-//      The configuration register is just the high bit of register 32.
-//  It indicates the value of the input while an IR signal is being
-//  received.
+//
+//      With a protocol selected the received frames are decoded in
+//  hardware and Regs 0-3 hold the last frame.  Reg 0 has the receive
+//  flags in the same format as Reg 33 with the protocol in bits 2-0,
+//  Reg 1 and Reg 2 are the address, and Reg 3 is the command.  A
+//  frame is autosent as these four bytes and reading Reg 3 lets the
+//  next frame in.  An NEC repeat code sets the repeat flag and leaves
+//  the address and command of the previous frame.  NEC addresses
+//  with a valid complement byte have a zero high byte; otherwise the
+//  high byte is the second address byte (extended NEC).  RC5 command
+//  bit 6 comes from the inverted field bit (RC5X).  The 20 bit Sony
+//  extension byte is sent as the address high byte.
+//      A transmit is one packed write of Regs 33-36.  The transmit
+//  uses the same address and command layout as the receiver.
 //
 //  Hardware:
 //      The first pin is the output to the Rx Activity LED.  The second
@@ -83,7 +102,25 @@
 //      The IR clock is two cycles (high, then low) of a 13 microsecond 
 //  counter.
 //
+//  HOW THIS WORKS : Protocol engines
+//      The receiver measures the length in microseconds of each mark
+//  (IR present) and space.  NEC is pulse distance and Sony SIRC is pulse
+//  width so each bit is resolved when its space or mark ends.  RC5 and
+//  RC6 are Manchester coded so each mark and space is quantized to a
+//  number of half bits and the half bits are stored in order.  The frame
+//  ends after a 5 ms space and is checked and decoded then.
+//      The transmitter is a sequence of timed marks and spaces built
+//  from the transmit registers.  The carrier is 38 KHz for NEC, 36 KHz
+//  for RC5 and RC6, and 40 KHz for Sony.  A 10 ms gap follows each frame.
+//
 /////////////////////////////////////////////////////////////////////////
+
+// Protocols for the protocol engines
+`define IRNEC      3'h1
+`define IRRC5      3'h2
+`define IRRC6      3'h3
+`define IRSONY     3'h4
+
 module irio(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
        addr_match_in,addr_match_out,datin,datout,
        u100clk, u1clk, rxled, txled, irout, irin);
@@ -128,6 +165,51 @@ module irio(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     wire   rxwen;            // Rx RAM write enable
     irioram32x1 irrx(rxout,rxaddr,rxin,clk,wen);
 
+    // Protocol engine registers and lines
+    reg    [2:0] proto;      // protocol, 0 for raw bits
+    reg    [7:0] txflags;    // transmit repeat, toggle, and Sony length
+    reg    [7:0] txadrh;     // transmit address high byte
+    reg    [7:0] txadrl;     // transmit address low byte
+    reg    [7:0] txcmd;      // transmit command
+    reg    txgo;             // ==1 to start a transmit when idle
+    reg    [7:0] rxflags;    // receive flags and protocol
+    reg    [7:0] rxadrh;     // receive address high byte
+    reg    [7:0] rxadrl;     // receive address low byte
+    reg    [7:0] rxcmd;      // receive command
+    reg    rxm;              // brings the IR input into our clock domain
+    reg    rxs;              // ==1 if IR is present
+    reg    rxs1;             // rxs delayed for edge detection
+    wire   rxedge;           // ==1 at the end of a mark or space
+    reg    [15:0] dur;       // microseconds since the last edge
+    reg    [1:0] rxst;       // receiver: idle, leader space, data
+    reg    rxrep;            // ==1 if the leader was an NEC repeat code
+    reg    [5:0] rxcnt;      // pulse distance/width bits received
+    reg    [31:0] rxdata;    // pulse distance/width bits, LSB first
+    reg    [47:0] halves;    // Manchester half bits in the order received
+    reg    [5:0] hcnt;       // number of half bits received
+    wire   [1:0] mnhalf;     // half bits in this mark or space, 0 if invalid
+    wire   [2:0] hmask;      // mask of those half bits
+    wire   [31:0] svb;       // Sony bits right justified
+    wire   necok;            // ==1 if a valid NEC frame
+    wire   necrep;           // ==1 if a valid NEC repeat code
+    wire   sonyok;           // ==1 if a valid Sony frame
+    wire   rc5ok;            // ==1 if a valid RC5 frame
+    wire   rc6ok;            // ==1 if a valid RC6 frame
+    reg    [2:0] pst;        // transmitter: idle, leader mark, leader space,
+                             // bit mark, bit space, trailer, half bits, gap
+    reg    [13:0] tcnt;      // microseconds left in this mark or space
+    reg    [31:0] ptword;    // pulse distance/width bits to send, LSB first
+    reg    [47:0] ptunits;   // Manchester half bits to send
+    reg    [5:0] ptidx;      // bit or half bit being sent
+    reg    [5:0] ptbits;     // number of bits or half bits to send
+    wire   [13:0] rc5b;      // RC5 bits, first bit in bit 13
+    wire   [15:0] rc6b;      // RC6 address and command
+    wire   ptmark;           // ==1 to send the carrier
+    reg    [8:0] ccnt;       // carrier half period counter
+    reg    carrier;          // the protocol carrier
+    wire   [8:0] chalf;      // system clocks per carrier half period less one
+    integer j;               // loop counter
+
     initial
     begin
         state = 0;       // Receiver is waiting for AGC pulse
@@ -136,6 +218,21 @@ module irio(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
         data_ready = 0;
         main = 0;
         inxmit = 0;
+        proto = 0;
+        txflags = 0;
+        txadrh = 0;
+        txadrl = 0;
+        txcmd = 0;
+        txgo = 0;
+        rxflags = 0;
+        rxadrh = 0;
+        rxadrl = 0;
+        rxcmd = 0;
+        rxst = 0;
+        dur = 0;
+        pst = 0;
+        ccnt = 0;
+        carrier = 0;
     end
 
 
@@ -158,7 +255,7 @@ module irio(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
         end
 
         // Handle reads and writes from the host
-        if (strobe && myaddr && (addr[4:0] == 31))
+        if (strobe && myaddr && (addr[5:0] == 31) && (proto == 0))
         begin
             if (rdwr)
                 data_ready <= 0;     // Clear data ready on a read
@@ -245,7 +342,7 @@ module irio(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
         end
 
         // Do all receiver processing on edge of 200 us clock
-        else if (pclk && u100clk && ~data_ready && ~inxmit)
+        else if (pclk && u100clk && ~data_ready && ~inxmit && (proto == 0))
         begin
             // Get the input into our clock domain
             // in0 == 1 when IR signal is present.
@@ -340,22 +437,363 @@ module irio(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                 end
             end
         end
+
+        // Protocol engine registers
+        if (strobe && myaddr && ~rdwr && addr[5])
+        begin
+            if (addr[4:0] == 0)
+            begin
+                proto <= datin[2:0];
+                data_ready <= 0;
+            end
+            if (addr[4:0] == 1)
+                txflags <= datin;
+            if (addr[4:0] == 2)
+                txadrh <= datin;
+            if (addr[4:0] == 3)
+                txadrl <= datin;
+            if (addr[4:0] == 4)
+            begin
+                txcmd <= datin;
+                txgo <= (proto != 0);
+            end
+        end
+        else if (strobe && myaddr && rdwr && (addr[5:0] == 3) && (proto != 0))
+            data_ready <= 0;         // Reading the command lets the next frame in
+
+        // Get the protocol carrier
+        if (ccnt == chalf)
+        begin
+            ccnt <= 0;
+            carrier <= ~carrier;
+        end
+        else
+            ccnt <= ccnt + 9'h001;
+
+        // Protocol receiver.  Measure each mark and space.
+        rxm <= ~irin;
+        rxs <= rxm;
+        rxs1 <= rxs;
+        if (rxedge)
+            dur <= 0;
+        else if (u1clk && (dur != 16'hffff))
+            dur <= dur + 16'h0001;
+
+        if ((proto == 0) || (pst != 0))
+            rxst <= 0;               // The receiver ignores our own transmit
+        else if (rxedge && (rxst == 0))
+        begin
+            // Waiting for a leader mark.  RC5 has no leader.
+            rxcnt <= 0;
+            rxdata <= 0;
+            rxrep <= 0;
+            hcnt <= 0;
+            halves <= 0;
+            if (rxs1 && (proto == `IRNEC) && inwin(dur, 8000, 10000))
+                rxst <= 1;
+            else if (rxs1 && (proto == `IRRC6) && inwin(dur, 2200, 3100))
+                rxst <= 1;
+            else if (rxs1 && (proto == `IRSONY) && inwin(dur, 2000, 2800))
+                rxst <= 2;
+            else if (rxs1 && (proto == `IRRC5) && (mnhalf != 0))
+            begin
+                // The first half of the start bit is a space
+                rxst <= 2;
+                halves <= {45'h0, hmask} << 1;
+                hcnt <= 6'h01 + {4'h0, mnhalf};
+            end
+        end
+        else if (rxedge && (rxst == 1))
+        begin
+            // The space after the leader mark
+            if ((proto == `IRNEC) && inwin(dur, 3500, 5500))
+                rxst <= 2;
+            else if ((proto == `IRNEC) && inwin(dur, 1750, 2750))
+            begin
+                rxrep <= 1;
+                rxst <= 2;
+            end
+            else if ((proto == `IRRC6) && inwin(dur, 700, 1100))
+                rxst <= 2;
+            else
+                rxst <= 0;
+        end
+        else if (rxedge && (rxst == 2))
+        begin
+            if (proto == `IRNEC)
+            begin
+                if (rxs1)            // marks are always 562 us
+                    rxst <= (inwin(dur, 400, 750)) ? 2'h2 : 2'h0;
+                else if (~rxrep && (rxcnt != 32) && inwin(dur, 400, 750))
+                begin
+                    rxdata <= {1'b0, rxdata[31:1]};
+                    rxcnt <= rxcnt + 6'h01;
+                end
+                else if (~rxrep && (rxcnt != 32) && inwin(dur, 1300, 2000))
+                begin
+                    rxdata <= {1'b1, rxdata[31:1]};
+                    rxcnt <= rxcnt + 6'h01;
+                end
+                else
+                    rxst <= 0;
+            end
+            else if (proto == `IRSONY)
+            begin
+                if (~rxs1)           // spaces are always 600 us
+                    rxst <= (inwin(dur, 400, 850)) ? 2'h2 : 2'h0;
+                else if ((rxcnt != 32) && inwin(dur, 400, 850))
+                begin
+                    rxdata <= {1'b0, rxdata[31:1]};
+                    rxcnt <= rxcnt + 6'h01;
+                end
+                else if ((rxcnt != 32) && inwin(dur, 950, 1500))
+                begin
+                    rxdata <= {1'b1, rxdata[31:1]};
+                    rxcnt <= rxcnt + 6'h01;
+                end
+                else
+                    rxst <= 0;
+            end
+            else                     // RC5 or RC6 half bits
+            begin
+                if ((mnhalf == 0) || (hcnt > 45))
+                    rxst <= 0;
+                else
+                begin
+                    if (rxs1)
+                        halves <= halves | ({45'h0, hmask} << hcnt);
+                    hcnt <= hcnt + {4'h0, mnhalf};
+                end
+            end
+        end
+        else if ((rxst != 0) && ~rxs1 && (dur >= 5000))
+        begin
+            // End of frame.  Keep a valid frame if the last was read.
+            rxst <= 0;
+            if ((rxst == 2) && ~data_ready)
+            begin
+                if ((proto == `IRNEC) && necrep)
+                begin
+                    rxflags <= {1'b1, 4'h0, proto};
+                    data_ready <= 1;
+                end
+                else if ((proto == `IRNEC) && necok)
+                begin
+                    rxflags <= {5'h00, proto};
+                    rxadrh <= (rxdata[15:8] == ~rxdata[7:0]) ? 8'h00 : rxdata[15:8];
+                    rxadrl <= rxdata[7:0];
+                    rxcmd <= rxdata[23:16];
+                    data_ready <= 1;
+                end
+                else if ((proto == `IRSONY) && sonyok)
+                begin
+                    rxflags <= {2'h0, ((rxcnt == 12) ? 2'h0 : (rxcnt == 15) ? 2'h1 : 2'h2),
+                                1'b0, proto};
+                    rxadrh <= (rxcnt == 20) ? svb[19:12] : 8'h00;
+                    rxadrl <= (rxcnt == 15) ? svb[14:7] : {3'h0, svb[11:7]};
+                    rxcmd <= {1'b0, svb[6:0]};
+                    data_ready <= 1;
+                end
+                else if ((proto == `IRRC5) && rc5ok)
+                begin
+                    rxflags <= {1'b0, halves[5], 3'h0, proto};
+                    rxadrh <= 8'h00;
+                    rxadrl <= {3'h0, halves[7], halves[9], halves[11], halves[13], halves[15]};
+                    rxcmd <= {1'b0, ~halves[3], halves[17], halves[19], halves[21],
+                              halves[23], halves[25], halves[27]};
+                    data_ready <= 1;
+                end
+                else if ((proto == `IRRC6) && rc6ok)
+                begin
+                    rxflags <= {1'b0, halves[8], 3'h0, proto};
+                    rxadrh <= 8'h00;
+                    rxadrl <= {halves[12], halves[14], halves[16], halves[18],
+                               halves[20], halves[22], halves[24], halves[26]};
+                    rxcmd <= {halves[28], halves[30], halves[32], halves[34],
+                              halves[36], halves[38], halves[40], halves[42]};
+                    data_ready <= 1;
+                end
+            end
+        end
+
+        // Protocol transmitter.  Load the marks and spaces of the frame.
+        if (txgo && (pst == 0))
+        begin
+            txgo <= 0;
+            ptidx <= 0;
+            if (proto == `IRNEC)
+            begin
+                ptword <= {~txcmd, txcmd, ((txadrh == 0) ? ~txadrl : txadrh), txadrl};
+                ptbits <= 32;
+                pst <= 1;
+                tcnt <= 8999;
+            end
+            else if (proto == `IRSONY)
+            begin
+                ptword <= (txflags[5:4] == 0) ? {20'h00000, txadrl[4:0], txcmd[6:0]} :
+                          (txflags[5:4] == 1) ? {17'h00000, txadrl, txcmd[6:0]} :
+                                                {12'h000, txadrh, txadrl[4:0], txcmd[6:0]};
+                ptbits <= (txflags[5:4] == 0) ? 6'd12 : (txflags[5:4] == 1) ? 6'd15 : 6'd20;
+                pst <= 1;
+                tcnt <= 2399;
+            end
+            else if (proto == `IRRC5)
+            begin
+                // A one is a space then a mark
+                for (j = 0; j < 14; j = j + 1)
+                begin
+                    ptunits[2*j] <= ~rc5b[13-j];
+                    ptunits[2*j+1] <= rc5b[13-j];
+                end
+                ptbits <= 28;
+                pst <= 6;
+                tcnt <= 888;
+            end
+            else if (proto == `IRRC6)
+            begin
+                // A one is a mark then a space.  The start bit is a one,
+                // the mode is zero, and the toggle bit is double width.
+                ptunits[11:0] <= {~txflags[6], ~txflags[6], txflags[6], txflags[6],
+                                  6'b101010, 2'b01};
+                for (j = 0; j < 16; j = j + 1)
+                begin
+                    ptunits[12+2*j] <= rc6b[15-j];
+                    ptunits[13+2*j] <= ~rc6b[15-j];
+                end
+                ptbits <= 44;
+                pst <= 1;
+                tcnt <= 2665;
+            end
+        end
+        else if (u1clk && (pst != 0))
+        begin
+            if (tcnt != 0)
+                tcnt <= tcnt - 14'h0001;
+            else if (pst == 1)       // end of leader mark
+            begin
+                pst <= 2;
+                tcnt <= (proto == `IRNEC) ? ((txflags[7]) ? 14'd2249 : 14'd4499) :
+                        (proto == `IRSONY) ? 14'd599 : 14'd888;
+            end
+            else if (pst == 2)       // end of leader space
+            begin
+                if (proto == `IRRC6)
+                begin
+                    pst <= 6;
+                    tcnt <= 443;
+                end
+                else if ((proto == `IRNEC) && txflags[7])
+                begin
+                    pst <= 5;        // repeat code is just the trailer
+                    tcnt <= 561;
+                end
+                else
+                begin
+                    pst <= 3;
+                    tcnt <= ((proto == `IRSONY) && ptword[0]) ? 14'd1199 :
+                            (proto == `IRSONY) ? 14'd599 : 14'd561;
+                end
+            end
+            else if (pst == 3)       // end of bit mark
+            begin
+                pst <= 4;
+                tcnt <= ((proto == `IRNEC) && ptword[0]) ? 14'd1686 :
+                        (proto == `IRNEC) ? 14'd561 : 14'd599;
+            end
+            else if (pst == 4)       // end of bit space
+            begin
+                ptword <= {1'b0, ptword[31:1]};
+                ptidx <= ptidx + 6'h01;
+                if ((ptidx + 6'h01) == ptbits)
+                begin
+                    pst <= (proto == `IRNEC) ? 3'h5 : 3'h7;
+                    tcnt <= (proto == `IRNEC) ? 14'd561 : 14'd9999;
+                end
+                else
+                begin
+                    pst <= 3;
+                    tcnt <= ((proto == `IRSONY) && ptword[1]) ? 14'd1199 :
+                            (proto == `IRSONY) ? 14'd599 : 14'd561;
+                end
+            end
+            else if (pst == 5)       // end of NEC trailer mark
+            begin
+                pst <= 7;
+                tcnt <= 9999;
+            end
+            else if (pst == 6)       // end of a Manchester half bit
+            begin
+                ptidx <= ptidx + 6'h01;
+                if ((ptidx + 6'h01) == ptbits)
+                begin
+                    pst <= 7;
+                    tcnt <= 9999;
+                end
+                else
+                    tcnt <= (proto == `IRRC5) ? 14'd888 : 14'd443;
+            end
+            else                     // end of the gap after the frame
+                pst <= 0;
+        end
     end
 
+    // Is a duration inside a window
+    function inwin;
+        input [15:0] d;
+        input [15:0] lo;
+        input [15:0] hi;
+        inwin = (d >= lo) && (d <= hi);
+    endfunction
+
+    // Decode the received frames
+    assign rxedge = (rxs != rxs1);
+    assign mnhalf = ((proto == `IRRC5) && inwin(dur, 500, 1250)) ? 2'h1 :
+                    ((proto == `IRRC5) && inwin(dur, 1300, 2200)) ? 2'h2 :
+                    ((proto == `IRRC6) && inwin(dur, 250, 650)) ? 2'h1 :
+                    ((proto == `IRRC6) && inwin(dur, 700, 1100)) ? 2'h2 :
+                    ((proto == `IRRC6) && inwin(dur, 1150, 1550)) ? 2'h3 : 2'h0;
+    assign hmask = (mnhalf == 1) ? 3'b001 : (mnhalf == 2) ? 3'b011 : 3'b111;
+    assign svb = rxdata >> (6'd32 - rxcnt);
+    assign necok = ~rxrep && (rxcnt == 32) && (rxdata[31:24] == ~rxdata[23:16]);
+    assign necrep = rxrep && (rxcnt == 0);
+    assign sonyok = (rxcnt == 12) || (rxcnt == 15) || (rxcnt == 20);
+    assign rc5ok = ((hcnt == 27) || (hcnt == 28)) && ~halves[0] && halves[1];
+    assign rc6ok = ((hcnt == 43) || (hcnt == 44)) && halves[0] && ~halves[1] &&
+                   ~halves[2] && ~halves[4] && ~halves[6];
+
+    // Transmit bits and carrier
+    assign rc5b = {1'b1, ~txcmd[6], txflags[6], txadrl[4:0], txcmd[5:0]};
+    assign rc6b = {txadrl, txcmd};
+    assign ptmark = (pst == 1) || (pst == 3) || (pst == 5) || ((pst == 6) && ptunits[ptidx]);
+    assign chalf = (proto == `IRSONY) ? 9'd249 :
+                   ((proto == `IRRC5) || (proto == `IRRC6)) ? 9'd277 : 9'd262;
+
 
     // Route the RAM and output lines
     assign rxaddr = (strobe & myaddr) ? addr[4:0] : count[4:0] ;
     // data into the RAM is the data bus on host write or the IR signal on receive pkts
-    assign rxin = (strobe & myaddr & ~rdwr & ~(addr[5:0] == 32)) ? datin[0] :
+    assign rxin = (strobe & myaddr & ~rdwr & ~addr[5]) ? datin[0] :
                   (main > 4) ? 1'b1 : 1'b0;   // decide if bit is a zero or a one
     // latch data while receiving IR or when getting a packet from the host
     assign wen  = ((state == 3) && (inone == 0) && (in0 == 1))  // start of next IR bit
-                  | (strobe & myaddr & ~rdwr & ~(addr[5:0] == 32)); // latch host write
+                  | (strobe & myaddr & ~rdwr & ~addr[5]); // latch host write
 
     // Assign the outputs.
-    assign myaddr = (addr[11:8] == our_addr) && (addr[7:5] == 0);
+    assign myaddr = (addr[11:8] == our_addr) && (addr[7:6] == 0);
     assign datout = (~myaddr) ? datin :
+                    (~strobe && data_ready && (proto != 0)) ? 8'h04 :  // Send decoded frame
                     (~strobe && myaddr && data_ready) ? 8'h20 :  // Send 32 bytes if ready
+                    (strobe && (addr[5:0] == 32)) ? {5'h00,proto} :
+                    (strobe && (addr[5:0] == 33)) ? txflags :
+                    (strobe && (addr[5:0] == 34)) ? txadrh :
+                    (strobe && (addr[5:0] == 35)) ? txadrl :
+                    (strobe && (addr[5:0] == 36)) ? txcmd :
+                    (strobe && addr[5]) ? 8'h00 :
+                    (strobe && (proto != 0) && (addr[4:0] == 0)) ? rxflags :
+                    (strobe && (proto != 0) && (addr[4:0] == 1)) ? rxadrh :
+                    (strobe && (proto != 0) && (addr[4:0] == 2)) ? rxadrl :
+                    (strobe && (proto != 0) && (addr[4:0] == 3)) ? rxcmd :
+                    (strobe && (proto != 0)) ? 8'h00 :
                     (strobe) ? {7'h0,rxout} : 
                     8'h00 ; 
 
@@ -363,9 +801,10 @@ module irio(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     assign busy_out = busy_in;
     assign addr_match_out = myaddr | addr_match_in;
 
-    assign rxled = ~(((state != 0) && ~inxmit) || data_ready);
-    assign txled = ~inxmit;
-    assign irout = ~(inxmit & c38k & inone & (state != 1));
+    assign rxled = ~(((proto == 0) && (state != 0) && ~inxmit) || (rxst != 0) || data_ready);
+    assign txled = ~(inxmit || (pst != 0));
+    assign irout = (proto != 0) ? ~(ptmark & carrier) :
+                   ~(inxmit & c38k & inone & (state != 1));
 
 endmodule
 
@@ -0,0 +1,407 @@
+// *********************************************************
+// Copyright (c) 2026 Demand Peripherals, Inc.
+// 
+// This file is licensed separately for private and commercial
+// use.  See LICENSE.txt which should have accompanied this file
+// for details.  If LICENSE.txt is not available please contact
+// support@demandperipherals.com to receive a copy.
+// 
+// In general, you may use, modify, redistribute this code, and
+// use any associated patent(s) as long as
+// 1) the above copyright is included in all redistributions,
+// 2) this notice is included in all source redistributions, and
+// 3) this code or resulting binary is not sold as part of a
+//    commercial product.  See LICENSE.txt for definitions.
+// 
+// DPI PROVIDES THE SOFTWARE "AS IS," WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING
+// WITHOUT LIMITATION ANY WARRANTIES OR CONDITIONS OF TITLE,
+// NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR
+// PURPOSE.  YOU ARE SOLELY RESPONSIBLE FOR DETERMINING THE
+// APPROPRIATENESS OF USING OR REDISTRIBUTING THE SOFTWARE (WHERE
+// ALLOWED), AND ASSUME ANY RISKS ASSOCIATED WITH YOUR EXERCISE OF
+// PERMISSIONS UNDER THIS AGREEMENT.
+// 
+// This software may be covered by US patent #10,324,889. Rights
+// to use these patents is included in the license agreements.
+// See LICENSE.txt for more information.
+// *********************************************************
+
+//////////////////////////////////////////////////////////////////////////
+//
+//  File: la8.v;   Eight channel logic analyzer
+//
+//  The la8 captures eight input channels into a block RAM.  Channels
+//  0-3 are the four pins of the slot.  Channels 4-7 are read-only taps
+//  of FPGA pins given in perilist, for example "la8:20,21" taps PIN_20
+//  and PIN_21 as channels 4 and 5.  The tapped pins may belong to other
+//  slots so the la8 can watch another peripheral's serial line or
+//  motor drive.  Unused taps read as zero.  All channels go through a
+//  two flip-flop synchronizer.
+//      The capture RAM holds 1024 entries of 16 bits.  The high byte of
+//  an entry is the channel values and the low byte is the number of
+//  additional samples with the same value.  Without run length encoding
+//  the low byte is always zero and there is one entry per sample.  With
+//  run length encoding a new entry is written only when the inputs
+//  change or after 256 identical samples.  This lets a slow protocol be
+//  captured at the full 20 MHz sample rate.
+//      The RAM is a circular buffer.  Arming the analyzer starts the
+//  capture.  A trigger is accepted once at least "pre" entries have been
+//  captured, and capture stops after "post" entries following the entry
+//  that holds the trigger sample.  Keep pre plus post below 1024 so the
+//  pre-trigger entries are not overwritten.  The trigger index and the
+//  number of valid entries tell the host where the capture starts.  The
+//  first valid entry is (trigger index + post + 1 - count) modulo 1024.
+//      The trigger fires when the masked channels enter the trigger
+//  value.  With one channel in the mask this is a rising or falling edge
+//  on that channel.  In level mode the trigger fires while the masked
+//  channels match.  A mask of zero triggers as soon as the pre-trigger
+//  entries are captured, and the host can force a trigger at any time.
+//      When the capture completes the la8 sends registers 0 to 4 to the
+//  host.  The host then uploads the RAM through the auto-incrementing
+//  data register using repeated reads of the same register.
+//
+//  Registers:
+//      Reg 0:  Status and control.  A read gives
+//                  bit 0: capture is running
+//                  bit 1: trigger seen
+//                  bit 2: capture complete
+//              A write of 1 to bit 0 arms a new capture, a 1 to bit 1 is
+//              a host trigger, and a 1 to bit 2 stops the capture.  A
+//              host trigger stays pending until the pre-trigger entries
+//              are captured.  A stop writes the open run as the last
+//              entry.  A stop with no capture running is ignored.
+//      Reg 1:  Trigger entry index, high 2 bits
+//      Reg 2:  Trigger entry index, low 8 bits
+//      Reg 3:  Number of valid entries, high 3 bits (max 1024)
+//      Reg 4:  Number of valid entries, low 8 bits.  A read clears the
+//              pending autosend.
+//      Reg 5:  Sample clock source in the lower 4 bits.  Same as pgen16.
+//      Reg 6:  Mode
+//                  bit 0: run length encode the samples
+//                  bit 1: level trigger instead of edge trigger
+//      Reg 7:  Trigger mask.  A 1 includes the channel in the trigger
+//      Reg 8:  Trigger value
+//      Reg 9:  Pre-trigger entries, high 2 bits
+//      Reg 10: Pre-trigger entries, low 8 bits
+//      Reg 11: Post-trigger entries, high 2 bits
+//      Reg 12: Post-trigger entries, low 8 bits
+//      Reg 13: Capture RAM address pointer, high 3 bits.  The pointer
+//              is a byte address and each entry is two bytes.
+//      Reg 14: Capture RAM address pointer, low 8 bits.
+//      Reg 15: Capture RAM data.  A read gives the RAM byte at the
+//              address pointer and then increments the pointer.  Each
+//              entry reads high byte (channels) first.
+//
+//  The clock source is selected by the lower 4 bits of register 5:
+//      0:  Off
+//      1:  20 MHz
+//      2:  10 MHz
+//      3:  5 MHz
+//      4:  1 MHz
+//      5:  500 KHz
+//      6:  100 KHz
+//      7:  50 KHz
+//      8:  10 KHz
+//      9   5 KHz
+//     10   1 KHz
+//     11:  500 Hz
+//     12:  100 Hz
+//     13:  50 Hz
+//     14:  10 Hz
+//     15:  5 Hz
+//
+/////////////////////////////////////////////////////////////////////////
+module la8(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
+       addr_match_in,addr_match_out,datin,datout,
+       m100clk,m10clk,m1clk,u100clk,u10clk,u1clk,n100clk,pins,tap);
+    input  clk;              // system clock
+    input  rdwr;             // direction of this transfer. Read=1; Write=0
+    input  strobe;           // true on full valid command
+    input  [3:0] our_addr;   // high byte of our assigned address
+    input  [11:0] addr;      // address of target peripheral
+    input  busy_in;          // ==1 if a previous peripheral is busy
+    output busy_out;         // ==our busy state if our address, pass through otherwise
+    input  addr_match_in;    // ==1 if a previous peripheral claims the address
+    output addr_match_out;   // ==1 if we claim the above address, pass through otherwise
+    input  [7:0] datin ;     // Data INto the peripheral;
+    output [7:0] datout ;    // Data OUTput from the peripheral, = datin if not us.
+    input  m100clk;          // 100 Millisecond clock pulse
+    input  m10clk;           // 10 Millisecond clock pulse
+    input  m1clk;            // Millisecond clock pulse
+    input  u100clk;          // 100 microsecond clock pulse
+    input  u10clk;           // 10 microsecond clock pulse
+    input  u1clk;            // 1 microsecond clock pulse
+    input  n100clk;          // 100 nanosecond clock pulse
+    input  [3:0] pins;       // The four pins of our slot
+    input  [3:0] tap;        // Read-only taps of other FPGA pins
+
+    // Addressing and bus interface lines 
+    wire   myaddr;           // ==1 if a correct read/write on our address
+    wire   mywrite;          // ==1 if a write to one of our registers
+    reg    [10:0] ptr;       // Host byte address into the capture RAM
+    wire   [7:0] hdout;      // Host side RAM output
+    reg    marked;           // ==1 if a completed capture needs to be sent
+
+    // Sample clock
+    wire   lclk;             // Prescale clock
+    reg    lreg;             // Prescale clock divided by two
+    reg    [3:0] freq;       // Input frequency selector
+    wire   tick;             // ==1 on each count of the selected clock
+
+    // Capture state
+    reg    [7:0] meta;       // First synchronizer stage
+    reg    [7:0] smp;        // The synchronized channels
+    reg    [7:0] cur;        // Channel values of the current run
+    reg    [7:0] runlen;     // Additional samples in the current run
+    reg    running;          // ==1 while capturing
+    reg    trigd;            // ==1 once the trigger is seen
+    reg    done;             // ==1 when the capture is complete
+    reg    rle;              // ==1 to run length encode the samples
+    reg    lvltrig;          // ==1 for a level trigger
+    reg    [7:0] tmask;      // Trigger mask
+    reg    [7:0] tval;       // Trigger value
+    reg    lastmatch;        // ==1 if the previous sample matched
+    reg    hreq;             // ==1 if a host trigger is pending
+    reg    [9:0] pre;        // Pre-trigger entries
+    reg    [9:0] post;       // Post-trigger entries
+    reg    [9:0] wptr;       // Next entry to write
+    reg    [9:0] trigidx;    // Entry holding the trigger sample
+    reg    [10:0] filled;    // Number of valid entries, saturates at 1024
+    reg    cwen;             // Capture side RAM write enable
+    reg    [9:0] caddr;      // Capture side RAM address
+    reg    [15:0] cdata;     // Capture side RAM data
+    wire   match;            // ==1 if the masked channels match the value
+    wire   trigcond;         // ==1 if this sample is a trigger
+    wire   newent;           // ==1 to close the current run on this sample
+    wire   hstop;            // ==1 on a host stop of a running capture
+
+    // The capture RAM.  The host sees bytes, the capture side sees entries.
+    // Invert the low address bit so the high byte of an entry comes first.
+    laram2kx8 capram(clk, {ptr[10:1],~ptr[0]}, hdout, caddr, cdata, cwen);
+
+
+    // Generate the sample clock
+    assign lclk = (freq[3:1] == 0) ? 1'b0 :
+                  (freq[3:1] == 1) ? n100clk :
+                  (freq[3:1] == 2) ? u1clk :
+                  (freq[3:1] == 3) ? u10clk :
+                  (freq[3:1] == 4) ? u100clk :
+                  (freq[3:1] == 5) ? m1clk :
+                  (freq[3:1] == 6) ? m10clk :
+                  (freq[3:1] == 7) ? m100clk : 1'b0;
+    assign tick = (freq == 1) ||
+                  ((freq[0] == 0) && (lclk == 1)) ||
+                  ((freq[0] == 1) && (lreg == 1) && (lclk == 1));
+
+
+    initial
+    begin
+        freq = 0;        // no clock running to start
+        lreg = 0;
+        ptr = 0;
+        marked = 0;
+        running = 0;
+        trigd = 0;
+        done = 0;
+        rle = 0;
+        lvltrig = 0;
+        tmask = 0;
+        tval = 0;
+        lastmatch = 0;
+        hreq = 0;
+        pre = 0;
+        post = 0;
+        wptr = 0;
+        trigidx = 0;
+        filled = 0;
+        runlen = 0;
+        cwen = 0;
+    end
+
+
+    always @(posedge clk)
+    begin
+        // Get the half rate clock
+        if (lclk)
+            lreg <= ~lreg;
+
+        // Bring the channels into our clock domain
+        meta <= {tap,pins};
+        smp <= meta;
+
+        // Latch the registers and handle the RAM address pointer
+        if (mywrite)
+        begin
+            if (addr[3:0] == 5)
+                freq <= datin[3:0];
+            if (addr[3:0] == 6)
+            begin
+                rle <= datin[0];
+                lvltrig <= datin[1];
+            end
+            if (addr[3:0] == 7)
+                tmask <= datin;
+            if (addr[3:0] == 8)
+                tval <= datin;
+            if (addr[3:0] == 9)
+                pre[9:8] <= datin[1:0];
+            if (addr[3:0] == 10)
+                pre[7:0] <= datin;
+            if (addr[3:0] == 11)
+                post[9:8] <= datin[1:0];
+            if (addr[3:0] == 12)
+                post[7:0] <= datin;
+            if (addr[3:0] == 13)
+                ptr[10:8] <= datin[2:0];
+            if (addr[3:0] == 14)
+                ptr[7:0] <= datin;
+        end
+        if (strobe && myaddr && rdwr && (addr[3:0] == 15))   // auto-increment on data read
+            ptr <= ptr + 11'h001;
+
+        // Clear the autosend once the host reads the entry count
+        if (strobe && myaddr && rdwr && (addr[3:0] == 4))
+            marked <= 0;
+
+        // Arm, stop, or trigger from the host
+        if (mywrite && (addr[3:0] == 0) && datin[0])
+        begin
+            running <= 1;
+            trigd <= 0;
+            done <= 0;
+            marked <= 0;
+            hreq <= 0;
+            wptr <= 0;
+            filled <= 0;
+            cur <= smp;
+            runlen <= 0;
+            lastmatch <= 1;      // the first sample is not an edge
+        end
+        else if (hstop)         // the open run is written below
+        begin
+            running <= 0;
+            done <= 1;
+            marked <= 1;
+            wptr <= wptr + 10'h001;
+            if (filled != 11'h400)
+                filled <= filled + 11'h001;
+        end
+        else if (running && tick)
+        begin
+            lastmatch <= match;
+            if (newent)
+            begin
+                wptr <= wptr + 10'h001;
+                cur <= smp;
+                runlen <= 0;
+                if (filled != 11'h400)
+                    filled <= filled + 11'h001;
+                if (trigd && (wptr == (trigidx + post)))
+                begin
+                    running <= 0;
+                    done <= 1;
+                    marked <= 1;
+                end
+            end
+            else
+                runlen <= runlen + 8'h01;
+            if (~trigd && trigcond && (filled >= {1'b0,pre}))
+            begin
+                trigd <= 1;
+                hreq <= 0;
+                trigidx <= (newent) ? (wptr + 10'h001) : wptr;
+            end
+        end
+        if (mywrite && (addr[3:0] == 0) && datin[1] && ~datin[0])
+            hreq <= 1;
+
+        // Write the closed run to the RAM on the next clock
+        cwen <= hstop || (running && tick && newent);
+        caddr <= wptr;
+        cdata <= {cur,runlen};
+    end
+
+    // Close the run on each sample without RLE, else on a change or full run
+    assign newent = ~rle || (smp != cur) || (runlen == 8'hff);
+    assign match = (((smp ^ tval) & tmask) == 8'h00);
+    assign trigcond = hreq || (tmask == 8'h00) ||
+                      (match && (lvltrig || ~lastmatch));
+
+    assign mywrite = (strobe && myaddr && ~rdwr); // latch data on a write
+    assign hstop = running && mywrite && (addr[3:0] == 0) && datin[2] && ~datin[0];
+
+    assign myaddr = (addr[11:8] == our_addr) && (addr[7:4] == 0);
+    assign datout = (~myaddr) ? datin :
+                    (~strobe && marked) ? 8'h05 :     // send regs 0-4
+                    (~strobe) ? 8'h00 :
+                    (addr[3:0] == 0) ? {5'h00,done,trigd,running} :
+                    (addr[3:0] == 1) ? {6'h00,trigidx[9:8]} :
+                    (addr[3:0] == 2) ? trigidx[7:0] :
+                    (addr[3:0] == 3) ? {5'h00,filled[10:8]} :
+                    (addr[3:0] == 4) ? filled[7:0] :
+                    (addr[3:0] == 5) ? {4'h0,freq} :
+                    (addr[3:0] == 6) ? {6'h00,lvltrig,rle} :
+                    (addr[3:0] == 7) ? tmask :
+                    (addr[3:0] == 8) ? tval :
+                    (addr[3:0] == 9) ? {6'h00,pre[9:8]} :
+                    (addr[3:0] == 10) ? pre[7:0] :
+                    (addr[3:0] == 11) ? {6'h00,post[9:8]} :
+                    (addr[3:0] == 12) ? post[7:0] :
+                    (addr[3:0] == 13) ? {5'h00,ptr[10:8]} :
+                    (addr[3:0] == 14) ? ptr[7:0] :
+                    (addr[3:0] == 15) ? hdout :
+                    8'h00 ; 
+
+    // Loop in-to-out where appropriate
+    assign busy_out = busy_in;
+    assign addr_match_out = myaddr | addr_match_in;
+
+endmodule
+
+
+//
+// A wrapper around a dual port Xilinx RAM block.  Port A is a byte wide
+// read port for the host and port B is a 16 bit write port for capture.
+module laram2kx8(clk, haddr, hdout, caddr, cdin, cwen);
+    input clk;
+    input [10 : 0] haddr;
+    output [7 : 0] hdout;
+    input [9 : 0] caddr;
+    input [15 : 0] cdin;
+    input cwen;
+
+    wire DOPA;
+    wire [1:0] DOPB;
+    wire [15:0] DOB;
+    RAMB16_S9_S18 #(
+        .INIT_A(9'h000),  // Value of output RAM registers on Port A at startup
+        .INIT_B(18'h00000), // Value of output RAM registers on Port B at startup
+        .SRVAL_A(9'h000), // Port A output value upon SSR assertion
+        .SRVAL_B(18'h00000), // Port B output value upon SSR assertion
+        .WRITE_MODE_A("WRITE_FIRST"), // WRITE_FIRST, READ_FIRST or NO_CHANGE
+        .WRITE_MODE_B("WRITE_FIRST"), // WRITE_FIRST, READ_FIRST or NO_CHANGE
+        .SIM_COLLISION_CHECK("NONE")  // "NONE", "WARNING_ONLY", "GENERATE_X_ONLY", "ALL"
+       ) RAMB16_S9_S18_inst (
+          .DOA(hdout),    // Port A 8-bit Data Output
+          .DOB(DOB),      // Port B 16-bit Data Output
+          .DOPA(DOPA),    // Port A 1-bit Parity Output
+          .DOPB(DOPB),    // Port B 2-bit Parity Output
+          .ADDRA(haddr),  // Port A 11-bit Address Input
+          .ADDRB(caddr),  // Port B 10-bit Address Input
+          .CLKA(clk),     // Port A Clock
+          .CLKB(clk),     // Port B Clock
+          .DIA(8'h00),    // Port A 8-bit Data Input
+          .DIB(cdin),     // Port B 16-bit Data Input
+          .DIPA(1'b0),    // Port A 1-bit parity Input
+          .DIPB(2'b00),   // Port B 2-bit parity Input
+          .ENA(1'b1),     // Port A RAM Enable Input
+          .ENB(1'b1),     // Port B RAM Enable Input
+          .SSRA(1'b0),    // Port A Synchronous Set/Reset Input
+          .SSRB(1'b0),    // Port B Synchronous Set/Reset Input
+          .WEA(1'b0),     // Port A Write Enable Input
+          .WEB(cwen)      // Port B Write Enable Input
+       );
+
+endmodule
+
@@ -32,7 +32,25 @@
 //  File: lcd6.v;   Six digit 7-segment LCD display (on out24 card)
 //
 //  Registers: (8 bit)
-//      Reg 0:  FIFO with data for the LCD.
+//      Reg 0-63:   Base pattern RAM for the LCD.  See below.
+//      Reg 64-69:  Digit framebuffer, leftmost digit first.  A write is
+//                  encoded to segments as set by the encoding register.
+//                  A read gives the segments of the digit.
+//      Reg 72:     Encoding of framebuffer writes
+//                      0: raw segments.  Bit 0 is segment a, bit 6 is
+//                         segment g, and bit 7 is the decimal point.
+//                      1: hexadecimal digit in the low four bits
+//                      2: ASCII character.  Letters are shown as well
+//                         as seven segments allow and lower case is
+//                         shown as upper case.
+//      Reg 73:     Blink mask.  Bit 0 blinks the leftmost digit.
+//      Reg 74:     Decimal point mask.  Bit 0 is the leftmost digit.
+//      Reg 75:     Blink half period in units of 100 ms.  Default 5.
+//                  Zero turns blinking off for all digits.
+//      Reg 76:     COM of base pattern groups 0-3, two bits each, group
+//                  0 in bits 1-0.  COM1=0, COM25=1, COM50=2, none=3.
+//      Reg 77:     COM of base pattern groups 4-5 in bits 3-0.
+//      Reg 128-223: Segment map.  See below.
 //
 //
 //  HOW THIS WORKS
@@ -125,6 +143,26 @@
 // high, mid, and low bytes on the out24) and is 48 bits deep.
 // It is up to the Linux device driver to determine the bit
 // pattern that is stored in the FIFO.
+//
+// The digit framebuffer removes the need for the driver to
+// recompute the pattern on every change.  The driver loads a
+// base pattern with every segment off, and the COM and AC
+// levels as before.  Each group of eight RAM locations is one
+// latch of the out24 outputs and drives one COM.  As each bit is
+// shifted out a segment map gives, for each of the high, mid, and
+// low bytes, the digit and segment on that output at the group's
+// COM.  If that segment is on the base bit is inverted.  Since
+// an on segment is always the inverse of an off segment this
+// works for both AC polarities.  Blinking and decimal points are
+// applied to the framebuffer as it is shifted out so they cost
+// no host traffic.
+//    The segment map is at 128 + 32*byte + 8*COM + bit where byte
+// is 0 for high, 1 for mid, and 2 for low, and bit 0 is the first
+// bit shifted out (the 'h' output on the 74595).  Each entry is
+// the digit (0-5) in bits 5-3 and the segment (a=0 to dp=7) in
+// bits 2-0.  A digit of 7 means no segment.  The map starts with
+// the pin-out in the table above, with pin 17 taken as mg and pin
+// 18 as mh.
 // 
 /////////////////////////////////////////////////////////////////////////
 module lcd6(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
@@ -155,6 +193,8 @@ module lcd6(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
 
     // Addressing and bus interface lines 
     wire   myaddr;           // ==1 if a correct read/write on our address
+    wire   mywrite;          // ==1 if a write to one of our registers
+    wire   rawaddr;          // ==1 if host access to the base pattern RAM
     wire   [2:0] rout;       // RAM output lines
     wire   [5:0] raddr;      // RAM address lines
     wire   wen;              // RAM write enable
@@ -162,11 +202,70 @@ module lcd6(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     lcdram64x1 ram1(rout[1],raddr,datin[1],clk,wen);   // mid byte on the out24 card
     lcdram64x1 ram2(rout[0],raddr,datin[0],clk,wen);   // low byte on the out24 card
 
+    // Digit framebuffer and segment map
+    reg    [7:0] dseg[5:0];  // segments of each digit, a in bit 0
+    reg    [1:0] encmode;    // encoding of framebuffer writes
+    reg    [5:0] blink;      // digits to blink
+    reg    [5:0] dp;         // digits with the decimal point on
+    reg    [7:0] blinkper;   // blink half period in 100 ms units
+    reg    [9:0] bpre;       // prescale u100clk to 100 ms
+    reg    [7:0] bcnt;       // 100 ms ticks into the blink half period
+    reg    blinkoff;         // ==1 while blinking digits are blank
+    reg    [1:0] comsel[5:0];   // COM of each base pattern group
+    reg    [5:0] maph[31:0]; // digit and segment of the high byte outputs
+    reg    [5:0] mapm[31:0]; // digit and segment of the mid byte outputs
+    reg    [5:0] mapl[31:0]; // digit and segment of the low byte outputs
+    wire   [47:0] segs;      // segments as shown, digit 0 in the low byte
+    wire   [1:0] com;        // COM of the group being shifted out
+    wire   [5:0] mh;         // map entries for the bit being shifted out
+    wire   [5:0] mm;
+    wire   [5:0] ml;
+    wire   [2:0] segon;      // ==1 to invert the base bit
+    wire   [2:0] pat;        // base pattern with the segments applied
+    integer j;               // loop counter
+
 
     initial
     begin
         bst = 0;
         gst = 0;
+        encmode = 0;
+        blink = 0;
+        dp = 0;
+        blinkper = 5;
+        bpre = 0;
+        bcnt = 0;
+        blinkoff = 0;
+        for (j = 0; j < 6; j = j + 1)
+        begin
+            dseg[j] = 0;
+            comsel[j] = j / 2;
+        end
+        for (j = 0; j < 32; j = j + 1)
+        begin
+            maph[j] = 6'o70;
+            mapm[j] = 6'o70;
+            mapl[j] = 6'o70;
+        end
+        // Index is 8*COM + bit, entry is digit and segment in octal
+        maph[4] = 6'o04;   maph[20] = 6'o05;                      // hd
+        maph[3] = 6'o06;   maph[11] = 6'o03;   maph[19] = 6'o00;  // he
+        maph[2] = 6'o14;   maph[18] = 6'o15;                      // hf
+        maph[0] = 6'o16;   maph[8]  = 6'o13;   maph[16] = 6'o10;  // hh
+        maph[1] = 6'o12;   maph[9]  = 6'o17;   maph[17] = 6'o11;  // hg
+        maph[5] = 6'o02;   maph[13] = 6'o07;   maph[21] = 6'o01;  // hc
+        mapm[6] = 6'o24;   mapm[22] = 6'o25;                      // mb
+        mapm[5] = 6'o26;   mapm[13] = 6'o23;   mapm[21] = 6'o20;  // mc
+        mapm[4] = 6'o34;   mapm[20] = 6'o35;                      // md
+        mapm[3] = 6'o36;   mapm[11] = 6'o33;   mapm[19] = 6'o30;  // me
+        mapm[1] = 6'o44;   mapm[17] = 6'o45;                      // mg
+        mapm[0] = 6'o46;   mapm[8]  = 6'o43;   mapm[16] = 6'o40;  // mh
+        mapm[2] = 6'o32;   mapm[10] = 6'o37;   mapm[18] = 6'o31;  // mf
+        mapm[7] = 6'o22;   mapm[15] = 6'o27;   mapm[23] = 6'o21;  // ma
+        mapl[6] = 6'o54;   mapl[22] = 6'o55;                      // lb
+        mapl[4] = 6'o56;   mapl[12] = 6'o53;   mapl[20] = 6'o50;  // ld
+        mapl[5] = 6'o52;   mapl[21] = 6'o51;                      // lc
+        mapl[7] = 6'o42;   mapl[15] = 6'o47;   mapl[23] = 6'o41;  // la
     end
 
 
@@ -192,29 +291,158 @@ module lcd6(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                 gst <= 0;
             end
         end
+
+        // Framebuffer, blink, and segment map registers
+        if (mywrite && (addr[7:3] == 5'h08) && (addr[2:0] < 6))
+            dseg[addr[2:0]] <= (encmode == 0) ? datin :
+                               (encmode == 1) ? {1'b0, hexseg(datin[3:0])} :
+                                                {1'b0, asciiseg(datin[6:0])};
+        if (mywrite && (addr[7:0] == 72))
+            encmode <= datin[1:0];
+        if (mywrite && (addr[7:0] == 73))
+            blink <= datin[5:0];
+        if (mywrite && (addr[7:0] == 74))
+            dp <= datin[5:0];
+        if (mywrite && (addr[7:0] == 75))
+            blinkper <= datin;
+        if (mywrite && (addr[7:0] == 76))
+        begin
+            comsel[0] <= datin[1:0];
+            comsel[1] <= datin[3:2];
+            comsel[2] <= datin[5:4];
+            comsel[3] <= datin[7:6];
+        end
+        if (mywrite && (addr[7:0] == 77))
+        begin
+            comsel[4] <= datin[1:0];
+            comsel[5] <= datin[3:2];
+        end
+        if (mywrite && (addr[7:5] == 3'h4))
+            maph[addr[4:0]] <= datin[5:0];
+        if (mywrite && (addr[7:5] == 3'h5))
+            mapm[addr[4:0]] <= datin[5:0];
+        if (mywrite && (addr[7:5] == 3'h6))
+            mapl[addr[4:0]] <= datin[5:0];
+
+        // Toggle the blinking digits every blink half period.  A half
+        // period of zero turns blinking off and leaves the digits on.
+        if (blinkper == 8'h00)
+        begin
+            bcnt <= 0;
+            blinkoff <= 0;
+        end
+        else if (u100clk)
+        begin
+            bpre <= (bpre == 10'd999) ? 10'h000 : bpre + 10'h001;
+            if (bpre == 10'd999)
+            begin
+                if (bcnt >= blinkper - 8'h01)
+                begin
+                    bcnt <= 0;
+                    blinkoff <= ~blinkoff;
+                end
+                else
+                    bcnt <= bcnt + 8'h01;
+            end
+        end
     end
 
+    // Seven segment patterns for hex digits, segment a in bit 0
+    function [6:0] hexseg;
+        input [3:0] hex;
+        hexseg = (hex == 4'h0) ? 7'h3f : (hex == 4'h1) ? 7'h06 :
+                 (hex == 4'h2) ? 7'h5b : (hex == 4'h3) ? 7'h4f :
+                 (hex == 4'h4) ? 7'h66 : (hex == 4'h5) ? 7'h6d :
+                 (hex == 4'h6) ? 7'h7d : (hex == 4'h7) ? 7'h07 :
+                 (hex == 4'h8) ? 7'h7f : (hex == 4'h9) ? 7'h6f :
+                 (hex == 4'ha) ? 7'h77 : (hex == 4'hb) ? 7'h7c :
+                 (hex == 4'hc) ? 7'h39 : (hex == 4'hd) ? 7'h5e :
+                 (hex == 4'he) ? 7'h79 : 7'h71;
+    endfunction
+
+    // Seven segment patterns for ASCII.  Unknown characters are blank.
+    function [6:0] asciiseg;
+        input [6:0] ch;
+        reg   [6:0] uc;
+        begin
+            uc = ((ch >= 7'h61) && (ch <= 7'h7a)) ? (ch - 7'h20) : ch;
+            asciiseg =
+                ((uc >= 7'h30) && (uc <= 7'h39)) ? hexseg(uc[3:0]) :
+                (uc == "A") ? 7'h77 : (uc == "B") ? 7'h7c :
+                (uc == "C") ? 7'h39 : (uc == "D") ? 7'h5e :
+                (uc == "E") ? 7'h79 : (uc == "F") ? 7'h71 :
+                (uc == "G") ? 7'h3d : (uc == "H") ? 7'h76 :
+                (uc == "I") ? 7'h06 : (uc == "J") ? 7'h1e :
+                (uc == "K") ? 7'h75 : (uc == "L") ? 7'h38 :
+                (uc == "M") ? 7'h37 : (uc == "N") ? 7'h54 :
+                (uc == "O") ? 7'h5c : (uc == "P") ? 7'h73 :
+                (uc == "Q") ? 7'h67 : (uc == "R") ? 7'h50 :
+                (uc == "S") ? 7'h6d : (uc == "T") ? 7'h78 :
+                (uc == "U") ? 7'h3e : (uc == "V") ? 7'h1c :
+                (uc == "W") ? 7'h2a : (uc == "X") ? 7'h76 :
+                (uc == "Y") ? 7'h6e : (uc == "Z") ? 7'h5b :
+                (uc == "-") ? 7'h40 : (uc == "_") ? 7'h08 :
+                (uc == "=") ? 7'h48 : (uc == "\"") ? 7'h22 :
+                (uc == "'") ? 7'h02 : (uc == "[") ? 7'h39 :
+                (uc == "]") ? 7'h0f : (uc == "?") ? 7'h53 :
+                (uc == "^") ? 7'h23 : 7'h00;
+        end
+    endfunction
+
+    // The segments as shown with decimal points and blinking applied
+    assign segs = {dshow(dseg[5], dp[5], blink[5]), dshow(dseg[4], dp[4], blink[4]),
+                   dshow(dseg[3], dp[3], blink[3]), dshow(dseg[2], dp[2], blink[2]),
+                   dshow(dseg[1], dp[1], blink[1]), dshow(dseg[0], dp[0], blink[0])};
+    function [7:0] dshow;
+        input [7:0] seg;
+        input dpon;
+        input blinkon;
+        dshow = (blinkon && blinkoff) ? 8'h00 : (seg | {dpon, 7'h00});
+    endfunction
+
+    // Invert the base bit for each output with an on segment at this COM
+    assign com = comsel[bst[5:3]];
+    assign mh = maph[{com, bst[2:0]}];
+    assign mm = mapm[{com, bst[2:0]}];
+    assign ml = mapl[{com, bst[2:0]}];
+    assign segon[2] = (com != 3) && (mh[5:3] < 6) && segs[mh];
+    assign segon[1] = (com != 3) && (mm[5:3] < 6) && segs[mm];
+    assign segon[0] = (com != 3) && (ml[5:3] < 6) && segs[ml];
+    assign pat = rout ^ segon;
 
     // assign RAM signals
-    assign wen   = (strobe & myaddr & ~rdwr);  // latch data on a write
-    assign raddr = (strobe & myaddr) ? addr[5:0] : bst ;
+    assign mywrite = (strobe & myaddr & ~rdwr);
+    assign rawaddr = (addr[7:6] == 0);
+    assign wen   = mywrite & rawaddr;  // latch data on a write
+    assign raddr = (strobe & myaddr & rawaddr) ? addr[5:0] : bst ;
 
     // Assign the outputs.
-    assign myaddr = (addr[11:8] == our_addr) && (addr[7:6] == 0);
+    assign myaddr = (addr[11:8] == our_addr) && (addr[7:5] != 3'h7);
     assign datout = (~myaddr) ? datin :
-                    (strobe) ? {5'h00,rout} : 
+                    (~strobe) ? 8'h00 :
+                    (rawaddr) ? {5'h00,rout} : 
+                    ((addr[7:3] == 5'h08) && (addr[2:0] < 6)) ? dseg[addr[2:0]] :
+                    (addr[7:0] == 72) ? {6'h00,encmode} :
+                    (addr[7:0] == 73) ? {2'h0,blink} :
+                    (addr[7:0] == 74) ? {2'h0,dp} :
+                    (addr[7:0] == 75) ? blinkper :
+                    (addr[7:0] == 76) ? {comsel[3],comsel[2],comsel[1],comsel[0]} :
+                    (addr[7:0] == 77) ? {4'h0,comsel[5],comsel[4]} :
+                    (addr[7:5] == 3'h4) ? {2'h0,maph[addr[4:0]]} :
+                    (addr[7:5] == 3'h5) ? {2'h0,mapm[addr[4:0]]} :
+                    (addr[7:5] == 3'h6) ? {2'h0,mapl[addr[4:0]]} :
                     8'h00 ; 
 
     // Loop in-to-out where appropriate
     assign busy_out = busy_in;
     assign addr_match_out =  myaddr | addr_match_in;
 
-    assign pin8 = ((((gst == 2) | (gst == 3)) & rout[1]) |
-                   (((gst == 4) | (gst == 5) | (gst == 6)) & rout[0]));
+    assign pin8 = ((((gst == 2) | (gst == 3)) & pat[1]) |
+                   (((gst == 4) | (gst == 5) | (gst == 6)) & pat[0]));
     assign pin6 = (gst == 1) | (gst == 2) | (gst == 3) |
                   (gst == 4) | (gst == 6) | (gst == 8);
     assign pin4 = (gst == 3);
-    assign pin2 = (gst == 7) | (gst ==8) | (((gst == 2) | (gst == 3)) & rout[2]);
+    assign pin2 = (gst == 7) | (gst ==8) | (((gst == 2) | (gst == 3)) & pat[2]);
 
 endmodule
 
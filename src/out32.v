@@ -50,6 +50,29 @@
 //      Reg 13:  As above for pins 10 and 26.
 //      Reg 14:  As above for pins  9 and 25.
 //      Reg 15:  As above for pins  8 and 24.
+//      Reg 16-19: Packed output value, pins 31-24 in Reg 16 and pins
+//               7-0 in Reg 19.  The outputs are loaded on the write to
+//               Reg 19.  A read gives the current outputs.  Bytes not
+//               written since the last Reg 19, 23, 27 or 31 write are
+//               zero, so a write of Reg 19 alone uses only pins 7-0.
+//      Reg 20-23: As above but sets the outputs that are set in the mask
+//      Reg 24-27: As above but clears the outputs that are set in the mask
+//      Reg 28-31: As above but toggles the outputs that are set in the mask
+//      Reg 32-35: PWM enable mask in the same order as the outputs
+//      Reg 36-39: Blink enable mask in the same order as the outputs
+//      Reg 40:  Blink step time in units of 10 ms, minus one
+//      Reg 64-95: PWM level or blink pattern for pins 0 to 31
+//
+//  An output that is set and has PWM enabled is on for level/256 of
+//  each PWM cycle.  An output that is set and has blink enabled
+//  follows its 8 bit pattern, one bit per blink step starting with
+//  bit 0.  While any output has PWM or blink enabled the 595 chain
+//  is refreshed continuously, about every 3.4 microseconds.  A PWM
+//  cycle is 256 refreshes, or a PWM rate of about 1.1 KHz.
+//
+//  Writes to Reg 0-14 and to the first three bytes of a packed
+//  register do not change the outputs.  This lets the host change
+//  many outputs at once.
 //
 //
 //  HOW THIS WORKS
@@ -111,39 +134,123 @@ module out32(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     // State variables
     reg    [3:0] bst;        // Bit number for current card access (0-15)
     reg    [2:0] gst;        // global state for xfer from card (0-5)
-    reg    dataready;        // set=1 to wait for an autosend to host
-    reg    changepending;    // set=1 while finishing all 16 bits to then set dataready
+    reg    [31:0] outval;    // output values, bit n is pin n
+    reg    [23:0] mword;     // first three bytes of a packed write
+    reg    [31:0] pwmen;     // PWM enable mask
+    reg    [31:0] blinken;   // blink enable mask
+    reg    [7:0] lslevel [15:0]; // PWM level or blink pattern, pins 0-15
+    reg    [7:0] mslevel [15:0]; // PWM level or blink pattern, pins 16-31
+    reg    [7:0] pwmph;      // PWM phase, one count per refresh
+    reg    [9:0] blinkpre;   // prescale u10clk to 10 ms
+    reg    [7:0] blinkrate;  // blink step time in 10 ms units
+    reg    [7:0] blinkcnt;   // counts blink step time
+    reg    [2:0] blinkph;    // blink phase, selects the pattern bit
+    integer i;               // loop counter
 
     // Addressing and bus interface lines 
     wire   myaddr;           // ==1 if a correct read/write on our address
-    wire   [1:0] rout;       // RAM output lines
-    wire   [1:0] ramedge;    // Edge transition output info
-    wire   [3:0] raddr;      // RAM address lines
-    wire   [1:0] rin;        // RAM input lines
-    wire   wen;              // RAM write enable
-    out32_16x1 out32_ms(rout[1],raddr,rin[1],clk,wen);   // MS word
-    out32_16x1 out32_ls(rout[0],raddr,rin[0],clk,wen);   // LS word
+    wire   mywrite;          // ==1 on a host write to us
+    wire   start;            // ==1 to start a new transfer
+    wire   refresh;          // ==1 if the chain is refreshed continuously
+    wire   [3:0] lspin;      // pin in the LS word for the current bit
+    wire   [3:0] hpin;       // pin in the LS word for a legacy register
+    wire   [31:0] mval;      // value of a packed write
+    wire   [31:0] bytemask;  // bits of the byte selected by addr[1:0]
+    wire   [7:0] lslvl;      // level of the LS pin for the current bit
+    wire   [7:0] mslvl;      // level of the MS pin for the current bit
+    wire   lsbit;            // LS data for the current bit
+    wire   msbit;            // MS data for the current bit
 
 
     initial
     begin
         gst = 0;
-        bst = 0;
-        dataready = 0;
-        changepending = 0;
+        bst = 15;
+        outval = 32'h00000000;
+        mword = 24'h000000;
+        pwmen = 32'h00000000;
+        blinken = 32'h00000000;
+        pwmph = 8'h00;
+        blinkpre = 10'h000;
+        blinkrate = 8'h00;
+        blinkcnt = 8'h00;
+        blinkph = 3'h0;
+        for (i = 0; i < 16; i = i + 1)
+        begin
+            lslevel[i] = 8'h00;
+            mslevel[i] = 8'h00;
+        end
     end
 
     always @(posedge clk)
     begin
-        // Start transfer when host writes to the last address
-        if (strobe && myaddr && ~rdwr && (addr[3:0] == 15))
+        // host writes
+        if (mywrite)
+        begin
+            if (addr[7:4] == 4'h0)
+            begin
+                // legacy registers, two pins each
+                outval[hpin] <= datin[0];
+                outval[{1'b1,hpin}] <= datin[1];
+            end
+            else if (addr[7:5] == 3'h0)
+            begin
+                // packed value, set, clear, and toggle
+                if (addr[1:0] != 2'h3)
+                    mword[8*(2-addr[1:0]) +: 8] <= datin;
+                else
+                begin
+                    if (addr[3:2] == 2'h0)
+                        outval <= mval;
+                    else if (addr[3:2] == 2'h1)
+                        outval <= outval | mval;
+                    else if (addr[3:2] == 2'h2)
+                        outval <= outval & ~mval;
+                    else
+                        outval <= outval ^ mval;
+                    mword <= 24'h000000;   // next packed write starts clean
+                end
+            end
+            else if (addr[7:2] == 6'h08)
+                pwmen <= (pwmen & ~bytemask) | ({datin,datin,datin,datin} & bytemask);
+            else if (addr[7:2] == 6'h09)
+                blinken <= (blinken & ~bytemask) | ({datin,datin,datin,datin} & bytemask);
+            else if (addr[7:0] == 8'd40)
+                blinkrate <= datin;
+            else if ((addr[7:5] == 3'h2) && (addr[4] == 1'b0))
+                lslevel[addr[3:0]] <= datin;
+            else if (addr[7:5] == 3'h2)
+                mslevel[addr[3:0]] <= datin;
+        end
+
+        // blink phase
+        if (u10clk)
+        begin
+            if (blinkpre == 10'd999)
+            begin
+                blinkpre <= 10'h000;
+                if (blinkcnt == blinkrate)
+                begin
+                    blinkcnt <= 8'h00;
+                    blinkph <= blinkph + 3'h1;
+                end
+                else
+                    blinkcnt <= blinkcnt + 8'h01;
+            end
+            else
+                blinkpre <= blinkpre + 10'h001;
+        end
+
+        // Start transfer when host changes the outputs
+        if (start)
         begin
             // start shifting bits
             gst <= 0;
+            bst <= 15;
         end
 
         // if not reading/writing from host
-        else if (~(strobe && myaddr && ~rdwr))
+        else if (~mywrite)
         begin
             if (gst < 2)
             begin
@@ -165,6 +272,12 @@ module out32(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                 // data latch
                 gst <= gst + 3'h1;
             end
+            else if (refresh)
+            begin
+                // refresh PWM and blinking outputs
+                gst <= 0;
+                pwmph <= pwmph + 8'h01;
+            end
             else
             begin
                 // wait for another host write
@@ -175,47 +288,49 @@ module out32(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     // assign the outputs
     assign pin4 = (gst == 3);
     assign pin6 = ((gst == 1) || (gst == 2) || (gst == 3) || (gst == 5) || (gst == 7));
-    assign pin2 = ((((gst == 2) || (gst == 3)) && rout[1]) || (gst == 4) || (gst == 5));
-    assign pin8 = (((gst == 2) || (gst == 3)) && rout[0]);
+    assign pin2 = ((((gst == 2) || (gst == 3)) && msbit) || (gst == 4) || (gst == 5));
+    assign pin8 = (((gst == 2) || (gst == 3)) && lsbit);
+
+    // Bits are shifted out starting with pins 7 and 23
+    assign lspin = {bst[3], ~bst[2:0]};
+    assign lslvl = lslevel[lspin];
+    assign mslvl = mslevel[lspin];
+    assign lsbit = outval[{1'b0,lspin}] &
+                   ((blinken[{1'b0,lspin}]) ? lslvl[blinkph] :
+                    (pwmen[{1'b0,lspin}]) ? (pwmph < lslvl) : 1'b1);
+    assign msbit = outval[{1'b1,lspin}] &
+                   ((blinken[{1'b1,lspin}]) ? mslvl[blinkph] :
+                    (pwmen[{1'b1,lspin}]) ? (pwmph < mslvl) : 1'b1);
+    assign refresh = (pwmen != 0) || (blinken != 0);
 
-    // assign RAM signals
-    assign myaddr = (addr[11:8] == our_addr) && (addr[7:4] == 0);
-    assign wen = (strobe & myaddr & ~rdwr);
-    assign raddr = (strobe & myaddr) ? addr[3:0] : bst;
-    assign rin[1] = (strobe & myaddr & ~rdwr) ? datin[1] : rout[1];
-    assign rin[0] = (strobe & myaddr & ~rdwr) ? datin[0] : rout[0];
-    assign datout = (strobe & myaddr & rdwr) ? {6'h00,rout} : datin; 
+    // assign host signals
+    assign myaddr = (addr[11:8] == our_addr) &&
+                    ((addr[7:6] == 2'h0) || (addr[7:5] == 3'h2));
+    assign mywrite = strobe & myaddr & ~rdwr;
+    assign start = mywrite && ~((addr[7:4] == 4'h0) && (addr[3:0] != 4'hf)) &&
+                              ~((addr[7:5] == 3'h0) && (addr[1:0] != 2'h3));
+    assign hpin = {addr[3], ~addr[2:0]};
+    assign mval = {mword, datin};
+    assign bytemask = (addr[1:0] == 2'h0) ? 32'hff000000 :
+                      (addr[1:0] == 2'h1) ? 32'h00ff0000 :
+                      (addr[1:0] == 2'h2) ? 32'h0000ff00 : 32'h000000ff;
+    assign datout = (~(strobe & myaddr & rdwr)) ? datin :
+                    (addr[7:4] == 4'h0) ? {6'h00,outval[{1'b1,hpin}],outval[{1'b0,hpin}]} :
+                    (addr[7:5] == 3'h0) ? ((addr[1:0] == 2'h0) ? outval[31:24] :
+                                           (addr[1:0] == 2'h1) ? outval[23:16] :
+                                           (addr[1:0] == 2'h2) ? outval[15:8] : outval[7:0]) :
+                    (addr[7:2] == 6'h08) ? ((addr[1:0] == 2'h0) ? pwmen[31:24] :
+                                            (addr[1:0] == 2'h1) ? pwmen[23:16] :
+                                            (addr[1:0] == 2'h2) ? pwmen[15:8] : pwmen[7:0]) :
+                    (addr[7:2] == 6'h09) ? ((addr[1:0] == 2'h0) ? blinken[31:24] :
+                                            (addr[1:0] == 2'h1) ? blinken[23:16] :
+                                            (addr[1:0] == 2'h2) ? blinken[15:8] : blinken[7:0]) :
+                    (addr[7:0] == 8'd40) ? blinkrate :
+                    (addr[7:5] == 3'h2) ? ((addr[4]) ? mslevel[addr[3:0]] : lslevel[addr[3:0]]) :
+                    8'h00;
 
     // Loop in-to-out where appropriate
     assign busy_out = busy_in;
     assign addr_match_out = myaddr | addr_match_in;
 
 endmodule
-
-
-module out32_16x1(dout,addr,din,wclk,clken);
-    output dout;
-    input  [3:0] addr;
-    input  din;
-    input  wclk;
-    input  clken;
-
-    // RAM16X1S_1: 16 x 1 positive edge write, asynchronous read single-port distributed RAM
-    //             Spartan-3E
-    // Xilinx HDL Libraries Guide, version 12.1
-
-    RAM16X1S #(
-    ) RAM16X1S_inst (
-       .O(dout),        // 1-bit data output
-       .A0(addr[0]),    // Address[0] input bit
-       .A1(addr[1]),    // Address[1] input bit
-       .A2(addr[2]),    // Address[2] input bit
-       .A3(addr[3]),    // Address[3] input bit
-       .D(din),         // 1-bit data input
-       .WCLK(wclk),     // Write clock input
-       .WE(clken)       // Write enable input
-    );
-endmodule
-
-
-
@@ -29,16 +29,59 @@
 
 //////////////////////////////////////////////////////////////////////////
 //
-//  File: out4.v;   Simple 4 bit output port
+//  File: out4.v;   Four bit output port with one-shots and a sequencer
+//
+//  The out4 is a four bit output port.  With the parameter TIMERS set,
+//  as in the out4t and out4lt, each output also has a one-shot timer
+//  that inverts the output for an exact number of time units and then
+//  restores it.  A relay pulse or timed valve opening is a single write
+//  and the width does not depend on host or USB timing.
+//      With TIMERS set a sixteen step sequence table can also drive all
+//  four outputs.  Each step has a four bit value and a duration of 1 to
+//  4096 units.  The sequence runs from step 0 to the last step and then
+//  either loops or stops.  When it stops at the last step, or when the
+//  host clears run, the outputs hold the value of the step it was on.
+//  The one-shots invert the output whether it comes from the data
+//  register or from the sequence.
+//      Without TIMERS only register 0 is present.  This keeps the out4,
+//  aamp, drv4, and hub4 at their original size.  The out4l, used for
+//  relays, is an out4 with all outputs low at power on.  The out4
+//  starts with all outputs high.
 //
 //  Registers are
-//    Addr=0    Data out
+//    Addr=0    Data out.  A write stops the sequence and cancels any
+//              one-shot pulses.
+//  Registers 1 to 63 are present only with TIMERS set.
+//    Addr=1    One-shot fire.  Writing a 1 to a bit starts a pulse on
+//              that output, or restarts it if already running.  A read
+//              gives a 1 for each output with a pulse in progress.
+//    Addr=2    One-shot time units, two bits per output.  Bits 1-0 are
+//              for output 0.  0=1us, 1=10us, 2=100us, 3=1ms
+//    Addr=3    Sequence time unit in bits 1-0.  Same units as above.
+//    Addr=4    Sequence control
+//                  bits 3-0: last step of the sequence
+//                  bit 4:    loop back to step 0 after the last step
+//                  bit 5:    run.  Write a 1 to start the sequence at
+//                            step 0 or a 0 to stop it.  A read gives 1
+//                            while the sequence is running.
+//    Addr=8-15 One-shot width in units, 16 bits per output, high byte
+//              first.  Output 0 is at 8 and 9.  A width of zero gives
+//              no pulse.
+//    Addr=32-63  Sequence table.  Step n is at 32+2n and 33+2n, high
+//              byte first:
+//                  byte 0:  bits 7-4: output value for the step
+//                           bits 3-0: high 4 bits of (duration - 1)
+//                  byte 1:  low 8 bits of (duration - 1)
 //
 // NOTES:
+//    The one-shot and sequence timers prescale the 20 MHz system clock
+//    and restart on a fire or start, so widths are exact to a clock.
 //
 /////////////////////////////////////////////////////////////////////////
 module out4(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
        addr_match_in,addr_match_out,datin,datout,bitout);
+    parameter INITVAL = 4'hf;   // output value at power on
+    parameter TIMERS = 0;       // ==1 for the one-shots and sequencer
     input  clk;              // system clock
     input  rdwr;             // direction of this transfer. Read=1; Write=0
     input  strobe;           // true on full valid command
@@ -53,28 +96,165 @@ module out4(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     output [3:0] bitout;     // Simple binary output
  
     wire   myaddr;           // ==1 if a correct read/write on our address
+    wire   mywrite;          // ==1 if a write to one of our registers
     reg    [3:0] val;        // Output values
+    integer j;               // loop counter
+
+    // One-shot timers
+    reg    [3:0] osact;      // ==1 while a pulse is in progress
+    reg    [7:0] osunit;     // Time unit, two bits per output
+    reg    [7:0] oswhi[3:0];     // Pulse width in units, high byte
+    reg    [7:0] oswlo[3:0];     // Pulse width in units, low byte
+    reg    [15:0] oscnt[3:0];    // Units left in the pulse
+    reg    [14:0] ospre[3:0];    // Clocks into the current unit
+
+    // Sequencer
+    reg    [7:0] seqhi[15:0];    // Step value and high duration bits
+    reg    [7:0] seqlo[15:0];    // Step duration, low byte
+    reg    [1:0] sequnit;    // Sequence time unit
+    reg    [3:0] seqlast;    // Last step of the sequence
+    reg    seqloop;          // ==1 to loop at the last step
+    reg    seqrun;           // ==1 while the sequence runs
+    reg    [3:0] step;       // Current step
+    reg    [11:0] seqcnt;    // Units into the current step
+    reg    [14:0] seqpre;    // Clocks into the current unit
+    wire   [15:0] curstep;   // The current step's table entry
+    wire   [14:0] seqlen;    // Clocks per sequence unit
 
     initial
     begin
-        val = 4'hf;          // all ones to match power on default
+        val = INITVAL;       // all ones for out4, all zeros for out4l
+        osact = 0;
+        osunit = 0;
+        sequnit = 0;
+        seqlast = 0;
+        seqloop = 0;
+        seqrun = 0;
+        step = 0;
+        seqcnt = 0;
+        seqpre = 0;
     end
 
     always @(posedge clk)
     begin
-        if (strobe & myaddr & ~rdwr)  // latch data on a write
+        if (mywrite && (addr[5:0] == 0))  // latch data on a write
+        begin
+            val <= datin[3:0];
+            seqrun <= 0;
+        end
+
+        if (TIMERS != 0)
         begin
-            if (addr[0] == 0)
-                val <= datin[3:0];
+            if (mywrite)  // latch the timer registers
+            begin
+                if (addr[5:0] == 2)
+                    osunit <= datin;
+                if (addr[5:0] == 3)
+                    sequnit <= datin[1:0];
+                if (addr[5:0] == 4)
+                begin
+                    if (seqrun && ~datin[5])   // hold the current step on a stop
+                        val <= curstep[15:12];
+                    seqlast <= datin[3:0];
+                    seqloop <= datin[4];
+                    seqrun <= datin[5];
+                    step <= 0;
+                    seqcnt <= 0;
+                    seqpre <= 0;
+                end
+                if ((addr[5:3] == 1) && (addr[0] == 0))
+                    oswhi[addr[2:1]] <= datin;
+                if ((addr[5:3] == 1) && (addr[0] == 1))
+                    oswlo[addr[2:1]] <= datin;
+                if ((addr[5] == 1) && (addr[0] == 0))
+                    seqhi[addr[4:1]] <= datin;
+                if ((addr[5] == 1) && (addr[0] == 1))
+                    seqlo[addr[4:1]] <= datin;
+            end
+
+            // Run the one-shots.  A fire restarts the pulse, a data write cancels it.
+            for (j = 0; j < 4; j = j + 1)
+            begin
+                if (mywrite && (addr[5:0] == 0))
+                    osact[j] <= 0;
+                else if (mywrite && (addr[5:0] == 1) && datin[j])
+                begin
+                    osact[j] <= ({oswhi[j],oswlo[j]} != 0);
+                    oscnt[j] <= {oswhi[j],oswlo[j]};
+                    ospre[j] <= 0;
+                end
+                else if (osact[j])
+                begin
+                    if (ospre[j] == unitlen(osunit[2*j +: 2]))
+                    begin
+                        ospre[j] <= 0;
+                        if (oscnt[j] == 1)
+                            osact[j] <= 0;
+                        oscnt[j] <= oscnt[j] - 16'h0001;
+                    end
+                    else
+                        ospre[j] <= ospre[j] + 15'h0001;
+                end
+            end
+
+            // Step through the sequence table.  Hold the last value at the end.
+            if (seqrun && ~(mywrite && ((addr[5:0] == 0) || (addr[5:0] == 4))))
+            begin
+                if (seqpre == seqlen)
+                begin
+                    seqpre <= 0;
+                    if (seqcnt == curstep[11:0])
+                    begin
+                        seqcnt <= 0;
+                        if (step != seqlast)
+                            step <= step + 4'h1;
+                        else if (seqloop)
+                            step <= 0;
+                        else
+                        begin
+                            seqrun <= 0;
+                            val <= curstep[15:12];
+                        end
+                    end
+                    else
+                        seqcnt <= seqcnt + 12'h001;
+                end
+                else
+                    seqpre <= seqpre + 15'h0001;
+            end
         end
     end
 
+    // Clocks per time unit less one
+    function [14:0] unitlen;
+        input [1:0] unit;
+        unitlen = (unit == 0) ? 15'd19 :
+                  (unit == 1) ? 15'd199 :
+                  (unit == 2) ? 15'd1999 : 15'd19999;
+    endfunction
+
+    assign curstep = {seqhi[step],seqlo[step]};
+    assign seqlen = unitlen(sequnit);
+
     // Assign the outputs.
-    assign bitout = val;
+    assign bitout = (TIMERS == 0) ? val : ((seqrun) ? curstep[15:12] : val) ^ osact;
+
+    assign mywrite = (strobe & myaddr & ~rdwr);
 
-    assign myaddr = (addr[11:8] == our_addr) && (addr[7:1] == 0);
+    assign myaddr = (addr[11:8] == our_addr) &&
+                    ((TIMERS != 0) ? (addr[7:6] == 0) : (addr[7:1] == 0));
     assign datout = (~myaddr) ? datin : 
-                     (strobe && (addr[0] == 0)) ? {4'h0,val} :
+                     (~strobe) ? 8'h00 :
+                     (addr[5:0] == 0) ? {4'h0,val} :
+                     (TIMERS == 0) ? 8'h00 :
+                     (addr[5:0] == 1) ? {4'h0,osact} :
+                     (addr[5:0] == 2) ? osunit :
+                     (addr[5:0] == 3) ? {6'h00,sequnit} :
+                     (addr[5:0] == 4) ? {2'h0,seqrun,seqloop,seqlast} :
+                     ((addr[5:3] == 1) && (addr[0] == 0)) ? oswhi[addr[2:1]] :
+                     ((addr[5:3] == 1) && (addr[0] == 1)) ? oswlo[addr[2:1]] :
+                     ((addr[5] == 1) && (addr[0] == 0)) ? seqhi[addr[4:1]] :
+                     ((addr[5] == 1) && (addr[0] == 1)) ? seqlo[addr[4:1]] :
                      8'h00;
 
     // Loop in-to-out where appropriate
@@ -82,4 +262,3 @@ module out4(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     assign addr_match_out = myaddr | addr_match_in;
 
 endmodule
-
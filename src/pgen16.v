@@ -44,6 +44,20 @@
 //      outputs when the trigger count is reached in that step.
 //      
 //      Reg 32: Clk source in the lower 4 bits
+//      Reg 33: Trigger configuration
+//              bits 1-0: trigger mode
+//                  0: free running (default)
+//                  1: start.  Hold the outputs low at step 0 until a
+//                     trigger then run freely.  Any write re-arms.
+//                  2: gate.  Run while the trigger input is high and
+//                     hold the outputs low at step 0 while it is low.
+//                  3: re-phase.  Restart at step 0 on each trigger.
+//              bit 2:    trigger on the falling edge (or low level)
+//              bit 3:    host trigger.  Writing a 1 here is a trigger
+//
+//  The trigger input is an FPGA pin selected in perilist, for example
+//  "pgen16:17" uses PIN_17 which may belong to another slot.  The input
+//  goes through a two flip-flop synchronizer.
 //
 //  The clock source is selected by the lower 4 bits of register 32:
 //      0:  Off
@@ -66,7 +80,7 @@
 /////////////////////////////////////////////////////////////////////////
 module pgen16(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
        addr_match_in,addr_match_out,datin,datout,
-       m100clk,m10clk,m1clk,u100clk,u10clk,u1clk,n100clk,pattern);
+       m100clk,m10clk,m1clk,u100clk,u10clk,u1clk,n100clk,trig,pattern);
     input  clk;              // system clock
     input  rdwr;             // direction of this transfer. Read=1; Write=0
     input  strobe;           // true on full valid command
@@ -85,6 +99,7 @@ module pgen16(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     input  u10clk;           // 10 microsecond clock pulse
     input  u1clk;            // 1 microsecond clock pulse
     input  n100clk;          // 100 nanosecond clock pulse
+    input  trig;             // Trigger input
     output [3:0] pattern;    // out signals
 
 
@@ -106,6 +121,12 @@ module pgen16(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     reg    [3:0] freq;       // Input frequency selector
     reg    [3:0] state;      // Sequencer that counts 0 to 7
     reg    [3:0] patlatch;   // Latched values of the outputs
+    reg    [1:0] trigmode;   // free run, start, gate, or re-phase
+    reg    trigneg;          // ==1 to trigger on falling edge or low level
+    reg    [2:0] trigmeta;   // bring the trigger input into our clock domain
+    reg    armed;            // ==1 if waiting for a trigger in start mode
+    wire   trigevt;          // ==1 on a trigger edge or host trigger
+    wire   running;          // ==1 if the pattern is not held
 
 
     // Generate the clock source for the main counter
@@ -123,6 +144,9 @@ module pgen16(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     begin
         state = 0;
         freq = 0;        // no clock running to start
+        trigmode = 0;
+        trigneg = 0;
+        armed = 1;
     end
 
 
@@ -134,12 +158,30 @@ module pgen16(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
 
 
         // latch clock selector into flip-flops
-        if (strobe && ~rdwr && myaddr && (addr[5] == 1))
+        if (strobe && ~rdwr && myaddr && (addr[5] == 1) && (addr[0] == 0))
         begin
             freq <= datin[3:0];
         end
 
-        if (~(strobe & myaddr & ~rdwr))  // Only when the host is not writing our regs
+        // latch trigger config.  Re-arm on a write, disarm on a trigger
+        trigmeta <= {trigmeta[1:0],trig};
+        if (strobe && ~rdwr && myaddr && (addr[5] == 1) && (addr[0] == 1))
+        begin
+            trigmode <= datin[1:0];
+            trigneg <= datin[2];
+            armed <= ~datin[3];
+        end
+        else if (trigevt)
+            armed <= 0;
+
+        if (~running | ((trigmode == 3) & trigevt))
+        begin
+            main <= 0;
+            state <= 0;
+            if (~running)
+                patlatch <= 0;
+        end
+        else if (~(strobe & myaddr & ~rdwr))  // Only when the host is not writing our regs
         begin
             if ((freq == 1) ||
                  ((freq[0] == 0) && (lclk == 1)) ||
@@ -159,6 +201,14 @@ module pgen16(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     end
 
 
+    // Trigger edges from the pin or the host
+    assign trigevt = ((trigmeta[2:1] == 2'b01) & ~trigneg) |
+                     ((trigmeta[2:1] == 2'b10) & trigneg) |
+                     (strobe & ~rdwr & myaddr & (addr[5] == 1) & (addr[0] == 1) & datin[3]);
+    assign running = (trigmode == 0) || (trigmode == 3) ||
+                     ((trigmode == 1) && ~armed) ||
+                     ((trigmode == 2) && (trigmeta[1] ^ trigneg));
+
     // Assign the outputs.
     assign pattern[0] = patlatch[0];
     assign pattern[1] = patlatch[1];
@@ -172,7 +222,8 @@ module pgen16(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
 
     assign myaddr = (addr[11:8] == our_addr) && (addr[7:6] == 0);
     assign datout = (~myaddr) ? datin :
-                    (strobe && (addr[5] == 1)) ? {4'h0,freq} :
+                    (strobe && (addr[5] == 1) && (addr[0] == 0)) ? {4'h0,freq} :
+                    (strobe && (addr[5] == 1)) ? {5'h00,trigneg,trigmode} :
                     (strobe && (addr[0] == 0)) ? doutl : 
                     (strobe && (addr[0] == 1)) ? {4'h0,douth} : 
                     8'h00 ; 
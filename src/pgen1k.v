@@ -0,0 +1,403 @@
+// *********************************************************
+// Copyright (c) 2026 Demand Peripherals, Inc.
+// 
+// This file is licensed separately for private and commercial
+// use.  See LICENSE.txt which should have accompanied this file
+// for details.  If LICENSE.txt is not available please contact
+// support@demandperipherals.com to receive a copy.
+// 
+// In general, you may use, modify, redistribute this code, and
+// use any associated patent(s) as long as
+// 1) the above copyright is included in all redistributions,
+// 2) this notice is included in all source redistributions, and
+// 3) this code or resulting binary is not sold as part of a
+//    commercial product.  See LICENSE.txt for definitions.
+// 
+// DPI PROVIDES THE SOFTWARE "AS IS," WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING
+// WITHOUT LIMITATION ANY WARRANTIES OR CONDITIONS OF TITLE,
+// NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR
+// PURPOSE.  YOU ARE SOLELY RESPONSIBLE FOR DETERMINING THE
+// APPROPRIATENESS OF USING OR REDISTRIBUTING THE SOFTWARE (WHERE
+// ALLOWED), AND ASSUME ANY RISKS ASSOCIATED WITH YOUR EXERCISE OF
+// PERMISSIONS UNDER THIS AGREEMENT.
+// 
+// This software may be covered by US patent #10,324,889. Rights
+// to use these patents is included in the license agreements.
+// See LICENSE.txt for more information.
+// *********************************************************
+
+//////////////////////////////////////////////////////////////////////////
+//
+//  File: pgen1k.v;   Four bit, 1024 step pattern generator
+//
+//  The pgen1k is a pattern generator with its pattern in a block RAM.
+//  The RAM holds up to 1024 steps and each step has its own duration
+//  of 1 to 4096 counts of the selected clock source.  The outputs are
+//  set to the step's value for the duration of the step.
+//      A period runs from the first step to the last step.  The steps
+//  from the loop start to the loop end are played "repeat count" times
+//  before the period continues to the last step.  At the end of the
+//  period the generator starts again at the first step.
+//      The first, last, loop, and repeat registers are double buffered.
+//  The host can load a new pattern into an unused part of the RAM while
+//  the current one is running, set up the new first/last/loop/repeat
+//  values, and then commit them.  The new values take effect at the end
+//  of the current period so there is never a partial pattern.  The RAM
+//  can be used as two banks of 512 steps, four banks of 256 steps, or
+//  as a single pattern of 1024 steps.
+//
+//  Registers:
+//      Reg 0:  Clk source in the lower 4 bits.  Same as pgen16.
+//      Reg 1:  Control.  Write a 1 to commit the pending first, last,
+//              loop start, loop end, and repeat values.  The commit
+//              takes effect at the end of the current period, or at
+//              once if the clock source is off.  A read gives 1 in
+//              bit 0 if a commit is still pending.
+//      Reg 2:  Pattern RAM address pointer, high 3 bits.  The pointer
+//              is a byte address and each step is two bytes.
+//      Reg 3:  Pattern RAM address pointer, low 8 bits.
+//      Reg 4:  Pattern RAM data.  Reads and writes of this register
+//              access the RAM at the address pointer and then increment
+//              the pointer.  Each step is written high byte first:
+//                  byte 0:  bits 7-4: output value for the step
+//                           bits 3-0: high 4 bits of (duration - 1)
+//                  byte 1:  low 8 bits of (duration - 1)
+//      Reg 5:  First step of the period, high 2 bits (pending)
+//      Reg 6:  First step of the period, low 8 bits (pending)
+//      Reg 7:  Last step of the period, high 2 bits (pending)
+//      Reg 8:  Last step of the period, low 8 bits (pending)
+//      Reg 9:  Loop start step, high 2 bits (pending)
+//      Reg 10: Loop start step, low 8 bits (pending)
+//      Reg 11: Loop end step, high 2 bits (pending)
+//      Reg 12: Loop end step, low 8 bits (pending)
+//      Reg 13: Repeat count.  The number of times to play the steps
+//              from loop start to loop end.  Zero loops forever.  The
+//              default of one plays the loop steps once.  (pending)
+//      Reg 14: Trigger configuration
+//              bits 1-0: trigger mode
+//                  0: free running (default)
+//                  1: start.  Hold the outputs low at the first step
+//                     until a trigger then run freely.  A write re-arms.
+//                  2: gate.  Run while the trigger input is high and
+//                     hold the outputs low at the first step while low.
+//                  3: re-phase.  Restart the period on each trigger.
+//              bit 2:    trigger on the falling edge (or low level)
+//              bit 3:    host trigger.  Writing a 1 here is a trigger
+//
+//  The trigger input is an FPGA pin selected in perilist, for example
+//  "pgen1k:17" uses PIN_17 which may belong to another slot.  The input
+//  goes through a two flip-flop synchronizer.  Pending values are
+//  committed at once while the pattern is held.
+//
+//  The clock source is selected by the lower 4 bits of register 0:
+//      0:  Off
+//      1:  20 MHz
+//      2:  10 MHz
+//      3:  5 MHz
+//      4:  1 MHz
+//      5:  500 KHz
+//      6:  100 KHz
+//      7:  50 KHz
+//      8:  10 KHz
+//      9   5 KHz
+//     10   1 KHz
+//     11:  500 Hz
+//     12:  100 Hz
+//     13:  50 Hz
+//     14:  10 Hz
+//     15:  5 Hz
+//
+/////////////////////////////////////////////////////////////////////////
+module pgen1k(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
+       addr_match_in,addr_match_out,datin,datout,
+       m100clk,m10clk,m1clk,u100clk,u10clk,u1clk,n100clk,trig,pattern);
+    input  clk;              // system clock
+    input  rdwr;             // direction of this transfer. Read=1; Write=0
+    input  strobe;           // true on full valid command
+    input  [3:0] our_addr;   // high byte of our assigned address
+    input  [11:0] addr;      // address of target peripheral
+    input  busy_in;          // ==1 if a previous peripheral is busy
+    output busy_out;         // ==our busy state if our address, pass through otherwise
+    input  addr_match_in;    // ==1 if a previous peripheral claims the address
+    output addr_match_out;   // ==1 if we claim the above address, pass through otherwise
+    input  [7:0] datin ;     // Data INto the peripheral;
+    output [7:0] datout ;    // Data OUTput from the peripheral, = datin if not us.
+    input  m100clk;          // 100 Millisecond clock pulse
+    input  m10clk;           // 10 Millisecond clock pulse
+    input  m1clk;            // Millisecond clock pulse
+    input  u100clk;          // 100 microsecond clock pulse
+    input  u10clk;           // 10 microsecond clock pulse
+    input  u1clk;            // 1 microsecond clock pulse
+    input  n100clk;          // 100 nanosecond clock pulse
+    input  trig;             // Trigger input
+    output [3:0] pattern;    // out signals
+
+
+    // Addressing and bus interface lines 
+    wire   myaddr;           // ==1 if a correct read/write on our address
+    wire   mywrite;          // ==1 if a write to one of our registers
+    wire   ramwen;           // Host write to the pattern RAM
+    reg    [10:0] ptr;       // Host byte address into the pattern RAM
+    wire   [7:0] hdout;      // Host side RAM output
+    wire   [15:0] step;      // Step value and duration from the RAM
+    wire   [9:0] raddr;      // Pattern side RAM address
+
+
+    // Pattern generation timer and state
+    wire   lclk;             // Prescale clock
+    reg    lreg;             // Prescale clock divided by two
+    reg    [3:0] freq;       // Input frequency selector
+    wire   tick;             // ==1 on each count of the selected clock
+    reg    [11:0] count;     // Counts in the current step
+    reg    [9:0] stepid;     // Which step we are on
+    reg    [7:0] loopcnt;    // Loop passes left in this period
+    wire   stepdone;         // ==1 on the last count of a step
+    wire   [9:0] nxtstep;    // The step after this one
+    wire   looping;          // ==1 if the loop end goes back to loop start
+    wire   perend;           // ==1 on the last count of the period
+    reg    [9:0] first;      // First step of the period
+    reg    [9:0] last;       // Last step of the period
+    reg    [9:0] loopst;     // Loop start step
+    reg    [9:0] loopend;    // Loop end step
+    reg    [7:0] rptcnt;     // Loop repeat count
+    reg    [9:0] pfirst;     // Pending first step
+    reg    [9:0] plast;      // Pending last step
+    reg    [9:0] ploopst;    // Pending loop start step
+    reg    [9:0] ploopend;   // Pending loop end step
+    reg    [7:0] prptcnt;    // Pending loop repeat count
+    reg    pend;             // ==1 if a commit is pending
+    reg    [1:0] trigmode;   // free run, start, gate, or re-phase
+    reg    trigneg;          // ==1 to trigger on falling edge or low level
+    reg    [2:0] trigmeta;   // bring the trigger input into our clock domain
+    reg    armed;            // ==1 if waiting for a trigger in start mode
+    wire   trigevt;          // ==1 on a trigger edge or host trigger
+    wire   running;          // ==1 if the pattern is not held
+    wire   hold;             // ==1 to hold or restart at the first step
+
+
+    // The pattern RAM.  The host sees bytes, the pattern side sees steps.
+    // Invert the low address bit so the high byte of a step comes first.
+    pgram2kx8 patram(clk, {ptr[10:1],~ptr[0]}, datin, hdout, ramwen,
+                     raddr, step);
+
+
+    // Generate the clock source for the main counter
+    assign lclk = (freq[3:1] == 0) ? 1'b0 :
+                  (freq[3:1] == 1) ? n100clk :
+                  (freq[3:1] == 2) ? u1clk :
+                  (freq[3:1] == 3) ? u10clk :
+                  (freq[3:1] == 4) ? u100clk :
+                  (freq[3:1] == 5) ? m1clk :
+                  (freq[3:1] == 6) ? m10clk :
+                  (freq[3:1] == 7) ? m100clk : 1'b0;
+    assign tick = (freq == 1) ||
+                  ((freq[0] == 0) && (lclk == 1)) ||
+                  ((freq[0] == 1) && (lreg == 1) && (lclk == 1));
+
+
+    initial
+    begin
+        freq = 0;        // no clock running to start
+        ptr = 0;
+        stepid = 0;
+        count = 0;
+        first = 0;
+        last = 15;
+        loopst = 0;
+        loopend = 0;
+        rptcnt = 1;
+        loopcnt = 1;
+        pfirst = 0;
+        plast = 15;
+        ploopst = 0;
+        ploopend = 0;
+        prptcnt = 1;
+        pend = 0;
+        trigmode = 0;
+        trigneg = 0;
+        armed = 1;
+    end
+
+
+    always @(posedge clk)
+    begin
+        // Get the half rate clock
+        if (lclk)
+            lreg <= ~lreg;
+
+        // Latch the registers and handle the RAM address pointer
+        if (mywrite)
+        begin
+            if (addr[3:0] == 0)
+                freq <= datin[3:0];
+            if ((addr[3:0] == 1) && datin[0])
+                pend <= 1;
+            if (addr[3:0] == 2)
+                ptr[10:8] <= datin[2:0];
+            if (addr[3:0] == 3)
+                ptr[7:0] <= datin;
+            if (addr[3:0] == 5)
+                pfirst[9:8] <= datin[1:0];
+            if (addr[3:0] == 6)
+                pfirst[7:0] <= datin;
+            if (addr[3:0] == 7)
+                plast[9:8] <= datin[1:0];
+            if (addr[3:0] == 8)
+                plast[7:0] <= datin;
+            if (addr[3:0] == 9)
+                ploopst[9:8] <= datin[1:0];
+            if (addr[3:0] == 10)
+                ploopst[7:0] <= datin;
+            if (addr[3:0] == 11)
+                ploopend[9:8] <= datin[1:0];
+            if (addr[3:0] == 12)
+                ploopend[7:0] <= datin;
+            if (addr[3:0] == 13)
+                prptcnt <= datin;
+        end
+        if (strobe && myaddr && (addr[3:0] == 4))   // auto-increment on data access
+            ptr <= ptr + 11'h001;
+
+        // Trigger config.  Re-arm on a write, disarm on a trigger
+        trigmeta <= {trigmeta[1:0],trig};
+        if (mywrite && (addr[3:0] == 14))
+        begin
+            trigmode <= datin[1:0];
+            trigneg <= datin[2];
+            armed <= ~datin[3];
+        end
+        else if (trigevt)
+            armed <= 0;
+        // Take on the new pattern at the end of a period or when stopped
+        if (pend && (hold || perend))
+        begin
+            pend <= 0;
+            first <= pfirst;
+            last <= plast;
+            loopst <= ploopst;
+            loopend <= ploopend;
+            rptcnt <= prptcnt;
+            loopcnt <= prptcnt;
+        end
+
+        if (hold)
+        begin
+            stepid <= (pend) ? pfirst : first;
+            count <= 0;
+            if (~pend)
+                loopcnt <= rptcnt;
+        end
+        else if (tick)
+        begin
+            if (stepdone)
+            begin
+                count <= 0;
+                stepid <= nxtstep;
+                if (looping && (rptcnt != 0))
+                    loopcnt <= loopcnt - 8'h01;
+                else if (perend && ~pend)
+                    loopcnt <= rptcnt;
+            end
+            else
+                count <= count + 12'h001;
+        end
+    end
+
+    // The step sequencer.  Loop back if more passes, wrap at the last step
+    assign stepdone = tick && (count == step[11:0]);
+    assign looping = (stepid == loopend) && ((rptcnt == 0) || (loopcnt != 1));
+    assign perend = stepdone && (stepid == last) && ~looping;
+    assign nxtstep = (looping) ? loopst :
+                     (stepid == last) ? ((pend) ? pfirst : first) :
+                     stepid + 10'h001;
+    assign raddr = (hold) ? ((pend) ? pfirst : first) :
+                   (stepdone) ? nxtstep : stepid;
+
+
+    // Trigger edges from the pin or the host
+    assign trigevt = ((trigmeta[2:1] == 2'b01) & ~trigneg) |
+                     ((trigmeta[2:1] == 2'b10) & trigneg) |
+                     (mywrite & (addr[3:0] == 14) & datin[3]);
+    assign running = (trigmode == 0) || (trigmode == 3) ||
+                     ((trigmode == 1) && ~armed) ||
+                     ((trigmode == 2) && (trigmeta[1] ^ trigneg));
+    assign hold = (freq == 0) || ~running || ((trigmode == 3) && trigevt);
+
+    // Assign the outputs.
+    assign pattern = (running) ? step[15:12] : 4'h0;
+
+    assign mywrite = (strobe && myaddr && ~rdwr); // latch data on a write
+    assign ramwen  = (mywrite && (addr[3:0] == 4));
+
+    assign myaddr = (addr[11:8] == our_addr) && (addr[7:4] == 0);
+    assign datout = (~myaddr) ? datin :
+                    (~strobe) ? 8'h00 :
+                    (addr[3:0] == 0) ? {4'h0,freq} :
+                    (addr[3:0] == 1) ? {7'h00,pend} :
+                    (addr[3:0] == 2) ? {5'h00,ptr[10:8]} :
+                    (addr[3:0] == 3) ? ptr[7:0] :
+                    (addr[3:0] == 4) ? hdout :
+                    (addr[3:0] == 5) ? {6'h00,pfirst[9:8]} :
+                    (addr[3:0] == 6) ? pfirst[7:0] :
+                    (addr[3:0] == 7) ? {6'h00,plast[9:8]} :
+                    (addr[3:0] == 8) ? plast[7:0] :
+                    (addr[3:0] == 9) ? {6'h00,ploopst[9:8]} :
+                    (addr[3:0] == 10) ? ploopst[7:0] :
+                    (addr[3:0] == 11) ? {6'h00,ploopend[9:8]} :
+                    (addr[3:0] == 12) ? ploopend[7:0] :
+                    (addr[3:0] == 13) ? prptcnt :
+                    (addr[3:0] == 14) ? {5'h00,trigneg,trigmode} :
+                    8'h00 ; 
+
+    // Loop in-to-out where appropriate
+    assign busy_out = busy_in;
+    assign addr_match_out = myaddr | addr_match_in;
+
+endmodule
+
+
+//
+// A wrapper around a dual port Xilinx RAM block.  Port A is byte wide
+// for the host and port B is a 16 bit step for the pattern generator.
+module pgram2kx8(clk, haddr, hdin, hdout, hwen, paddr, pdout);
+    input clk;
+    input [10 : 0] haddr;
+    input [7 : 0] hdin;
+    output [7 : 0] hdout;
+    input hwen;
+    input [9 : 0] paddr;
+    output [15 : 0] pdout;
+
+    wire DOPA;
+    wire [1:0] DOPB;
+    RAMB16_S9_S18 #(
+        .INIT_A(9'h000),  // Value of output RAM registers on Port A at startup
+        .INIT_B(18'h00000), // Value of output RAM registers on Port B at startup
+        .SRVAL_A(9'h000), // Port A output value upon SSR assertion
+        .SRVAL_B(18'h00000), // Port B output value upon SSR assertion
+        .WRITE_MODE_A("WRITE_FIRST"), // WRITE_FIRST, READ_FIRST or NO_CHANGE
+        .WRITE_MODE_B("WRITE_FIRST"), // WRITE_FIRST, READ_FIRST or NO_CHANGE
+        .SIM_COLLISION_CHECK("NONE")  // "NONE", "WARNING_ONLY", "GENERATE_X_ONLY", "ALL"
+       ) RAMB16_S9_S18_inst (
+          .DOA(hdout),    // Port A 8-bit Data Output
+          .DOB(pdout),    // Port B 16-bit Data Output
+          .DOPA(DOPA),    // Port A 1-bit Parity Output
+          .DOPB(DOPB),    // Port B 2-bit Parity Output
+          .ADDRA(haddr),  // Port A 11-bit Address Input
+          .ADDRB(paddr),  // Port B 10-bit Address Input
+          .CLKA(clk),     // Port A Clock
+          .CLKB(clk),     // Port B Clock
+          .DIA(hdin),     // Port A 8-bit Data Input
+          .DIB(16'h0000), // Port B 16-bit Data Input
+          .DIPA(1'b0),    // Port A 1-bit parity Input
+          .DIPB(2'b00),   // Port B 2-bit parity Input
+          .ENA(1'b1),     // Port A RAM Enable Input
+          .ENB(1'b1),     // Port B RAM Enable Input
+          .SSRA(1'b0),    // Port A Synchronous Set/Reset Input
+          .SSRB(1'b0),    // Port B Synchronous Set/Reset Input
+          .WEA(hwen),     // Port A Write Enable Input
+          .WEB(1'b0)      // Port B Write Enable Input
+       );
+
+endmodule
@@ -31,28 +31,45 @@
 //
 //  File: ping4.v;   Interface to four Parallax PNG))) ultrasonic sensors
 //
-//  Registers are read-only and 16 bit
-//    Addr=0,1    Echo time
-//    Addr=2      Interface number
+//  Registers are 8 bit
+//    Addr=0,1    Echo time in microseconds (read-only)
+//    Addr=2      Interface number (read-only)
 //    Addr=3      Enabled register
+//    Addr=4      Sensor groups, two bits per sensor.  Sensor 0 is in
+//                bits 1-0.  The default of 0xe4 puts each sensor in its
+//                own group.
+//    Addr=5      Blanking time between groups in milliseconds.
+//                Default is 30.
+//    Addr=6      Echo timeout in units of 256 microseconds.  An echo
+//                still high after this time ends the reading early.
+//                Zero, the default, waits for the end of the echo.
 //
 //
 //   State      0   1    2   | 3      4                   5    0
 //   IN/OUT   _____|--|____________|------|------------|________
-//   Poll     .....|...................................______|____
 //
 //   The FPGA drives the PNG))) high for 5 us (state 1) and then holds
 //   the line low for 500 us (state 2).  It then switches and starts
 //   listening for a rising edge (state 3) coming back from the PNG.
 //   When it finds the rising edge it counts the microseconds until 
-//   the falling edge (state 4).  With a complete sample, we wait for
-//   a poll and then send the sample up the host (state 5)
+//   the falling edge (state 4).  With a complete sample we latch the
+//   reading for the host (state 5).  If we're still in state 3 after
+//   1024 us we assume that no sensor is connected and give a reading
+//   of zero.  If the echo timeout ends state 4 early the reading is the
+//   timeout and the line is left as an input until the sensor lowers
+//   it (state 6).
 //
-//   The above is repeated for each of the four input lines.  Each
-//   good reason we start the cycle on a poll from the busif.  Times
-//   for state 2 and 3 should be less than 750 us.  If we're still in
-//   state 3 after 1024 us we assume that no sensor is connected and
-//   go immediately to state 5 with a reading of zero.
+//   Sensors are pinged in groups.  All of the enabled sensors in a
+//   group are pinged at the same time and the group is done when each
+//   of its sensors has a reading.  After the blanking time the next
+//   group with an enabled sensor is pinged.  Putting sensors that face
+//   different directions in the same group raises the update rate for
+//   all of them.  The blanking time lets echoes die down before the
+//   next group.
+//
+//   Each reading is sent to the host on the next poll as the echo time
+//   and the sensor number.  The measurements do not wait for the host,
+//   and if more than one sensor has a reading they are sent in turn.
 //
 /////////////////////////////////////////////////////////////////////////
 module ping4(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
@@ -73,138 +90,230 @@ module ping4(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     inout  [3:0] png;        // Parallax PNG))) inputs
  
     wire   myaddr;           // ==1 if a correct read/write on our address
-    reg    [1:0] sensor;     // Which sensor is being measured
-    reg    [2:0] state;      // Where in the measurement we are
-    reg    [14:0] timer;     // Used for all counting of microseconds
-    reg    [1:0] deadtimer;  // Creates a short pause between reading to let echos die down
-    reg    meta;             // Brings inputs into our clock domain
-    reg    meta1;            // Brings inputs into our clock domain and for edge detection
+    reg    [2:0] state[3:0]; // Where in the measurement each sensor is
+    reg    [14:0] timer[3:0];   // Used for all counting of microseconds
+    reg    [3:0] meta;       // Brings inputs into our clock domain
+    reg    [3:0] meta1;      // Brings inputs into our clock domain and for edge detection
     reg    [3:0] enabled;    // ==1 if sensor is enabled
+    integer j;               // loop counter
+
+    // Group scheduler
+    reg    [7:0] groups;     // group of each sensor, two bits each
+    reg    [7:0] blanktime;  // milliseconds between groups
+    reg    [6:0] echotmo;    // echo timeout in 256 us units, 0 is off
+    reg    [1:0] grp;        // the group being pinged
+    reg    [1:0] gphase;     // 0=blanking, 1=pinging, 2=find next group
+    reg    [9:0] uspre;      // prescale u1clk to milliseconds
+    reg    [7:0] blankcnt;   // milliseconds into the blanking time
+    wire   [3:0] ingrp;      // enabled sensors in the current group
+    wire   [3:0] busy;       // sensors with a ping in progress
+
+    // Readings for the host
+    reg    [14:0] result[3:0];  // latest reading of each sensor
+    reg    [3:0] ready;      // ==1 if the sensor's reading is not sent
+    reg    upopen;           // ==1 while an autosend is open
+    reg    [1:0] upsensor;   // sensor being sent
+    wire   [1:0] pick;       // next sensor to send, round robin
+    wire   [14:0] upres;     // reading of the sensor being sent
 
     initial
     begin
-        state = 0;
-        sensor = 0;
         enabled = 0;
-        deadtimer = 3;
+        groups = 8'he4;
+        blanktime = 30;
+        echotmo = 0;
+        grp = 3;
+        gphase = 0;
+        uspre = 0;
+        blankcnt = 0;
+        ready = 0;
+        upopen = 0;
+        upsensor = 0;
+        for (j = 0; j < 4; j = j + 1)
+        begin
+            state[j] = 0;
+            timer[j] = 0;
+            result[j] = 0;
+        end
     end
 
     always @(posedge clk)
     begin
-        // Get the input
-        meta  <= (sensor == 0) ? png[0] :
-                 (sensor == 1) ? png[1] :
-                 (sensor == 2) ? png[2] : png[3];
+        // Get the inputs
+        meta  <= png;
         meta1 <= meta;
 
 
-        // Set the enabled bits
+        // Set the configuration registers
         if (strobe & myaddr & ~rdwr)  // latch data on a write
         begin
-            if (addr[1:0] == 3)
+            if (addr[2:0] == 3)
                 enabled <= datin[3:0];
+            if (addr[2:0] == 4)
+                groups <= datin;
+            if (addr[2:0] == 5)
+                blanktime <= datin;
+            if (addr[2:0] == 6)
+                echotmo <= datin[6:0];
         end
 
 
-        if (state == 0)  // Waiting to start a measurement, output=0
+        // Blank between groups, then ping every sensor in the next
+        // group that has an enabled sensor
+        if (u1clk)
+            uspre <= (uspre == 10'd999) ? 10'h000 : uspre + 10'h001;
+        if (gphase == 0)
         begin
-            if (((sensor == 0) && (enabled[0] == 0)) ||
-                ((sensor == 1) && (enabled[1] == 0)) ||
-                ((sensor == 2) && (enabled[2] == 0)) ||
-                ((sensor == 3) && (enabled[3] == 0)))
-                sensor <= sensor + 2'h1;
-            else if (deadtimer == 0)  // start on 30 ms boundary
+            if (blankcnt >= blanktime)
             begin
-                state <= 1;
-                timer <= -6;
+                gphase <= 2;
+                grp <= grp + 2'h1;
             end
-            else if (m10clk)
-                deadtimer <= deadtimer - 2'h1;
+            else if (u1clk && (uspre == 10'd999))
+                blankcnt <= blankcnt + 8'h01;
+        end
+        else if (gphase == 2)
+        begin
+            if (ingrp != 0)
+                gphase <= 1;
+            else
+                grp <= grp + 2'h1;
+        end
+        else if (busy == 0)    // gphase == 1 and the group is done
+        begin
+            gphase <= 0;
+            blankcnt <= 0;
         end
-        if (state == 1)  // Sending the start pulse to the PNG))), output=1
+
+
+        // Run the measurement for each sensor
+        for (j = 0; j < 4; j = j + 1)
         begin
-            if (u1clk)
+            if (state[j] == 0)  // Waiting to start a measurement, output=0
             begin
-                if (timer == 0)
+                if ((gphase == 2) && ingrp[j])
                 begin
-                    state <= 2;
-                    timer <= -512;
+                    state[j] <= 1;
+                    timer[j] <= -6;
                 end
-                else
-                    timer <= timer + 15'h0001;
             end
-        end
-        if (state == 2)  // Dead time waiting to switch line direction, output=0
-        begin
-            if (u1clk)
+            if (state[j] == 1)  // Sending the start pulse to the PNG))), output=1
             begin
-                if (timer == 0)
+                if (u1clk)
                 begin
-                    state <= 3;
-                    timer <= -512;
+                    if (timer[j] == 0)
+                    begin
+                        state[j] <= 2;
+                        timer[j] <= -512;
+                    end
+                    else
+                        timer[j] <= timer[j] + 15'h0001;
                 end
-                else
-                    timer <= timer + 15'h0001;
             end
-        end
-        if (state == 3)  // Waiting for a low-to-high transition or a timeout, output=Z
-        begin
-            if ((meta == 1) && (meta1 == 0)) // Got the low-to-high transition
+            if (state[j] == 2)  // Dead time waiting to switch line direction, output=0
             begin
-                state <= 4;
-                timer <= 0;
+                if (u1clk)
+                begin
+                    if (timer[j] == 0)
+                    begin
+                        state[j] <= 3;
+                        timer[j] <= -512;
+                    end
+                    else
+                        timer[j] <= timer[j] + 15'h0001;
+                end
             end
-            else if (u1clk)
+            if (state[j] == 3)  // Waiting for a low-to-high transition or a timeout, output=Z
             begin
-                if (timer == 0)  // timeout == no sensor; send a zero response
+                if ((meta[j] == 1) && (meta1[j] == 0)) // Got the low-to-high transition
                 begin
-                    state <= 5;
-                    timer <= 0;
+                    state[j] <= 4;
+                    timer[j] <= 0;
                 end
-                else
-                    timer <= timer + 15'h0001;
+                else if (u1clk)
+                begin
+                    if (timer[j] == 0)  // timeout == no sensor; send a zero response
+                        state[j] <= 5;
+                    else
+                        timer[j] <= timer[j] + 15'h0001;
+                end
+            end
+            if (state[j] == 4)  // Waiting for the input to go low again
+            begin
+                if (u1clk)
+                    timer[j] <= timer[j] + 15'h0001;
+                if ((meta1[j] == 0) ||
+                    ((echotmo != 0) && (timer[j] >= {echotmo, 8'h00})))
+                    state[j] <= 5;
+            end
+            if (state[j] == 5)  // Got a measurement.  Latch it for the host.
+            begin
+                if (~(upopen && (upsensor == j)))
+                begin
+                    result[j] <= timer[j];
+                    ready[j] <= 1;
+                    state[j] <= (meta1[j]) ? 3'h6 : 3'h0;
+                end
+            end
+            if (state[j] == 6)  // Ended early.  Wait for the echo to end, output=Z
+            begin
+                if (meta1[j] == 0)
+                    state[j] <= 0;
             end
         end
-        if (state == 4)  // Waiting for the input to go low again
+
+
+        // Open an autosend for the next sensor with a reading on a poll.
+        // Reading the sensor number closes it.
+        if (~upopen && (ready != 0) && myaddr && ~strobe)
         begin
-            if (u1clk)
-                timer <= timer + 15'h0001;
-            if (meta1 == 0)
-                state <= 5;
+            upopen <= 1;
+            upsensor <= pick;
         end
-        if (state == 5)  // Got a measurement. Wait for a poll.
+        else if (upopen && strobe && myaddr && rdwr && (addr[2:0] == 2))
         begin
-            if (strobe && myaddr)  // Poll.  Go start another reading
-            begin
-                state <= 0;
-                sensor <= sensor + 2'h1;
-                deadtimer <= 3;
-            end
+            upopen <= 0;
+            ready[upsensor] <= 0;
         end
-
     end
 
+    assign ingrp[0] = enabled[0] && (groups[1:0] == grp);
+    assign ingrp[1] = enabled[1] && (groups[3:2] == grp);
+    assign ingrp[2] = enabled[2] && (groups[5:4] == grp);
+    assign ingrp[3] = enabled[3] && (groups[7:6] == grp);
+    assign busy[0] = (state[0] != 0) && (state[0] != 6);
+    assign busy[1] = (state[1] != 0) && (state[1] != 6);
+    assign busy[2] = (state[2] != 0) && (state[2] != 6);
+    assign busy[3] = (state[3] != 0) && (state[3] != 6);
+    assign upres = result[upsensor];
+    assign pick = (ready[upsensor + 2'h1]) ? (upsensor + 2'h1) :
+                  (ready[upsensor + 2'h2]) ? (upsensor + 2'h2) :
+                  (ready[upsensor + 2'h3]) ? (upsensor + 2'h3) : upsensor;
+
     // Assign the outputs.
-    assign png[0] = ((enabled[0] == 0) || (sensor != 0)) ? 1'b0 :
-                    (state == 1) ?   1'b1    :
-                    ((state == 0) || (state == 2)) ? 1'b0 : 1'bz ;
-    assign png[1] = ((enabled[1] == 0) || (sensor != 1)) ? 1'b0 :
-                    (state == 1) ?   1'b1    :
-                    ((state == 0) || (state == 2)) ? 1'b0 : 1'bz ;
-    assign png[2] = ((enabled[2] == 0) || (sensor != 2)) ? 1'b0 :
-                    (state == 1) ?   1'b1    :
-                    ((state == 0) || (state == 2)) ? 1'b0 : 1'bz ;
-    assign png[3] = ((enabled[3] == 0) || (sensor != 3)) ? 1'b0 :
-                    (state == 1) ?   1'b1    :
-                    ((state == 0) || (state == 2)) ? 1'b0 : 1'bz ;
-
-    assign myaddr = (addr[11:8] == our_addr) && (addr[7:2] == 0);
+    assign png[0] = (enabled[0] == 0) ? 1'b0 :
+                    (state[0] == 1) ?   1'b1    :
+                    ((state[0] == 0) || (state[0] == 2)) ? 1'b0 : 1'bz ;
+    assign png[1] = (enabled[1] == 0) ? 1'b0 :
+                    (state[1] == 1) ?   1'b1    :
+                    ((state[1] == 0) || (state[1] == 2)) ? 1'b0 : 1'bz ;
+    assign png[2] = (enabled[2] == 0) ? 1'b0 :
+                    (state[2] == 1) ?   1'b1    :
+                    ((state[2] == 0) || (state[2] == 2)) ? 1'b0 : 1'bz ;
+    assign png[3] = (enabled[3] == 0) ? 1'b0 :
+                    (state[3] == 1) ?   1'b1    :
+                    ((state[3] == 0) || (state[3] == 2)) ? 1'b0 : 1'bz ;
+
+    assign myaddr = (addr[11:8] == our_addr) && (addr[7:3] == 0);
     assign datout = (~myaddr) ? datin : 
-                    (~strobe & (state == 5)) ? 8'h03 : // send 3 bytes when a sample is ready
-                    (strobe && (addr[1:0] == 0)) ? {1'h0,timer[14:8]} :
-                    (strobe && (addr[1:0] == 1)) ? timer[7:0] :
-                    (strobe && (addr[1:0] == 2)) ? {6'h00,sensor} :
-                    (strobe && (addr[1:0] == 3)) ? {4'h0,enabled} :
+                    (~strobe & (upopen | (ready != 0))) ? 8'h03 : // send 3 bytes when a sample is ready
+                    (strobe && (addr[2:0] == 0)) ? {1'h0,upres[14:8]} :
+                    (strobe && (addr[2:0] == 1)) ? upres[7:0] :
+                    (strobe && (addr[2:0] == 2)) ? {6'h00,upsensor} :
+                    (strobe && (addr[2:0] == 3)) ? {4'h0,enabled} :
+                    (strobe && (addr[2:0] == 4)) ? groups :
+                    (strobe && (addr[2:0] == 5)) ? blanktime :
+                    (strobe && (addr[2:0] == 6)) ? {1'b0,echotmo} :
                     8'h00;
 
     // Loop in-to-out where appropriate
@@ -212,4 +321,3 @@ module ping4(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     assign addr_match_out = myaddr | addr_match_in;
 
 endmodule
-
@@ -30,14 +30,53 @@
 //  File: pulse2.v;   Dual channel pulse generator
 //
 //  Registers: (high byte)
-//      Reg 0:  Period in steps of 10 ns.  Maximum count is 1024.
-//      Reg 2:  Pulse 1 width in units of 10 ns.
-//      Reg 4:  Pulse 2 start in units of 10ns.
-//      Reg 6:  Pulse 2 stop time in units of 10 ns.
+//      Reg 0:  Period in steps of 10 ns, bits 15-0.
+//      Reg 2:  Pulse 1 width in units of 10 ns, bits 15-0.
+//      Reg 4:  Pulse 2 start in units of 10ns, bits 15-0.
+//      Reg 6:  Pulse 2 stop time in units of 10 ns, bits 15-0.
+//      Reg 8:  Trigger configuration
+//              bits 1-0: trigger mode
+//                  0: free running (default)
+//                  1: start.  Hold the outputs low until a trigger then
+//                     run freely.  Any write to this register re-arms.
+//                  2: gate.  Run while the trigger input is high and
+//                     hold the outputs low while it is low.
+//                  3: re-phase.  Restart the period on each trigger.
+//              bit 2:    trigger on the falling edge (or low level)
+//              bit 3:    host trigger.  Writing a 1 here is a trigger
+//      Reg 9:  Burst count.  Zero (the default) runs continuously.  A
+//              non-zero value emits that many periods and then holds
+//              the outputs low and sends an auto-update to the host.
+//              In free running mode a write to Reg 10 starts a burst.
+//              In start and re-phase modes a trigger starts a burst.
+//              In gate mode the burst starts when the gate opens and
+//              pauses while the gate is closed.  Opening the gate again
+//              resumes the burst where it stopped.
+//      Reg 11: Period bits 23-16
+//      Reg 12: Pulse 1 width bits 23-16
+//      Reg 13: Pulse 2 start bits 23-16
+//      Reg 14: Pulse 2 stop time bits 23-16
+//      Reg 15: Half cycle edges.  Setting a bit delays that edge by 5 ns
+//              using the DDR output registers.  The outputs run one
+//              10 ns clock behind the counter so both halves of the
+//              cycle come from the same clock.
+//              bit 0:  pulse 1 rising edge
+//              bit 1:  pulse 1 falling edge
+//              bit 2:  pulse 2 rising edge
+//              bit 3:  pulse 2 falling edge
+//
+//  The longest period is 2^24 counts or about 167 milliseconds.  The
+//  registers are write-only except that a read of Reg 0 gives the burst
+//  status.  Bit 0 is set if a burst completed since the last read and
+//  bit 1 is set while a burst is running.  An auto-update reads Reg 0.
+//
+//  The trigger input is an FPGA pin selected in perilist, for example
+//  "pulse2:17" uses PIN_17 which may belong to another slot.  The input
+//  is synchronized to the 100 MHz clock and takes effect in under 40 ns.
 //
 /////////////////////////////////////////////////////////////////////////
 module pulse2(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
-       addr_match_in,addr_match_out,datin,datout,p1p,p1n,p2p,p2n);
+       addr_match_in,addr_match_out,datin,datout,trig,p1p,p1n,p2p,p2n);
     input  clk;              // system clock
     input  rdwr;             // direction of this transfer. Read=1; Write=0
     input  strobe;           // true on full valid command
@@ -49,65 +88,174 @@ module pulse2(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     output addr_match_out;   // ==1 if we claim the above address, pass through otherwise
     input  [7:0] datin ;     // Data INto the peripheral;
     output [7:0] datout ;    // Data OUTput from the peripheral, = datin if not us.
+    input  trig;             // Trigger input
     output p1p;              // Pulse 1 uninverted
     output p1n;              // Pulse 1 inverted
     output p2p;              // Pulse 2 uninverted
     output p2n;              // Pulse 2 inverted
  
     wire   myaddr;           // ==1 if a correct read/write on our address
-    reg    [9:0] period;     // overall period of the pulses
-    reg    [9:0] p1width;    // output 1 pulse width
-    reg    [9:0] p2start;    // start of output 2 from start of cycle
-    reg    [9:0] p2end;      // output 2 pulse goes low at this count
+    reg    [23:0] period;    // overall period of the pulses
+    reg    [23:0] p1width;   // output 1 pulse width
+    reg    [23:0] p2start;   // start of output 2 from start of cycle
+    reg    [23:0] p2end;     // output 2 pulse goes low at this count
     reg    p1;               // state of output 1
     reg    p2;               // state of output 2
-    reg    [9:0] pcount;     // period counter
+    reg    p1prev;           // state of output 1 on the previous 10 ns clock
+    reg    p2prev;           // state of output 2 on the previous 10 ns clock
+    reg    [23:0] pcount;    // period counter
     wire   n10clk;           // 10 ns clock
+    reg    [1:0] trigmode;   // free run, start, gate, or re-phase
+    reg    trigneg;          // ==1 to trigger on falling edge or low level
+    reg    hosttog;          // toggles on each host trigger
+    reg    armtog;           // toggles on each write of the trigger config
+    reg    [2:0] trigmeta;   // bring trigger input into the 100 MHz domain
+    reg    [2:0] hostmeta;   // bring host trigger into the 100 MHz domain
+    reg    [2:0] armmeta;    // bring re-arm into the 100 MHz domain
+    reg    armed;            // ==1 if waiting for a trigger in start mode
+    wire   trigevt;          // ==1 on a trigger edge or host trigger
+    wire   running;          // ==1 if the outputs are not held
+    reg    [15:0] burst;     // number of periods in a burst, 0==continuous
+    reg    [15:0] bleft;     // periods left in the current burst
+    reg    bactive;          // ==1 while a burst is running
+    reg    bursttog;         // toggles on each host burst start
+    reg    [2:0] burstmeta;  // bring host burst start into the 100 MHz domain
+    wire   bstart;           // ==1 to start a burst
+    wire   bpause;           // ==1 while a gate mode burst is paused
+    reg    donetog;          // toggles at the end of each burst
+    reg    [2:0] donemeta;   // bring end of burst into the system clock domain
+    reg    [1:0] actmeta;    // bring burst active into the system clock domain
+    reg    marked;           // ==1 if we need to send an auto-update to the host
+    reg    [3:0] halfedge;   // which edges are delayed by half a cycle
+    wire   p1d0;             // pulse 1 in the first half of the 10 ns cycle
+    wire   p2d0;             // pulse 2 in the first half of the 10 ns cycle
 
     // get the 100 MHz clock
     clk20to100 pulse20to100(clk, n10clk);
 
     initial
     begin
-        period = 10'd1000;
-        p1width = 10'd0;    // P1 is off to start
-        p2start = 10'd0;    // P2 is off to start
-        p2end = 10'd0;
-        pcount = 10'd0;
+        period = 24'd1000;
+        p1width = 24'd0;    // P1 is off to start
+        p2start = 24'd0;    // P2 is off to start
+        p2end = 24'd0;
+        pcount = 24'd0;
+        trigmode = 2'h0;
+        trigneg = 1'b0;
+        hosttog = 1'b0;
+        armtog = 1'b0;
+        armed = 1'b1;
+        burst = 16'h0000;
+        bactive = 1'b0;
+        bursttog = 1'b0;
+        donetog = 1'b0;
+        marked = 1'b0;
+        halfedge = 4'h0;
     end
 
     always @(posedge clk)
     begin
         if (strobe & myaddr & ~rdwr)  // Get configuration from host
         begin
-            if (addr[2:0] == 0)
-                period[9:8] <= datin[1:0];
-            else if (addr[2:0] == 1)
+            if (addr[3:0] == 0)
+                period[15:8] <= datin[7:0];
+            else if (addr[3:0] == 1)
                 period[7:0] <= datin[7:0];
-            else if (addr[2:0] == 2)
-                p1width[9:8] <= datin[1:0];
-            else if (addr[2:0] == 3)
+            else if (addr[3:0] == 2)
+                p1width[15:8] <= datin[7:0];
+            else if (addr[3:0] == 3)
                 p1width[7:0] <= datin[7:0];
-            else if (addr[2:0] == 4)
-                p2start[9:8] <= datin[1:0];
-            else if (addr[2:0] == 5)
+            else if (addr[3:0] == 4)
+                p2start[15:8] <= datin[7:0];
+            else if (addr[3:0] == 5)
                 p2start[7:0] <= datin[7:0];
-            else if (addr[2:0] == 6)
-                p2end[9:8] <= datin[1:0];
-            else if (addr[2:0] == 7)
+            else if (addr[3:0] == 6)
+                p2end[15:8] <= datin[7:0];
+            else if (addr[3:0] == 7)
                 p2end[7:0] <= datin[7:0];
+            else if (addr[3:0] == 8)
+            begin
+                trigmode <= datin[1:0];
+                trigneg <= datin[2];
+                armtog <= ~armtog;
+                if (datin[3])
+                    hosttog <= ~hosttog;
+            end
+            else if (addr[3:0] == 9)
+                burst[15:8] <= datin[7:0];
+            else if (addr[3:0] == 10)
+            begin
+                burst[7:0] <= datin[7:0];
+                bursttog <= ~bursttog;
+            end
+            else if (addr[3:0] == 11)
+                period[23:16] <= datin[7:0];
+            else if (addr[3:0] == 12)
+                p1width[23:16] <= datin[7:0];
+            else if (addr[3:0] == 13)
+                p2start[23:16] <= datin[7:0];
+            else if (addr[3:0] == 14)
+                p2end[23:16] <= datin[7:0];
+            else if (addr[3:0] == 15)
+                halfedge <= datin[3:0];
         end
+
+        // Send an auto-update at the end of each burst
+        donemeta <= {donemeta[1:0],donetog};
+        actmeta <= {actmeta[0],bactive};
+        if (donemeta[2] != donemeta[1])
+            marked <= 1;
+        else if (strobe & myaddr & rdwr)  // clear marked register on any read
+            marked <= 0;
     end
 
     // Counter / timer logic
     always @(posedge n10clk)
     begin
-        if ((pcount + 10'd1) == period)
-            pcount <= 10'd0;
+        trigmeta <= {trigmeta[1:0],trig};
+        hostmeta <= {hostmeta[1:0],hosttog};
+        armmeta <= {armmeta[1:0],armtog};
+        burstmeta <= {burstmeta[1:0],bursttog};
+
+        // Re-arm on a config write, disarm on the first trigger
+        if (armmeta[2] != armmeta[1])
+            armed <= 1'b1;
+        if (trigevt)
+            armed <= 1'b0;
+
+        // Count down the periods in a burst
+        if (bstart)
+        begin
+            bleft <= burst;
+            bactive <= 1'b1;
+        end
+        else if (bactive && running && ((pcount + 24'd1) == period))
+        begin
+            bleft <= bleft - 16'h0001;
+            if (bleft == 16'h0001)
+            begin
+                bactive <= 1'b0;
+                donetog <= ~donetog;
+            end
+        end
+
+        if (bpause)
+            pcount <= pcount;      // resume the period when the gate opens
+        else if (~running | bstart | ((trigmode == 3) & trigevt))
+            pcount <= 24'd0;
+        else if ((pcount + 24'd1) == period)
+            pcount <= 24'd0;
         else
-            pcount <= pcount + 10'd1;
+            pcount <= pcount + 24'd1;
 
-        if (pcount == p1width)
+        p1prev <= p1;
+        p2prev <= p2;
+        if (~running)
+        begin
+            p1 <= 1'b0;
+            p2 <= 1'b0;
+        end
+        else if (pcount == p1width)
         begin
             p1 <= 1'b0;
             p2 <= 1'b0;
@@ -122,21 +270,45 @@ module pulse2(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
             p1 <= 1'b0;
             p2 <= 1'b1;
         end
-        else if (pcount == 10'd0)
+        else if (pcount == 24'd0)
         begin
             p1 <= 1'b1;
             p2 <= 1'b0;
         end
     end
 
-    // Assign the outputs.
-    assign p1p = p1;
-    assign p1n = ~p1;
-    assign p2p = p2;
-    assign p2n = ~p2;
+    // Trigger edges from the pin or the host
+    assign trigevt = ((trigmeta[2:1] == 2'b01) & ~trigneg) |
+                     ((trigmeta[2:1] == 2'b10) & trigneg) |
+                     (hostmeta[2] != hostmeta[1]);
+    assign bstart = (burst != 0) &&
+                    (((trigmode == 0) && (burstmeta[2] != burstmeta[1])) ||
+                     ((trigmode == 1) && trigevt) ||
+                     ((trigmode == 2) && trigevt && ~bactive) ||
+                     ((trigmode == 3) && trigevt));
+    assign bpause = (trigmode == 2) && bactive && ~running;
+    assign running = ((burst == 0) || bactive || bstart) &&
+                     ((trigmode == 0) || (trigmode == 3) ||
+                      ((trigmode == 1) && ~armed) ||
+                      ((trigmode == 2) && (trigmeta[1] ^ trigneg)));
+
+    // A delayed edge keeps the old value for the first half of the cycle
+    assign p1d0 = ((p1 & ~p1prev & halfedge[0]) | (~p1 & p1prev & halfedge[1])) ? p1prev : p1;
+    assign p2d0 = ((p2 & ~p2prev & halfedge[2]) | (~p2 & p2prev & halfedge[3])) ? p2prev : p2;
 
-    assign myaddr = (addr[11:8] == our_addr) && (addr[7:3] == 0);
-    assign datout = datin;
+    // Assign the outputs through the DDR output registers.  D0 is sampled
+    // on the rising edge and D1 half a cycle later, after p1prev has
+    // taken the value of p1 that D0 was computed from.
+    pulseddr ddr1p(n10clk, p1d0, p1prev, p1p);
+    pulseddr ddr1n(n10clk, ~p1d0, ~p1prev, p1n);
+    pulseddr ddr2p(n10clk, p2d0, p2prev, p2p);
+    pulseddr ddr2n(n10clk, ~p2d0, ~p2prev, p2n);
+
+    assign myaddr = (addr[11:8] == our_addr) && (addr[7:4] == 0);
+    assign datout = (~myaddr) ? datin :
+                    (~strobe & marked) ? 8'h01 :   // send up one byte when a burst ends
+                    (strobe & rdwr & (addr[3:0] == 0)) ? {6'h00,actmeta[1],marked} :
+                    8'h00;
 
     // Loop in-to-out where appropriate
     assign busy_out = busy_in;
@@ -145,6 +317,33 @@ module pulse2(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
 endmodule
 
 
+//
+// A DDR output register.  d0 is output on the rising edge of the clock
+// and d1 half a cycle later.
+module pulseddr(clk, d0, d1, q);
+    input  clk;
+    input  d0;
+    input  d1;
+    output q;
+
+   ODDR2 #(
+      .DDR_ALIGNMENT("NONE"), // Sets output alignment to "NONE", "C0" or "C1"
+      .INIT(1'b0),            // Sets initial state of the Q output to 1'b0 or 1'b1
+      .SRTYPE("SYNC")         // Specifies "SYNC" or "ASYNC" set/reset
+   ) ODDR2_inst (
+      .Q(q),                  // 1-bit DDR output data
+      .C0(clk),               // 1-bit clock input
+      .C1(~clk),              // 1-bit clock input
+      .CE(1'b1),              // 1-bit clock enable input
+      .D0(d0),                // 1-bit data input (associated with C0)
+      .D1(d1),                // 1-bit data input (associated with C1)
+      .R(1'b0),               // 1-bit reset input
+      .S(1'b0)                // 1-bit set input
+   );
+
+endmodule
+
+
 // convert 20 MHz system cloce to 100 MHz.
 module clk20to100(CLKIN_IN, CLKFX_OUT);
     input CLKIN_IN;
@@ -0,0 +1,331 @@
+//////////////////////////////////////////////////////////////////////////
+//
+//  File: qtr.v;   Interface to Pololu QTR-RC sensors
+//
+//      This peripheral interfaces a Pololu quad (qtr4) or octal (qtr8)
+//  QTR-RC sensor to Linux.  The sensor is triggered and after a
+//  programmable delay all of the sensors are sensed as either high or
+//  low.  That is, in its default mode this peripheral does not give
+//  the reflectance value, it tells if the reflectance is above or
+//  below a threshold.
+//
+//  The sampling period is controlled by a 4 bit register and can be
+//  set between 0 and 150ms.  A value of zero is the default and turns
+//  off the sensor polling.  An 8 bit counter controls the amount of
+//  time to wait before reading the input pins.  A short time makes
+//  the sensor seem more sensitive and a longer time less sensitive.
+//
+//      In timing mode the discharge time of each sensor is measured
+//  in microseconds during the same wait.  A sensor that is still high
+//  at the end of the wait gets the full wait time.  One charge cycle
+//  gives an analog reflectance value for every sensor, so there is no
+//  need for repeated passes at different sensitivities.  The values
+//  can be sent as 8 bits in units of 16 us or as 16 bits in us.
+//      An optional line position is the centroid of the sensors
+//  weighted by their discharge times.  It runs from 0 at sensor 0 to
+//  256 times the index of the last sensor.  It is 0xffff if every
+//  discharge time is zero.
+//
+//  Registers
+//  0  :   Sensor values.  1==black level detected.
+//  1  :   8 bits sensitivity value.  This is the number of 10us
+//         periods to wait until reading the sensor.  In timing mode
+//         it is also the measurement window.  A sensor that has not
+//         discharged by then reports the full window as its time.
+//  2  :   Sample period in units of 10 ms.  0 turns off sampling
+//  3  :   Mode
+//             bit 0: timing mode
+//             bit 1: send 16 bit times instead of 8 bit times
+//             bit 2: compute and send the line position
+//  4,5:   Line position, high byte first
+//  16+2n, 17+2n: discharge time of sensor n in microseconds, high
+//         byte first
+//
+//  In timing mode each sample is sent as the sensor values byte, the
+//  time of each sensor starting with sensor 0, and the line position
+//  if enabled.  The autosend opens on a poll of Reg 0 and reads the
+//  registers in order from Reg 0.  Each in-order read returns the next
+//  byte of the sample.  Any other access ends the autosend.  The sample
+//  is sent again on the next poll and a host read of a register gives
+//  the register.
+//
+/////////////////////////////////////////////////////////////////////////
+
+// This code implements a simple state machine.  IDLE if waiting for
+// the start of a poll.  CHARGING if charging the QRT capacitor, and
+// SENSING if waiting to sense the pin values.  CENTROID, DIVIDE, and
+// POSITION compute the line position in timing mode.
+`define IDLE       3'h0
+`define CHARGING   3'h1
+`define SENSING    3'h2
+`define CENTROID   3'h3
+`define DIVIDE     3'h4
+`define POSITION   3'h5
+
+module qtr(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,addr_match_in,
+              addr_match_out,datin,datout, m10clk, u10clk, u1clk, q);
+    parameter NSENS = 4;     // number of sensors, 4 or 8
+    input  clk;              // system clock
+    input  rdwr;             // direction of this transfer. Read=1; Write=0
+    input  strobe;           // true on full valid command
+    input  [3:0] our_addr;   // high byte of our assigned address
+    input  [11:0] addr;      // address of target peripheral
+    input  busy_in;          // ==1 if a previous peripheral is busy
+    output busy_out;         // ==our busy state if our address, pass through otherwise
+    input  addr_match_in;    // ==1 if a previous peripheral claims the address
+    output addr_match_out;   // ==1 if we claim the above address, pass through otherwise
+    input  [7:0] datin ;     // Data INto the peripheral;
+    output [7:0] datout ;    // Data OUTput from the peripheral, = datin if not us.
+    input  m10clk;           // Latch data at 10, 20, or 50 ms
+    input  u10clk;           // 10 microsecond clock pulse
+    input  u1clk;            // 1 microsecond clock pulse
+    inout  [NSENS-1:0] q;    // QTR-RC inputs
+
+    // Addressing and bus interface lines 
+    wire   myaddr;           // ==1 if a correct read/write on our address
+ 
+    // Counter state and signals
+    reg    data_avail;       // Flag to say data is ready to send
+    reg    [3:0] polltime;   // Poll interval in units of 10ms.  0==off
+    reg    [3:0] pollcount;  // Counter from 0 to polltime.
+    reg    [7:0] sensitivity; // Timer for when to sample input pins
+    reg    [7:0] senscount;  // Counter from 0 to sensitivity.
+    reg    [NSENS-1:0] qtrval;  // sampled pin values
+    reg    [2:0] state;      // One of the states above
+    integer j;               // loop counter
+
+    // Discharge timing and line position
+    reg    timing;           // ==1 for timing mode
+    reg    wide;             // ==1 to send 16 bit times
+    reg    dopos;            // ==1 to compute the line position
+    reg    [NSENS-1:0] meta;    // Brings inputs into our clock domain
+    reg    [NSENS-1:0] meta1;   // Synchronized inputs
+    reg    [NSENS-1:0] dis;     // ==1 once the sensor has discharged
+    reg    [15:0] tcount;    // microseconds since the end of charging
+    reg    [15:0] tval[NSENS-1:0];  // discharge time of each sensor
+    reg    [3:0] cidx;       // sensor index in the centroid sums
+    reg    [18:0] suf;       // sum of the times from cidx up
+    reg    [28:0] num;       // sum of time times index, then the remainder
+    reg    [4:0] dbit;       // dividend bit in the division
+    reg    [19:0] rem;       // partial remainder
+    reg    [15:0] pos;       // line position
+
+    // Timing mode autosend
+    reg    upopen;           // ==1 while an autosend of a sample is open
+    reg    [4:0] upidx;      // next byte of the sample to send
+    wire   [4:0] upbytes;    // bytes in a sample
+    wire   [3:0] upsens;     // sensor of the byte being sent
+    wire   [15:0] uptval;    // time of that sensor
+    wire   [7:0] upbyte;     // the byte being sent
+    wire   [15:0] rdtval;    // time of the sensor read by address
+    wire   uprd;             // ==1 on an in-order read of a sample byte
+    wire   poll;             // ==1 on an autosend poll
+
+
+    initial
+    begin
+        state = `IDLE;
+        data_avail = 0;
+        polltime = 0;
+        pollcount = 1;
+        sensitivity = 1;
+        senscount = 1;
+        timing = 0;
+        wide = 0;
+        dopos = 0;
+        pos = 16'hffff;
+        upopen = 0;
+        upidx = 0;
+        for (j = 0; j < NSENS; j = j + 1)
+            tval[j] = 0;
+    end
+
+    always @(posedge clk)
+    begin
+        meta  <= q;
+        meta1 <= meta;
+
+        // Update pollcount and start charging the QTR cap at timeout
+        if (m10clk && (state == `IDLE))
+        begin
+            if (polltime != 0)
+            begin
+                if (pollcount == polltime)
+                begin
+                    state <= `CHARGING;     // Charge the QTR cap
+                    pollcount <= 1;         // restart polling counter
+                end
+                else
+                    pollcount <= pollcount + 4'h1;
+            end
+        end
+        else if (u10clk && (state == `CHARGING))
+        begin
+            // We need to charge the cap for 1 us but do so for one 10us period
+            state <= `SENSING;              // Wait for light sensitive discharge
+            tcount <= 0;
+            dis <= 0;
+        end
+        else if (state == `SENSING)
+        begin
+            // Time the discharge of each sensor
+            if (u1clk && (tcount != 16'hffff))
+                tcount <= tcount + 16'h0001;
+            for (j = 0; j < NSENS; j = j + 1)
+            begin
+                if (~dis[j] && (meta1[j] == 0))
+                begin
+                    dis[j] <= 1;
+                    tval[j] <= tcount;
+                end
+            end
+
+            // Waiting for light sensitive discharge before reading the pins
+            if (u10clk)
+            begin
+                if (senscount == sensitivity)
+                begin
+                    qtrval <= q;                // read input pins    
+                    senscount <= 1;             // comparison before inc so ==1
+                    for (j = 0; j < NSENS; j = j + 1)
+                        if (~dis[j] && (meta1[j] != 0))
+                            tval[j] <= tcount;  // not discharged gets the full time
+                    if (timing && dopos)
+                    begin
+                        state <= `CENTROID;
+                        cidx <= NSENS - 1;
+                        suf <= 0;
+                        num <= 0;
+                    end
+                    else
+                    begin
+                        data_avail <= 1;        // set flag to send data to host
+                        state <= `IDLE;
+                    end
+                end
+                else
+                    senscount <= senscount + 8'h01;
+            end
+        end
+        else if (state == `CENTROID)
+        begin
+            // Sum of i*t[i] as the sum of the suffix sums of t
+            suf <= suf + {3'h0, tval[cidx]};
+            if (cidx != 0)
+            begin
+                num <= num + {10'h000, suf} + {13'h0000, tval[cidx]};
+                cidx <= cidx - 4'h1;
+            end
+            else
+            begin
+                num <= {num[20:0], 8'h00};  // scale the position by 256
+                dbit <= 28;
+                rem <= 0;
+                state <= `DIVIDE;
+            end
+        end
+        else if (state == `DIVIDE)
+        begin
+            // Restoring division of num by suf, one quotient bit per clock.
+            // The quotient bits replace the dividend bits in num.
+            if ({rem[18:0], num[dbit]} >= {1'b0, suf})
+            begin
+                rem <= {rem[18:0], num[dbit]} - {1'b0, suf};
+                num[dbit] <= 1;
+            end
+            else
+            begin
+                rem <= {rem[18:0], num[dbit]};
+                num[dbit] <= 0;
+            end
+            if (dbit != 0)
+                dbit <= dbit - 5'h01;
+            else
+                state <= `POSITION;
+        end
+        else if (state == `POSITION)
+        begin
+            pos <= (suf == 0) ? 16'hffff : num[15:0];
+            data_avail <= 1;
+            state <= `IDLE;
+        end
+
+
+        // Handle write requests from the host
+        if (strobe & myaddr & ~rdwr & (addr[4:0] == 5'h01))       // latch data on a write
+            sensitivity <= datin;               // sensitivity
+        else if (strobe & myaddr & ~rdwr & (addr[4:0] == 5'h02))  // latch data on a write
+            polltime <= datin[3:0];             // how often to poll pins
+        else if (strobe & myaddr & ~rdwr & (addr[4:0] == 5'h03))
+        begin
+            timing <= datin[0];
+            wide <= datin[1];
+            dopos <= datin[2];
+        end
+
+        // Open an autosend of the sample on a poll in timing mode.  Any
+        // access other than the next in-order read ends the autosend.
+        if (~upopen & timing & data_avail & poll)
+        begin
+            upopen <= 1;
+            upidx <= 0;
+        end
+        else if (uprd)
+        begin
+            upidx <= upidx + 5'h01;
+            if (upidx == upbytes - 5'h01)
+            begin
+                upopen <= 0;
+                data_avail <= 0;
+            end
+        end
+        else if (upopen & strobe & myaddr)
+            upopen <= 0;
+
+        // Any read from the host clears the data available flag.
+        else if (strobe & myaddr & rdwr & ~timing) // if a read from the host
+        begin
+            // Clear data_available if we are sending up to the host
+            data_avail <= 0;
+        end
+    end
+
+    assign q = (state == `CHARGING) ? {NSENS{1'b1}} : {NSENS{1'bz}} ;
+
+    // The bytes of a timing mode sample
+    assign upbytes = 5'h01 + ((wide) ? (2 * NSENS) : NSENS) + ((dopos) ? 5'h02 : 5'h00);
+    assign upsens = (wide) ? ((upidx - 5'h01) >> 1) : (upidx - 5'h01);
+    assign uptval = tval[upsens];
+    assign upbyte = (upidx == 0) ? qtrval :
+                    (wide && (upidx <= 2 * NSENS) && upidx[0]) ? uptval[15:8] :
+                    (wide && (upidx <= 2 * NSENS)) ? uptval[7:0] :
+                    (~wide && (upidx <= NSENS)) ?
+                        ((uptval[15:12] != 0) ? 8'hff : uptval[11:4]) :
+                    (upidx == upbytes - 5'h02) ? pos[15:8] : pos[7:0];
+    assign rdtval = tval[addr[3:1]];
+    assign uprd = strobe & rdwr & upopen & (addr[11:8] == our_addr) &
+                  (addr[7:0] == {3'h0, upidx});
+    assign poll = myaddr & ~strobe & (addr[7:0] == 0);
+
+    assign myaddr = (addr[11:8] == our_addr) && ((addr[7:5] == 0) || uprd);
+    assign datout = (~myaddr) ? datin : 
+                    (poll && upopen) ? {3'h0,upbytes} :     // send the sample
+                    (poll && data_avail && timing) ? {3'h0,upbytes} :
+                    // send 1 byte per sample
+                    (~strobe && data_avail) ? 8'h01 :       // autosend one byte
+                    (uprd) ? upbyte :
+                    (strobe & (addr[4:0] == 0)) ? qtrval :
+                    (strobe & (addr[4:0] == 1)) ? sensitivity :
+                    (strobe & (addr[4:0] == 2)) ? {4'h0,polltime} :
+                    (strobe & (addr[4:0] == 3)) ? {5'h00,dopos,wide,timing} :
+                    (strobe & (addr[4:0] == 4)) ? pos[15:8] :
+                    (strobe & (addr[4:0] == 5)) ? pos[7:0] :
+                    (strobe & addr[4] & ~addr[0]) ? rdtval[15:8] :
+                    (strobe & addr[4] & addr[0]) ? rdtval[7:0] :
+                    8'h00 ;
+
+    // Loop in-to-out where appropriate
+    assign busy_out = busy_in;
+    assign addr_match_out = myaddr | addr_match_in;
+
+endmodule
@@ -49,6 +49,19 @@
 //      Reg 28: Pulse #8 interval   (16 bits)
 //      Reg 30: Pulse #8 interval   (16 bits)
 //      Reg 32: RC receiver status and configuration register
+//      Reg 33: Decode mode.  0=raw intervals (default), 1=PPM, 2=SBUS,
+//              3=iBUS
+//      Reg 34: Decoded frame status
+//
+//      In a decode mode Regs 0-31 hold up to 16 decoded channels as
+//  16 bit values, high byte first.  PPM channels are the time from one
+//  leading edge to the next in units of 100 nanoseconds.  SBUS channels
+//  are the raw 11 bit values and iBUS channels are in microseconds.  In
+//  the status register bit 7 is the SBUS failsafe flag, bit 6 is the
+//  SBUS frame lost flag, bits 5 and 4 are SBUS digital channels 18 and
+//  17, and bits 3-0 are one less than the number of channels in the
+//  frame.  Each valid frame is autosent as Regs 0-34 and reading Reg
+//  34 lets the next frame in.
 //
 //      The pulse interval registers has two fields.  The MSB is the
 //  value of the input during the interval being reported by the lower
@@ -63,11 +76,11 @@
 //      The first pin is the input from the RC receiver to the FPGA.  The
 //  second pin is an output that is high when an RC packed is being received.
 //  The second pin would usually be connected to an LED to show activity.
-//  The remaining two pins are used for general purpose I/O.  The low two
-//  bits of register 34 are the value of the pins and bits 4 and 5 control
+//  The remaining two pins are used for general purpose I/O.  Bits 6 and
+//  7 of register 32 are the value of the pins and bits 4 and 5 control
 //  the direction of the third and fourth connector pins respectively.  A
 //  1 in the data direction bits indicates an output.  Reads and write to
-//  the low two bits of register 34 read and set the pins depending on the
+//  bits 6 and 7 of register 32 read and set the pins depending on the
 //  values in the data direction bits.
 //
 //
@@ -84,6 +97,19 @@
 //  used by the host to help determine if the signal is valid or not.
 //      We send the data up to the host at an edge count of two times the
 //  number of channels if none of the intervals exceeded 3.2 milliseconds.
+//      The PPM decoder uses the same 3.2 ms sync interval.  The first
+//  edge after sync is a leading edge and every other edge after it is
+//  the next leading edge.  The frame is sent when the next sync starts.
+//      SBUS is inverted serial at 100000 baud with even parity and two
+//  stop bits.  A frame is a 0x0f header, 22 bytes of sixteen 11 bit
+//  channels LSB first, a flags byte, and an end byte.  iBUS is serial
+//  at 115200 baud with no parity.  A frame is 0x20, 0x40, fourteen 16
+//  bit channels LSB first, and a 16 bit checksum.  A frame starts with
+//  the first byte after 400 microseconds of idle line.  Parity, framing,
+//  header, or checksum errors drop the frame.
+//      The decoded channels are written to one half of a double buffer
+//  and the halves are swapped when a valid frame is complete.  A frame
+//  is dropped if the host has not read the previous frame.
 //
 /////////////////////////////////////////////////////////////////////////
 module rcrx(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
@@ -128,6 +154,45 @@ module rcrx(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     rcrxram16x8 pulseL(doutl,raddr,main[7:0],clk,ramwen); // Register array in RAM
     rcrxram16x8 pulseH(douth,raddr,{ind2,main[14:8]},clk,ramwen);
 
+    // Decoded channels
+    reg    [1:0] mode;       // 0=raw, 1=PPM, 2=SBUS, 3=iBUS
+    reg    [7:0] chh [31:0]; // channel high bytes, two banks of 16
+    reg    [7:0] chl [31:0]; // channel low bytes, two banks of 16
+    reg    cur;              // bank holding the last valid frame
+    reg    [3:0] nch;        // one less than the channels in that frame
+    reg    [3:0] flags;      // SBUS flags of that frame
+    reg    dled;             // packet LED in the decode modes
+    reg    chwen;            // ==1 to write a decoded channel
+    reg    [3:0] chwch;      // channel to write
+    reg    [15:0] chwval;    // value to write
+
+    // PPM decoder
+    reg    pm1, pm2;         // Input delay lines
+    reg    [14:0] pgap;      // time since the last edge
+    reg    [15:0] pper;      // time since the last leading edge
+    reg    prun;             // ==1 while in a frame
+    reg    pphase;           // ==1 if the next edge is a trailing edge
+    reg    [4:0] pch;        // channels in this frame
+
+    // SBUS and iBUS receiver
+    reg    sm, ss;           // Input delay lines
+    wire   ubitin;           // serial input, inverted for SBUS
+    wire   [7:0] ubaud;      // system clocks per bit less one
+    reg    [3:0] uphase;     // 0=idle, else the bit being received
+    reg    [7:0] ucnt;       // clocks to the middle of the next bit
+    reg    [12:0] ugap;      // idle clocks since the last byte
+    reg    [7:0] ubyte;      // received byte, LSB first
+    reg    upar;             // SBUS parity bit
+    reg    [4:0] uidx;       // byte index in the frame
+    reg    ubad;             // ==1 if this frame had an error
+    reg    [18:0] acc;       // SBUS channel bits not yet used
+    reg    [4:0] accn;       // number of bits in acc
+    wire   [18:0] nacc;      // acc with the new byte
+    reg    [3:0] sch;        // next SBUS channel
+    reg    [3:0] sflags;     // SBUS flags of this frame
+    reg    [15:0] isum;      // iBUS checksum
+    reg    [7:0] ilo;        // iBUS low byte
+
     initial
     begin
         iodir = 0;       // spare pins default to input
@@ -138,6 +203,18 @@ module rcrx(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
         main = 0;
         count = 0;
         nchan = 6;
+        mode = 0;
+        cur = 0;
+        nch = 0;
+        flags = 0;
+        dled = 0;
+        chwen = 0;
+        prun = 0;
+        pgap = 0;
+        uphase = 0;
+        ugap = 0;
+        uidx = 0;
+        ubad = 1;
     end
 
 
@@ -156,14 +233,19 @@ module rcrx(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
             iodir <= datin[5:4];
             ioval <= datin[7:6];
         end
-        else if (strobe && myaddr && rdwr && (addr[5:0] == 31))
+        else if (strobe && myaddr && (addr[5:0] == 33) && ~rdwr)
+        begin
+            mode <= datin[1:0];
+            data_ready <= 0;
+        end
+        else if (strobe && myaddr && rdwr && (addr[5:0] == ((mode == 0) ? 31 : 34)))
         begin
             data_ready <= 0;
         end
 
 
         // Do all processing on edge of 100 ns clock
-        else if (n100clk)
+        else if (n100clk && (mode == 0))
         begin
             // Get the input into our clock domain
             ind1 <= rcin;
@@ -212,14 +294,200 @@ module rcrx(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                 main <= 0;           // Get ready for next channel
             end
         end
+
+        // Write decoded channels to the bank not being read
+        chwen <= 0;
+        if (chwen)
+        begin
+            chh[{~cur,chwch}] <= chwval[15:8];
+            chl[{~cur,chwch}] <= chwval[7:0];
+        end
+
+        // PPM decoder
+        if (n100clk)
+        begin
+            pm1 <= rcin;
+            pm2 <= pm1;
+            if (pm1 == pm2)
+            begin
+                if (pgap != 15'h7fff)
+                    pgap <= pgap + 15'h0001;
+                if (pper != 16'hffff)
+                    pper <= pper + 16'h0001;
+                // Sync is the end of the frame
+                if ((pgap == 15'h7ffe) && prun)
+                begin
+                    prun <= 0;
+                    if ((mode == 1) && (pch != 0) && ~data_ready)
+                    begin
+                        cur <= ~cur;
+                        nch <= pch[3:0] - 4'h1;
+                        flags <= 0;
+                        data_ready <= 1;
+                        dled <= 1;
+                    end
+                end
+            end
+            else
+            begin
+                pgap <= 0;
+                if (pgap == 15'h7fff)
+                begin
+                    // First leading edge after sync
+                    prun <= 1;
+                    pphase <= 1;
+                    pper <= 0;
+                    pch <= 0;
+                    if (mode == 1)
+                        dled <= 0;
+                end
+                else if (prun && pphase)
+                begin
+                    pphase <= 0;
+                    pper <= pper + 16'h0001;
+                end
+                else if (prun && (pch == 16))
+                    prun <= 0;       // too many channels
+                else if (prun)
+                begin
+                    // A leading edge ends the channel
+                    pphase <= 1;
+                    pper <= 0;
+                    chwen <= (mode == 1);
+                    chwch <= pch[3:0];
+                    chwval <= pper + 16'h0001;
+                    pch <= pch + 5'h01;
+                end
+            end
+        end
+
+        // SBUS and iBUS serial receiver
+        sm <= rcin;
+        ss <= sm;
+        if ((mode < 2) || (uphase == 0))
+        begin
+            uphase <= 0;
+            if ((mode >= 2) && (ubitin == 0))
+            begin
+                // Start bit.  A long idle starts a new frame.
+                uphase <= 1;
+                ucnt <= {1'b0, ubaud[7:1]};
+                if (ugap == 13'h1fff)
+                begin
+                    uidx <= 0;
+                    ubad <= 0;
+                    dled <= 0;
+                end
+            end
+            else if (ugap != 13'h1fff)
+                ugap <= ugap + 13'h0001;
+        end
+        else if (ucnt != 0)
+            ucnt <= ucnt - 8'h01;
+        else
+        begin
+            ucnt <= ubaud;
+            uphase <= uphase + 4'h1;
+            if (uphase == 1)
+            begin
+                if (ubitin)
+                    uphase <= 0;     // not a start bit
+            end
+            else if (uphase <= 9)
+                ubyte <= {ubitin, ubyte[7:1]};
+            else if ((uphase == 10) && (mode == 2))
+                upar <= ubitin;
+            else
+            begin
+                // Stop bit.  Process the byte.
+                uphase <= 0;
+                ugap <= 0;
+                uidx <= (uidx == 31) ? uidx : uidx + 5'h01;
+                if (~ubitin || ((mode == 2) && (^{ubyte, upar})))
+                    ubad <= 1;       // framing or parity error
+                else if (mode == 2)
+                begin
+                    if (uidx == 0)
+                    begin
+                        ubad <= (ubyte != 8'h0f);
+                        acc <= 0;
+                        accn <= 0;
+                        sch <= 0;
+                    end
+                    else if (uidx <= 22)
+                    begin
+                        if (accn >= 3)
+                        begin
+                            chwen <= 1;
+                            chwch <= sch;
+                            chwval <= {5'h00, nacc[10:0]};
+                            sch <= sch + 4'h1;
+                            acc <= nacc >> 11;
+                            accn <= accn - 5'h03;
+                        end
+                        else
+                        begin
+                            acc <= nacc;
+                            accn <= accn + 5'h08;
+                        end
+                    end
+                    else if (uidx == 23)
+                        sflags <= ubyte[3:0];
+                    else if ((uidx == 24) && ~ubad && ~data_ready)
+                    begin
+                        cur <= ~cur;
+                        nch <= 15;
+                        flags <= sflags;
+                        data_ready <= 1;
+                        dled <= 1;
+                        ubad <= 1;
+                    end
+                end
+                else
+                begin
+                    if (uidx <= 29)
+                        isum <= (uidx == 0) ? {8'h00, ubyte} : isum + {8'h00, ubyte};
+                    if ((uidx == 0) && (ubyte != 8'h20))
+                        ubad <= 1;
+                    else if ((uidx == 1) && (ubyte != 8'h40))
+                        ubad <= 1;
+                    else if ((uidx >= 2) && (uidx <= 29) && ~uidx[0])
+                        ilo <= ubyte;
+                    else if ((uidx >= 2) && (uidx <= 29))
+                    begin
+                        chwen <= 1;
+                        chwch <= uidx[4:1] - 4'h1;
+                        chwval <= {ubyte, ilo};
+                    end
+                    else if (uidx == 30)
+                        ilo <= ubyte;
+                    else if ((uidx == 31) && ~ubad && ~data_ready &&
+                             ({ubyte, ilo} == ~isum))
+                    begin
+                        cur <= ~cur;
+                        nch <= 13;
+                        flags <= 0;
+                        data_ready <= 1;
+                        dled <= 1;
+                        ubad <= 1;
+                    end
+                end
+            end
+        end
     end
 
 
     // Assign the outputs.
     assign myaddr = (addr[11:8] == our_addr) && (addr[7:6] == 0);
     assign datout = (~myaddr) ? datin :
+                    (~strobe && data_ready && (mode != 0)) ? 8'h23 :  // Send up 35 bytes
                     (~strobe && myaddr && data_ready) ? 8'h20 :   // Send up 32 bytes
                     (strobe && (addr[5:0] == 32)) ? {ioval,iodir,led,nchan} :
+                    (strobe && (addr[5:0] == 33)) ? {6'h00,mode} :
+                    (strobe && (addr[5:0] == 34)) ? {flags,nch} :
+                    (strobe && addr[5]) ? 8'h00 :
+                    (strobe && (mode != 0) && (addr[0] == 0)) ? chh[{cur,addr[4:1]}] :
+                    (strobe && (mode != 0)) ? chl[{cur,addr[4:1]}] :
                     (strobe & (addr[0] ==0)) ? douth : 
                     (strobe & (addr[0] ==1)) ? doutl : 
                     8'h00 ; 
@@ -230,7 +498,11 @@ module rcrx(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     assign busy_out = busy_in;
     assign addr_match_out = myaddr | addr_match_in;
 
-    assign pktled = led;
+    assign ubitin = (mode == 2) ? ~ss : ss;
+    assign ubaud = (mode == 2) ? 8'd199 : 8'd173;
+    assign nacc = acc | ({11'h000, ubyte} << accn);
+
+    assign pktled = (mode == 0) ? led : dled;
     assign spare0 = (iodir[0] == 1) ? ioval[0]: 1'bz;
     assign spare1 = (iodir[1] == 1) ? ioval[1]: 1'bz;
 
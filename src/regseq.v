@@ -0,0 +1,390 @@
+// *********************************************************
+// Copyright (c) 2020 Demand Peripherals, Inc.
+// 
+// This file is licensed separately for private and commercial
+// use.  See LICENSE.txt which should have accompanied this file
+// for details.  If LICENSE.txt is not available please contact
+// support@demandperipherals.com to receive a copy.
+// 
+// In general, you may use, modify, redistribute this code, and
+// use any associated patent(s) as long as
+// 1) the above copyright is included in all redistributions,
+// 2) this notice is included in all source redistributions, and
+// 3) this code or resulting binary is not sold as part of a
+//    commercial product.  See LICENSE.txt for definitions.
+// 
+// DPI PROVIDES THE SOFTWARE "AS IS," WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING
+// WITHOUT LIMITATION ANY WARRANTIES OR CONDITIONS OF TITLE,
+// NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR
+// PURPOSE.  YOU ARE SOLELY RESPONSIBLE FOR DETERMINING THE
+// APPROPRIATENESS OF USING OR REDISTRIBUTING THE SOFTWARE (WHERE
+// ALLOWED), AND ASSUME ANY RISKS ASSOCIATED WITH YOUR EXERCISE OF
+// PERMISSIONS UNDER THIS AGREEMENT.
+// 
+// This software may be covered by US patent #10,324,889. Rights
+// to use these patents is included in the license agreements.
+// See LICENSE.txt for more information.
+// *********************************************************
+
+//////////////////////////////////////////////////////////////////////////
+//
+//  File: regseq.v;   Register sequencer, a small bus master
+//
+//      The register sequencer runs a short program that reads and
+//  writes the registers of the other peripherals.  The host loads the
+//  program once and starts it.  After that a fixed sequence such as
+//  "write the espi, wait 50 us, read the adc12, and set an out4 if
+//  the reading is above a threshold" runs at bus speed and with exact
+//  timing, without a USB round trip per step.
+//      The sequencer is a second master on the peripheral bus.  It asks
+//  the bus interface for the bus before each transfer and gives it back
+//  after.  Host commands and autosend polling always take priority, so
+//  a transfer may be delayed by a host command but waits are timed by
+//  the sequencer itself.  Only one regseq is allowed in a design.
+//      The program has up to 32 instructions.  There is an eight bit
+//  accumulator, A, and eight data registers, D0 to D7.  The host can
+//  read and write the data registers to pass parameters to the program.
+//  The SEND instruction copies the data registers to the send buffer
+//  and autosends them to the host.
+//
+//  Registers (8 bit):
+//  0-7:    Send buffer.  Autosend reads these.  Reading the last byte
+//          sent clears the autosend.
+//  8-15:   Data registers D0 to D7.
+//  16:     Control.  Bit 0 set starts the program at instruction 0
+//          with A cleared.  Bit 0 clear stops it.  A read gives 1 while
+//          the program runs.
+//  17:     Program counter (read only)
+//  18:     Accumulator
+//  19:     Status.  Any write clears the flags.
+//              bit 0: bus error.  No peripheral claimed an address.
+//                     The program stops.
+//              bit 1: overrun.  A SEND found the previous data still
+//                     unread.  The new data is dropped.
+//  128+4n: Instruction n, three bytes at 128+4n to 130+4n.  The
+//          fourth byte reads as zero.
+//              byte 0:  bits 7-4: opcode
+//                       bits 3-0: high 4 bits of the address
+//              byte 1:  low 8 bits of the address
+//              byte 2:  immediate value
+//
+//  Instructions, with "addr" the 12 bit peripheral register address
+//  from bytes 0 and 1, "n" the same 12 bits as a count, "t" the low 5
+//  bits of byte 1 as a branch target, and "imm" byte 2:
+//      0   HALT            Stop the program
+//      1   WR   addr,imm   Write imm to addr
+//      2   WRA  addr       Write A to addr
+//      3   RD   addr       Read addr into A
+//      4   WAIT n,unit     Wait n units.  Unit is in bits 1-0 of imm.
+//                          0=1us, 1=10us, 2=100us, 3=1ms
+//      5   WSET addr,imm   Read addr into A until (A & imm) != 0
+//      6   WCLR addr,imm   Read addr into A until (A & imm) == 0
+//      7   LDI  imm        A = imm
+//      8   ANDI imm        A = A & imm
+//      9   ADDI imm        A = A + imm
+//      10  JEQ  t,imm      Go to t if A == imm
+//      11  JNE  t,imm      Go to t if A != imm
+//      12  JGE  t,imm      Go to t if A >= imm, unsigned.  JGE t,0 is
+//                          an unconditional jump.
+//      13  JLT  t,imm      Go to t if A < imm, unsigned
+//      14  MOV  imm        Bit 3 of imm clear: D[imm[2:0]] = A
+//                          Bit 3 of imm set: A = D[imm[2:0]]
+//      15  SEND imm        Copy D0 to D(imm-1) to the send buffer and
+//                          autosend them.  imm is 1 to 8.  Other values
+//                          send all eight.
+//
+//
+//  HOW THIS WORKS
+//      Each instruction takes one clock except bus transfers and waits.
+//  A bus transfer raises mreq and waits for mgnt.  The strobe is high
+//  while both are, and the transfer ends on the first clock without
+//  busy.  The request is then dropped for at least a clock while the
+//  next instruction is decoded so the bus interface can get the bus
+//  back.  WSET and WCLR repeat the read until the condition is met.
+//      A wait prescales the system clock as in the out4 so a wait of n
+//  units is exact to a clock from the start of the WAIT instruction.
+//
+// NOTES:
+//    Our address is on the bus only while the strobe is high so the
+//    sequencer does not look like an autosend poll to the peripherals.
+//    Do not read the registers of a peripheral with an open autosend
+//    stream, such as a gpio4 in event mode.  Any read while the stream
+//    is open returns the next byte of the stream.
+//    Stop the sequencer before changing the program.
+//
+/////////////////////////////////////////////////////////////////////////
+
+// Sequencer states
+`define SQ_EXEC     2'h0     // Decode and run the instruction at pc
+`define SQ_BUS      2'h1     // Doing a bus transfer
+`define SQ_WAIT     2'h2     // Timing a WAIT instruction
+
+// Opcodes
+`define SQ_HALT     4'h0
+`define SQ_WR       4'h1
+`define SQ_WRA      4'h2
+`define SQ_RD       4'h3
+`define SQ_WAITI    4'h4
+`define SQ_WSET     4'h5
+`define SQ_WCLR     4'h6
+`define SQ_LDI      4'h7
+`define SQ_ANDI     4'h8
+`define SQ_ADDI     4'h9
+`define SQ_JEQ      4'ha
+`define SQ_JNE      4'hb
+`define SQ_JGE      4'hc
+`define SQ_JLT      4'hd
+`define SQ_MOV      4'he
+`define SQ_SEND     4'hf
+
+module regseq(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
+       addr_match_in,addr_match_out,datin,datout,
+       mreq,mgnt,maddr,mdatout,mrdwr,mstrobe,mdatin,mbusy,mmatch);
+
+    input  clk;              // system clock
+    input  rdwr;             // direction of this transfer. Read=1; Write=0
+    input  strobe;           // true on full valid command
+    input  [3:0] our_addr;   // high byte of our assigned address
+    input  [11:0] addr;      // address of target peripheral
+    input  busy_in;          // ==1 if a previous peripheral is busy
+    output busy_out;         // ==our busy state if our address, pass through otherwise
+    input  addr_match_in;    // ==1 if a previous peripheral claims the address
+    output addr_match_out;   // ==1 if we claim the above address, pass through otherwise
+    input  [7:0] datin ;     // Data INto the peripheral;
+    output [7:0] datout ;    // Data OUTput from the peripheral, = datin if not us.
+    // Lines to drive the bus as a bus master
+    output mreq;             // ==1 to ask the bus interface for the bus
+    input  mgnt;             // ==1 while we own the bus
+    output [11:0] maddr;     // address of the target peripheral
+    output [7:0] mdatout;    // write data to the target peripheral
+    output mrdwr;            // direction of our transfer. Read=1; Write=0
+    output mstrobe;          // true on our valid command
+    input  [7:0] mdatin;     // read data from the target peripheral
+    input  mbusy;            // ==1 if the target peripheral is busy
+    input  mmatch;           // ==1 if a peripheral claims our address
+
+    wire   myaddr;           // ==1 if a correct read/write on our address
+    wire   mywrite;          // ==1 if a write to one of our registers
+    integer j;               // loop counter
+
+    // Program and registers
+    reg    [7:0] ins0[31:0]; // Instruction opcode and high address bits
+    reg    [7:0] ins1[31:0]; // Instruction low address bits
+    reg    [7:0] ins2[31:0]; // Instruction immediate value
+    reg    [7:0] dreg[7:0];  // Data registers D0 to D7
+    reg    [7:0] sbuf[7:0];  // Send buffer
+    reg    [7:0] acc;        // Accumulator
+    reg    [4:0] pc;         // Program counter
+    reg    [1:0] sst;        // Sequencer state
+    reg    run;              // ==1 while the program runs
+    reg    req;              // ==1 while we want the bus
+    reg    buserr;           // ==1 if no peripheral claimed an address
+    reg    overrun;          // ==1 if a SEND found unread data
+    reg    data_ready;       // ==1 if the send buffer is waiting for the host
+    reg    [3:0] sendcnt;    // Number of bytes in the send buffer
+    reg    [11:0] wcnt;      // Units left in a WAIT
+    reg    [14:0] wpre;      // Clocks into the current unit
+
+    // The current instruction
+    wire   [7:0] curins0;    // Byte 0 of the instruction at pc
+    wire   [3:0] op;         // Opcode
+    wire   [11:0] opaddr;    // Peripheral address, count, or target
+    wire   [7:0] imm;        // Immediate value
+    wire   isread;           // ==1 if the instruction reads the bus
+    wire   jump;             // ==1 if a branch is taken
+
+    initial
+    begin
+        acc = 0;
+        pc = 0;
+        sst = `SQ_EXEC;
+        run = 0;
+        req = 0;
+        buserr = 0;
+        overrun = 0;
+        data_ready = 0;
+        sendcnt = 0;
+        wcnt = 0;
+        wpre = 0;
+        for (j = 0; j < 8; j = j + 1)
+        begin
+            dreg[j] = 0;
+            sbuf[j] = 0;
+        end
+        for (j = 0; j < 32; j = j + 1)
+        begin
+            ins0[j] = 0;
+            ins1[j] = 0;
+            ins2[j] = 0;
+        end
+    end
+
+    always @(posedge clk)
+    begin
+        // Run the program.  Host writes below take priority.
+        if (run)
+        begin
+            if (sst == `SQ_EXEC)
+            begin
+                if (op == `SQ_HALT)
+                    run <= 0;
+                else if ((op == `SQ_WR) || (op == `SQ_WRA) || isread)
+                begin
+                    req <= 1;
+                    sst <= `SQ_BUS;
+                end
+                else if (op == `SQ_WAITI)
+                begin
+                    if (opaddr == 0)
+                        pc <= pc + 5'h01;
+                    else
+                    begin
+                        wcnt <= opaddr;
+                        wpre <= 0;
+                        sst <= `SQ_WAIT;
+                    end
+                end
+                else
+                begin
+                    pc <= (jump) ? opaddr[4:0] : pc + 5'h01;
+                    if (op == `SQ_LDI)
+                        acc <= imm;
+                    if (op == `SQ_ANDI)
+                        acc <= acc & imm;
+                    if (op == `SQ_ADDI)
+                        acc <= acc + imm;
+                    if ((op == `SQ_MOV) && (imm[3] == 0))
+                        dreg[imm[2:0]] <= acc;
+                    if ((op == `SQ_MOV) && (imm[3] == 1))
+                        acc <= dreg[imm[2:0]];
+                    if ((op == `SQ_SEND) && data_ready)
+                        overrun <= 1;
+                    else if (op == `SQ_SEND)
+                    begin
+                        for (j = 0; j < 8; j = j + 1)
+                            sbuf[j] <= dreg[j];
+                        sendcnt <= ((imm[3:0] == 0) || (imm[3:0] > 8)) ? 4'h8 : imm[3:0];
+                        data_ready <= 1;
+                    end
+                end
+            end
+            else if (sst == `SQ_BUS)
+            begin
+                // Transfer ends on the first granted clock without busy
+                if (mgnt && ~mbusy)
+                begin
+                    req <= 0;
+                    sst <= `SQ_EXEC;
+                    if (~mmatch)
+                    begin
+                        buserr <= 1;
+                        run <= 0;
+                    end
+                    else
+                    begin
+                        if (isread)
+                            acc <= mdatin;
+                        // WSET and WCLR stay on this instruction until done
+                        if (~(((op == `SQ_WSET) && ((mdatin & imm) == 0)) ||
+                              ((op == `SQ_WCLR) && ((mdatin & imm) != 0))))
+                            pc <= pc + 5'h01;
+                    end
+                end
+            end
+            else   // `SQ_WAIT
+            begin
+                if (wpre == unitlen(imm[1:0]))
+                begin
+                    wpre <= 0;
+                    if (wcnt == 1)
+                    begin
+                        sst <= `SQ_EXEC;
+                        pc <= pc + 5'h01;
+                    end
+                    wcnt <= wcnt - 12'h001;
+                end
+                else
+                    wpre <= wpre + 15'h0001;
+            end
+        end
+
+        // Reading the last byte of the send buffer clears the autosend
+        if (strobe & myaddr & rdwr & (addr[7:0] == {4'h0, sendcnt - 4'h1}))
+            data_ready <= 0;
+
+        if (mywrite)
+        begin
+            if (addr[7:3] == 1)
+                dreg[addr[2:0]] <= datin;
+            if (addr[7:0] == 16)
+            begin
+                run <= datin[0];
+                pc <= 0;
+                acc <= 0;
+                req <= 0;
+                sst <= `SQ_EXEC;
+            end
+            if (addr[7:0] == 18)
+                acc <= datin;
+            if (addr[7:0] == 19)
+            begin
+                buserr <= 0;
+                overrun <= 0;
+            end
+            if ((addr[7] == 1) && (addr[1:0] == 0))
+                ins0[addr[6:2]] <= datin;
+            if ((addr[7] == 1) && (addr[1:0] == 1))
+                ins1[addr[6:2]] <= datin;
+            if ((addr[7] == 1) && (addr[1:0] == 2))
+                ins2[addr[6:2]] <= datin;
+        end
+    end
+
+    // Clocks per time unit less one
+    function [14:0] unitlen;
+        input [1:0] unit;
+        unitlen = (unit == 0) ? 15'd19 :
+                  (unit == 1) ? 15'd199 :
+                  (unit == 2) ? 15'd1999 : 15'd19999;
+    endfunction
+
+    assign curins0 = ins0[pc];
+    assign op = curins0[7:4];
+    assign opaddr = {curins0[3:0], ins1[pc]};
+    assign imm = ins2[pc];
+    assign isread = (op == `SQ_RD) || (op == `SQ_WSET) || (op == `SQ_WCLR);
+    assign jump = ((op == `SQ_JEQ) && (acc == imm)) ||
+                  ((op == `SQ_JNE) && (acc != imm)) ||
+                  ((op == `SQ_JGE) && (acc >= imm)) ||
+                  ((op == `SQ_JLT) && (acc < imm));
+
+    // Drive the bus while the bus interface lets us
+    assign mreq = req;
+    assign maddr = (req) ? opaddr : 12'h000;
+    assign mdatout = (op == `SQ_WR) ? imm : acc;
+    assign mrdwr = isread;
+    assign mstrobe = req & mgnt;
+
+    assign mywrite = (strobe & myaddr & ~rdwr);
+
+    assign myaddr = (addr[11:8] == our_addr);
+    assign datout = (~myaddr) ? datin :
+                     (~strobe & data_ready) ? {4'h0,sendcnt} :
+                     (~strobe) ? 8'h00 :
+                     (addr[7:3] == 0) ? sbuf[addr[2:0]] :
+                     (addr[7:3] == 1) ? dreg[addr[2:0]] :
+                     (addr[7:0] == 16) ? {7'h00,run} :
+                     (addr[7:0] == 17) ? {3'h0,pc} :
+                     (addr[7:0] == 18) ? acc :
+                     (addr[7:0] == 19) ? {6'h00,overrun,buserr} :
+                     ((addr[7] == 1) && (addr[1:0] == 0)) ? ins0[addr[6:2]] :
+                     ((addr[7] == 1) && (addr[1:0] == 1)) ? ins1[addr[6:2]] :
+                     ((addr[7] == 1) && (addr[1:0] == 2)) ? ins2[addr[6:2]] :
+                     8'h00;
+
+    // Loop in-to-out where appropriate
+    assign busy_out = busy_in;
+    assign addr_match_out = myaddr | addr_match_in;
+
+endmodule
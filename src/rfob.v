@@ -37,6 +37,23 @@
 //      Reg 31: Data bit 31
 //      Reg 32: Number of valid bits in packet
 //      Reg 33: Number of 10us samples in a bit time.  Determines BPS.
+//      Reg 34: Queue mode in bit 0.  Default is off.
+//      Reg 35: Queue status.  Bit 7 is set if a frame was lost to a
+//              full queue, bits 3-0 are the number of queued frames.
+//
+//      In queue mode frames of up to 128 bits are stored packed in a
+//  15 frame queue.  A bit count of zero in Reg 32 accepts any frame
+//  of at least 8 bits.  Each frame is autosent as its bit count, a
+//  16 bit span in units of 10 us from the start of the first bit to
+//  the start of the last bit, and the bits packed eight to a byte
+//  with the first bit in the MSB of the first byte.  The bit rate is
+//  the bit count divided by the span.  The autosend opens on a poll
+//  of Reg 0 and reads the registers in order from Reg 0.  Each in-order
+//  read returns the next byte of the frame.  The frame is removed from
+//  the queue when its last byte is read.  Any other access ends the
+//  autosend and leaves the frame in the queue to be sent again.  The
+//  bit count stops at 255 so a long burst of noise is never taken as
+//  a frame.
 //
 //      The keyfob receiver card has a 315 MHz receiver and a circuit
 //  to convert the levels at the receiver to 3.3 volts.
@@ -65,6 +82,12 @@
 //  bits received to the number we expect.
 //      We send the data up to the host at the end of a packet.  We send
 //  just the bits we have received.
+//      In queue mode the bits are shifted into a byte and each full byte
+//  is written to the frame's slot in a block RAM.  At the end of a valid
+//  frame the last partial byte and the header are written and the frame
+//  is added to the queue.  The receiver goes straight back to looking
+//  for the next preamble so bursts of frames are not lost while the
+//  host reads the queue.
 //
 /////////////////////////////////////////////////////////////////////////
 module rfob(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
@@ -93,14 +116,15 @@ module rfob(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     reg    [7:0] scount;     // sample counter.  Goes zero to smplcnt
     reg    [7:0] smplsum;    // number of samples with RF data in a 1
     reg    dflt;             // data line but in our clock domain
-    reg    [4:0] pktbits;    // expected number of bits.  Set by host.
-    reg    [4:0] bitcnt;     // number of bits in pkt so far
+    reg    [7:0] pktbits;    // expected number of bits.  Set by host.
+    reg    [7:0] bitcnt;     // number of bits in pkt so far
     reg    [3:0] main;       // main timer for pulse widths and pre/postamble
     reg    [2:0] state;      // ==0 if waiting for pkt start
                              // ==1 if in pkt, waiting for first bit
                              // ==2 if in bit and summing the num of high input samples
                              // ==3 if in low time waiting for next but or in postamble
                              // ==4 if pkt complete, wait to send to host
+                             // ==5 if writing the pkt to the queue
     reg    databit;          // latched value of sampled bit
     reg    pktflag;          // toggled on each valid packet
 
@@ -114,6 +138,29 @@ module rfob(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     wire   rxwen;            // Rx RAM write enable
     rfram32x1 rfrx(rxout,rxaddr,rxin,clk,wen);
 
+    // Frame queue
+    reg    qmode;            // ==1 to queue packed frames
+    reg    [7:0] qbyte;      // bits of the byte being received
+    reg    [15:0] span;      // time since the start of the first bit
+    reg    [15:0] fspan;     // span at the start of the last bit
+    reg    [1:0] qstep;      // step in writing the end of the frame
+    reg    [3:0] wp;         // slot being received, queue write pointer
+    reg    [3:0] rp;         // queue read pointer
+    wire   [3:0] qcnt;       // number of frames in the queue
+    reg    qlost;            // ==1 if a frame was lost to a full queue
+    reg    [7:0] qbits [15:0];  // bit count of each queued frame
+    wire   qvalid;           // ==1 if the frame ending now is valid
+    reg    qwen;             // queue RAM write enable
+    reg    [4:0] qwidx;      // queue RAM byte in the slot
+    reg    [7:0] qwdata;     // queue RAM write data
+    wire   [7:0] qdout;      // queue RAM output at the read pointer
+    reg    upopen;           // ==1 while an autosend of a frame is open
+    reg    [4:0] upidx;      // next byte of the frame to send
+    wire   [4:0] uplen;      // bytes in the frame at the read pointer
+    wire   uprd;             // ==1 on an in-order read of a frame byte
+    wire   poll;             // ==1 on an autosend poll
+    rfram2kx8 rfq(clk, {2'b00,wp,qwidx}, qwdata, qwen, {2'b00,rp,upidx}, qdout);
+
 
     initial
     begin
@@ -123,19 +170,32 @@ module rfob(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
         pktbits = 5'd24;     // most xmitters have 24 bits of data
         main = 0;
         pktflag = 0;
+        qmode = 0;
+        wp = 0;
+        rp = 0;
+        qlost = 0;
+        qwen = 0;
+        upopen = 0;
+        upidx = 0;
     end
 
     always @(posedge clk)
     begin
         // Handle reads and writes from the host
-        if (strobe && myaddr && (addr[4] == 1) && rdwr)
+        if (strobe && myaddr && (addr[4] == 1) && rdwr && ~qmode)
             state <= 0;                // Clear data ready on a read
         else if (strobe && myaddr && (addr[5] == 1) && ~rdwr)  // write to config?
         begin
-            if (addr[0] == 0)
-                pktbits <= datin[4:0];    // Number of bits in a packet
-            else
+            if (addr[1:0] == 0)
+                pktbits <= datin[7:0];    // Number of bits in a packet
+            else if (addr[1:0] == 1)
                 smplcnt <= datin[7:0];    // Number of 10us samples in a bit
+            else if (addr[1:0] == 2)
+            begin
+                qmode <= datin[0];        // Queue packed frames
+                state <= 0;
+                main <= 0;
+            end
         end
 
         // Look for preamble on edges of m1clk
@@ -154,6 +214,9 @@ module rfob(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
             dflt <= rfdin;
 
             // run the state machine
+            if ((state == 2) || (state == 3))
+                span <= span + 16'h0001;
+
             if (state == 0)    // reset preamble counter on non-zero input
             begin
                 // A valid preamble is low for greater than about 10 ms
@@ -172,6 +235,8 @@ module rfob(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                     scount <= smplcnt;
                     smplsum <= 0;
                     bitcnt <= 0;
+                    span <= 0;
+                    fspan <= 0;
                 end
             end
             else if (state == 2)
@@ -199,8 +264,10 @@ module rfob(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                 // end of the packet.
                 if (dflt == 1)
                 begin
-                    // Saw a high edge, Go to in-bit
-                    bitcnt <= bitcnt + 5'h01;
+                    // Saw a high edge, Go to in-bit.  Stop the count at 255.
+                    if (bitcnt != 8'hff)
+                        bitcnt <= bitcnt + 8'h01;
+                    fspan <= span;
                     scount <= smplcnt;
                     smplsum <= 0;
                     state <= 2;
@@ -211,7 +278,12 @@ module rfob(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                     scount <= scount - 8'h01;
                     if (scount == 0)    // 255 counts to reach zero.  No more bits
                     begin
-                        if (bitcnt == pktbits)
+                        if (qmode && qvalid)
+                        begin
+                            state <= 5; // write the end of the frame
+                            qstep <= 0;
+                        end
+                        else if (~qmode && (bitcnt == pktbits))
                         begin
                             state <= 4;
                             pktflag <= ~pktflag;
@@ -229,18 +301,117 @@ module rfob(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                     // wait here for a host read then go to wait-for-preamble state
             end
         end
+
+        // Pack the bits of the frame into the queue RAM
+        qwen <= 0;
+        if (qmode && u10clk && wen && (state == 3) && (bitcnt < 128))
+        begin
+            qbyte <= {qbyte[6:0], databit};
+            if (bitcnt[2:0] == 7)
+            begin
+                qwen <= 1;
+                qwidx <= 5'd3 + {1'b0, bitcnt[6:3]};
+                qwdata <= {qbyte[6:0], databit};
+            end
+        end
+        else if (state == 5)
+        begin
+            // Write the partial byte, the bit count, and the span
+            qstep <= qstep + 2'h1;
+            if (qstep == 0)
+            begin
+                qwen <= (bitcnt < 128) && (bitcnt[2:0] != 7);
+                qwidx <= 5'd3 + {1'b0, bitcnt[6:3]};
+                qwdata <= qbyte << (3'h7 - bitcnt[2:0]);
+            end
+            else if (qstep == 1)
+            begin
+                qwen <= 1;
+                qwidx <= 0;
+                qwdata <= bitcnt;
+            end
+            else if (qstep == 2)
+            begin
+                qwen <= 1;
+                qwidx <= 1;
+                qwdata <= fspan[15:8];
+            end
+            else
+            begin
+                qwen <= 1;
+                qwidx <= 2;
+                qwdata <= fspan[7:0];
+                // Add the frame to the queue if there is room
+                if ((wp + 4'h1) == rp)
+                    qlost <= 1;
+                else
+                begin
+                    qbits[wp] <= bitcnt;
+                    wp <= wp + 4'h1;
+                    pktflag <= ~pktflag;
+                end
+                state <= 0;     // go wait for next preamble
+                main <= 0;
+            end
+        end
+
+        // Send the frame at the read pointer on a poll
+        if (strobe && myaddr && ~rdwr && (addr[5:0] == 34))
+        begin
+            rp <= wp;           // empty the queue on a mode change
+            upopen <= 0;
+            upidx <= 0;
+        end
+        else if (~upopen & qmode & (qcnt != 0) & poll)
+        begin
+            upopen <= 1;
+            upidx <= 0;
+        end
+        else if (uprd)
+        begin
+            if (upidx == (uplen - 5'h01))
+            begin
+                upopen <= 0;
+                upidx <= 0;
+                rp <= rp + 4'h1;
+            end
+            else
+                upidx <= upidx + 5'h01;
+        end
+        else if (upopen & strobe & myaddr)
+        begin
+            upopen <= 0;        // any other access ends the autosend
+            upidx <= 0;
+        end
+        if (strobe && myaddr && rdwr && (addr[5:0] == 35))
+            qlost <= 0;
     end
 
     // Route the RAM and output lines
-    assign rxaddr = (strobe & myaddr) ? addr[4:0] : bitcnt ;
+    assign rxaddr = (strobe & myaddr) ? addr[4:0] : bitcnt[4:0] ;
     assign wen  = (state == 3) && ((dflt == 1) || (scount == 0));
     // an input bit is 'one' if more than half the samples are one.
     assign rxin = databit;
 
+    // The queue
+    assign qcnt = wp - rp;
+    assign qvalid = (bitcnt <= 128) &&
+                    ((pktbits == 0) ? (bitcnt >= 8) : (bitcnt == pktbits));
+    assign uplen = 5'd3 + ((qbits[rp] + 8'd7) >> 3);
+    assign uprd = strobe & myaddr & rdwr & upopen & (addr[5:0] == {1'b0, upidx});
+    assign poll = myaddr & ~strobe & (addr[5:0] == 0);
+
     // Assign the outputs.
     assign myaddr = (addr[11:8] == our_addr) && (addr[7:6] == 0);
     assign datout = (~myaddr) ? datin :
+                    (poll && upopen) ? {3'h0,uplen} :    // send the frame
+                    (poll && qmode && (qcnt != 0)) ? {3'h0,uplen} :
                     (~strobe && (state == 4)) ? 8'h18 :  // 24 bytes to send
+                    (uprd) ? qdout :
+                    (strobe && (addr[5:0] == 32)) ? pktbits :
+                    (strobe && (addr[5:0] == 33)) ? smplcnt :
+                    (strobe && (addr[5:0] == 34)) ? {7'h0,qmode} :
+                    (strobe && (addr[5:0] == 35)) ? {qlost,3'h0,qcnt} :
                     (strobe) ? {7'h0,rxout} : 
                     8'h00 ; 
 
@@ -281,3 +452,47 @@ module rfram32x1(dout,addr,din,wclk,wen);
 endmodule
 
 
+// Frame queue.  Port A is written by the receiver and port B is read
+// by the host.
+module rfram2kx8(clk, waddr, wdata, wen, raddr, rdata);
+    input clk;
+    input [10 : 0] waddr;
+    input [7 : 0] wdata;
+    input wen;
+    input [10 : 0] raddr;
+    output [7 : 0] rdata;
+
+    wire DOPA;
+    wire DOPB;
+    wire [7:0] DOA;
+    RAMB16_S9_S9 #(
+        .INIT_A(9'h000),  // Value of output RAM registers on Port A at startup
+        .INIT_B(9'h000),  // Value of output RAM registers on Port B at startup
+        .SRVAL_A(9'h000), // Port A output value upon SSR assertion
+        .SRVAL_B(9'h000), // Port B output value upon SSR assertion
+        .WRITE_MODE_A("WRITE_FIRST"), // WRITE_FIRST, READ_FIRST or NO_CHANGE
+        .WRITE_MODE_B("WRITE_FIRST"), // WRITE_FIRST, READ_FIRST or NO_CHANGE
+        .SIM_COLLISION_CHECK("NONE")  // "NONE", "WARNING_ONLY", "GENERATE_X_ONLY", "ALL"
+       ) RAMB16_S9_S9_inst (
+          .DOA(DOA),      // Port A 8-bit Data Output
+          .DOB(rdata),    // Port B 8-bit Data Output
+          .DOPA(DOPA),    // Port A 1-bit Parity Output
+          .DOPB(DOPB),    // Port B 1-bit Parity Output
+          .ADDRA(waddr),  // Port A 11-bit Address Input
+          .ADDRB(raddr),  // Port B 11-bit Address Input
+          .CLKA(clk),     // Port A Clock
+          .CLKB(clk),     // Port B Clock
+          .DIA(wdata),    // Port A 8-bit Data Input
+          .DIB(8'h00),    // Port B 8-bit Data Input
+          .DIPA(1'b0),    // Port A 1-bit parity Input
+          .DIPB(1'b0),    // Port B 1-bit parity Input
+          .ENA(1'b1),     // Port A RAM Enable Input
+          .ENB(1'b1),     // Port B RAM Enable Input
+          .SSRA(1'b0),    // Port A Synchronous Set/Reset Input
+          .SSRB(1'b0),    // Port B Synchronous Set/Reset Input
+          .WEA(wen),      // Port A Write Enable Input
+          .WEB(1'b0)      // Port B Write Enable Input
+       );
+
+endmodule
+
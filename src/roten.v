@@ -38,13 +38,38 @@
 //
 //  up to the host on any change.
 //
+//      The autosends can be rate limited with a holdoff time.  Counts
+//  keep accumulating during the holdoff so none are lost.  A velocity
+//  and an acceleration are computed in hardware for user interface
+//  acceleration curves.  The velocity is the signed count in the last
+//  velocity window and the acceleration is the change in velocity from
+//  the window before.  Both saturate at 8 bits.
+//
 //  Registers (8 bit):
-//  0:   MSB is the button state.  Low 7 bits are quadrature count
+//  0:   MSB is the button state.  Low 7 bits are quadrature count.
+//       The count saturates at 7 bits and reading this register takes
+//       the value read out of the count.  The rest is sent next time.
 //  1:   LED state is the LSB.
+//  2:   Autosend holdoff in milliseconds.  After an autosend is read
+//       the next is held off this long.  0, the default, sends on any
+//       change.
+//  3:   Configuration.  Bit 0 set sends Regs 0, 4, 5, 6, and 7 in each
+//       autosend instead of just Reg 0.
+//  4,5: Signed 16 bit quadrature count, high byte first
+//  6:   Velocity, a signed count per velocity window
+//  7:   Acceleration, the change in velocity per window
+//  8:   Velocity window in milliseconds.  Default is 50.  0 freezes
+//       the velocity.
+//
+//  In extended mode the autosend opens on a poll of Reg 0 and reads
+//  Regs 0 to 4 in order.  These reads return Regs 0, 4, 5, 6, and 7.
+//  The count is reduced by the amount sent when the last byte is read.
+//  Any other access ends the autosend and the counts are sent again on
+//  the next poll.
 //
 /////////////////////////////////////////////////////////////////////////
 module roten(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
-       addr_match_in,addr_match_out,datin,datout, btn, q1, q2, led);
+       addr_match_in,addr_match_out,datin,datout, m1clk, btn, q1, q2, led);
     input  clk;              // system clock
     input  rdwr;             // direction of this transfer. Read=1; Write=0
     input  strobe;           // true on full valid command
@@ -56,6 +81,7 @@ module roten(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     output addr_match_out;   // ==1 if we claim the above address, pass through otherwise
     input  [7:0] datin ;     // Data INto the peripheral;
     output [7:0] datout ;    // Data OUTput from the peripheral, = datin if not us.
+    input  m1clk;            // 1 millisecond clock pulse
     input  btn;              // center push button on the encoder switch
     input  q1;               // input 1 on the encoder
     input  q2;               // input 2 on the encoder
@@ -65,7 +91,7 @@ module roten(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     wire   myaddr;           // ==1 if a correct read/write on our address
  
     // Counter state and signals
-    reg    [6:0] count;      // signed 7 bit count of quadrature transitions
+    reg    [15:0] count;     // signed count of quadrature transitions
     wire   q_inc;            // ==1 to increment quadrature counter
     wire   q_dec;            // ==1 to decrement quadrature counter
     reg    data_avail;       // Flag to say data is ready to send
@@ -76,25 +102,101 @@ module roten(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     reg    at_init;          // at init take inputs as past state --
                              // this prevents bogus counts at start-up
 
+    // Rate limit and velocity
+    reg    [7:0] holdoff;    // autosend holdoff in ms
+    reg    [7:0] hold;       // ms left in the holdoff
+    reg    ext;              // ==1 to send count, velocity, and acceleration
+    reg    [7:0] velwin;     // velocity window in ms
+    reg    [7:0] wtime;      // ms into the velocity window
+    reg    winend;           // ==1 at the end of a velocity window
+    reg    [15:0] wcount;    // signed count in this window
+    wire   [15:0] wnext;     // wcount with this transition
+    reg    [7:0] vel;        // signed count in the last window
+    reg    [7:0] acc;        // change in velocity
+    wire   sendok;           // ==1 if there is data and no holdoff
+    reg    upopen;           // ==1 while an extended autosend is open
+    reg    [2:0] upidx;      // next byte of the autosend
+    reg    [15:0] upcnt;     // count being sent
+    wire   uprd;             // ==1 on an in-order read of an autosend byte
+    wire   poll;             // ==1 on an autosend poll
+    wire   [6:0] cnt7;       // count as read from Reg 0
+
     initial
     begin
         ledst = 0;
         data_avail = 0;
         at_init = 1;
+        count = 0;
+        holdoff = 0;
+        hold = 0;
+        ext = 0;
+        velwin = 50;
+        wtime = 0;
+        winend = 0;
+        wcount = 0;
+        vel = 0;
+        acc = 0;
+        upopen = 0;
+        upidx = 0;
     end
 
     always @(posedge clk)
     begin
+        // Millisecond timers for the holdoff and velocity window
+        if (m1clk)
+        begin
+            if (hold != 0)
+                hold <= hold - 8'h01;
+            if (velwin != 0)
+            begin
+                if ((wtime + 8'h01) >= velwin)
+                begin
+                    wtime <= 0;
+                    winend <= 1;
+                end
+                else
+                    wtime <= wtime + 8'h01;
+            end
+        end
+
+        // Open an extended autosend on a poll
+        if (~upopen & ext & sendok & poll)
+        begin
+            upopen <= 1;
+            upidx <= 0;
+            upcnt <= count;
+        end
+
         if (strobe & myaddr & ~rdwr)  // latch data on a write
         begin
-            if (addr[0] == 1)
+            if (addr[3:0] == 1)
                 ledst <= datin[0];
+            else if (addr[3:0] == 2)
+                holdoff <= datin;
+            else if (addr[3:0] == 3)
+                ext <= datin[0];
+            else if (addr[3:0] == 8)
+                velwin <= datin;
+        end
+        else if (uprd)
+        begin
+            upidx <= upidx + 3'h1;
+            if (upidx == 4)
+            begin
+                // Done.  Keep the counts that came in during the autosend.
+                upopen <= 0;
+                data_avail <= (count != upcnt);
+                count <= count - upcnt;
+                hold <= holdoff;
+            end
         end
-        else if (strobe & myaddr & rdwr & (addr[0] == 0)) // else if a read from the host
+        else if (strobe & myaddr & rdwr & (addr[3:0] == 0)) // else if a read from the host
         begin
-            // Clear data_available if we are sending the count up to the host
-            data_avail <= 0;
-            count <= 0;
+            // Take the count read out of the count.  Keep data_avail if
+            // the count did not fit in 7 bits.
+            data_avail <= (count != {{9{cnt7[6]}}, cnt7});
+            count <= count - {{9{cnt7[6]}}, cnt7};
+            hold <= holdoff;
         end
         else
         begin     // no host activity and so do normal processing
@@ -115,15 +217,28 @@ module roten(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                 q2_1 <= q2;
                 q2_2 <= q2_1;
 
+                // Velocity and acceleration at the end of each window
+                if (winend)
+                begin
+                    winend <= 0;
+                    wcount <= 0;
+                    vel <= sat8(wnext);
+                    acc <= sat8(wnext - {{8{vel[7]}},vel});
+                end
+                else
+                    wcount <= wnext;
+
                 // increment or decrement the count if needed
                 if (q_inc)
                 begin
-                    count <= count + 7'h01;
+                    if (count != 16'h7fff)
+                        count <= count + 16'h0001;
                     data_avail <= 1;
                 end
                 else if (q_dec)
                 begin
-                    count <= count - 7'h01;
+                    if (count != 16'h8000)
+                        count <= count - 16'h0001;
                     data_avail <= 1;
                 end
 
@@ -136,6 +251,10 @@ module roten(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                 end
             end
         end
+
+        // Any access other than the next in-order read ends the autosend
+        if (upopen & strobe & myaddr & ~uprd)
+            upopen <= 0;
     end
 
 
@@ -144,16 +263,49 @@ module roten(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                     ((q2_2 != q2_1) && (~(q1_2 ^ q2_2)));
     assign q_dec = ((q1_2 != q1_1) && (~(q1_2 ^ q2_2))) ||
                     ((q2_2 != q2_1) && (q1_2 ^ q2_2));
+    assign wnext = (q_inc && (wcount != 16'h7fff)) ? (wcount + 16'h0001) :
+                   (q_dec && (wcount != 16'h8000)) ? (wcount - 16'h0001) : wcount;
+
+    // Saturate a signed count to 8 or 7 bits
+    function [7:0] sat8;
+        input [15:0] v;
+        sat8 = (~v[15] && (v[14:7] != 8'h00)) ? 8'h7f :
+               (v[15] && (v[14:7] != 8'hff)) ? 8'h80 : v[7:0];
+    endfunction
+    function [6:0] sat7;
+        input [15:0] v;
+        sat7 = (~v[15] && (v[14:6] != 9'h000)) ? 7'h3f :
+               (v[15] && (v[14:6] != 9'h1ff)) ? 7'h40 : v[6:0];
+    endfunction
 
 
     // assign bus and I/O lines
     assign led = ledst;
 
-    assign myaddr = (addr[11:8] == our_addr) && (addr[7:1] == 0);
+    assign sendok = data_avail && (hold == 0);
+    assign uprd = strobe & myaddr & rdwr & upopen & (addr[3:0] == {1'b0, upidx});
+    assign poll = myaddr & ~strobe & (addr[3:0] == 0);
+    assign cnt7 = sat7(count);
+
+    assign myaddr = (addr[11:8] == our_addr) && (addr[7:4] == 0) && (addr[3:0] < 9);
     assign datout = (~myaddr) ? datin : 
-                    (~strobe && data_avail) ? 8'h01 :  // Just one byte to send up
-                    (strobe && (addr[0] == 0)) ? {~btnst,count} : // button is active low
-                    (strobe && (addr[0] == 1)) ? {7'h00,ledst} :
+                    (poll && upopen) ? 8'h05 :         // Count, velocity, and acceleration
+                    (poll && sendok && ext) ? 8'h05 :
+                    (~strobe && sendok) ? 8'h01 :  // Just one byte to send up
+                    (uprd && (upidx == 0)) ? {~btnst,sat7(upcnt)} :
+                    (uprd && (upidx == 1)) ? upcnt[15:8] :
+                    (uprd && (upidx == 2)) ? upcnt[7:0] :
+                    (uprd && (upidx == 3)) ? vel :
+                    (uprd) ? acc :
+                    (strobe && (addr[3:0] == 0)) ? {~btnst,cnt7} : // button is active low
+                    (strobe && (addr[3:0] == 1)) ? {7'h00,ledst} :
+                    (strobe && (addr[3:0] == 2)) ? holdoff :
+                    (strobe && (addr[3:0] == 3)) ? {7'h00,ext} :
+                    (strobe && (addr[3:0] == 4)) ? count[15:8] :
+                    (strobe && (addr[3:0] == 5)) ? count[7:0] :
+                    (strobe && (addr[3:0] == 6)) ? vel :
+                    (strobe && (addr[3:0] == 7)) ? acc :
+                    (strobe && (addr[3:0] == 8)) ? velwin :
                     8'h00 ;
 
     // Loop in-to-out where appropriate
@@ -0,0 +1,380 @@
+// *********************************************************
+// Copyright (c) 2020 Demand Peripherals, Inc.
+// 
+// This file is licensed separately for private and commercial
+// use.  See LICENSE.txt which should have accompanied this file
+// for details.  If LICENSE.txt is not available please contact
+// support@demandperipherals.com to receive a copy.
+// 
+// In general, you may use, modify, redistribute this code, and
+// use any associated patent(s) as long as
+// 1) the above copyright is included in all redistributions,
+// 2) this notice is included in all source redistributions, and
+// 3) this code or resulting binary is not sold as part of a
+//    commercial product.  See LICENSE.txt for definitions.
+// 
+// DPI PROVIDES THE SOFTWARE "AS IS," WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING
+// WITHOUT LIMITATION ANY WARRANTIES OR CONDITIONS OF TITLE,
+// NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR
+// PURPOSE.  YOU ARE SOLELY RESPONSIBLE FOR DETERMINING THE
+// APPROPRIATENESS OF USING OR REDISTRIBUTING THE SOFTWARE (WHERE
+// ALLOWED), AND ASSUME ANY RISKS ASSOCIATED WITH YOUR EXERCISE OF
+// PERMISSIONS UNDER THIS AGREEMENT.
+// 
+// This software may be covered by US patent #10,324,889. Rights
+// to use these patents is included in the license agreements.
+// See LICENSE.txt for more information.
+// *********************************************************
+//////////////////////////////////////////////////////////////////////////
+//
+//  File: roten4.v;   Four rotary encoders on an io8 card
+//
+//      This peripheral is intended to be part of a user interface.  It
+//  counts four quadrature rotary encoders wired to the eight inputs of
+//  an io8 card.  Encoder n uses inputs 2n and 2n+1.  The card has no
+//  spare inputs so there are no push buttons.  The eight outputs of
+//  the card are general purpose outputs, usually for LEDs.
+//      The counts, holdoff, velocity, and acceleration work as in the
+//  roten peripheral.
+//
+//  Registers (8 bit):
+//  0-3:   Saturated 7 bit count of encoders 0 to 3.  Reading the
+//         register takes the value read out of the count.  The rest
+//         is sent next time.
+//  4:     Output values.  Bit 0 is pin 1.
+//  5:     Autosend holdoff in milliseconds.  0, the default, sends on
+//         any change.
+//  6:     Configuration.  Bit 0 set sends Regs 16-31 in each autosend
+//         instead of Regs 0-3.
+//  7:     Velocity window in milliseconds.  Default is 50.
+//  8:     Scan dwell time in sysclks as in the io8.  Zero gives a 10
+//         microsecond dwell for long cables.
+//  16+4n: Signed 16 bit count of encoder n, high byte.  Reading the
+//         high byte latches the low byte and clears the count.
+//  17+4n: Signed 16 bit count of encoder n, low byte
+//  18+4n: Velocity of encoder n, a signed count per velocity window
+//  19+4n: Acceleration of encoder n, the change in velocity per window
+//
+//  In extended mode the autosend opens on a poll of Reg 0 and reads
+//  Regs 0 to 15 in order.  These reads return Regs 16 to 31.  Any other
+//  access ends the autosend.  Counts not yet sent are sent again on
+//  the next poll.
+//
+//
+//  HOW THIS WORKS
+//      The inputs are scanned continuously with the io8 card state
+//  machine.  See io8.v for a description of the card and the states.
+//  At the end of each scan the inputs are compared to those of the
+//  previous scan to count the encoders.
+//
+/////////////////////////////////////////////////////////////////////////
+module roten4(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
+       addr_match_in,addr_match_out,datin,datout,
+       u10clk, m1clk, pin2, pin4, pin6, pin8);
+
+    input  clk;              // system clock
+    input  rdwr;             // direction of this transfer. Read=1; Write=0
+    input  strobe;           // true on full valid command
+    input  [3:0] our_addr;   // high byte of our assigned address
+    input  [11:0] addr;      // address of target peripheral
+    input  busy_in;          // ==1 if a previous peripheral is busy
+    output busy_out;         // ==our busy state if our address, pass through otherwise
+    input  addr_match_in;    // ==1 if a previous peripheral claims the address
+    output addr_match_out;   // ==1 if we claim the above address, pass through otherwise
+    input  [7:0] datin ;     // Data INto the peripheral;
+    output [7:0] datout ;    // Data OUTput from the peripheral, = datin if not us.
+    input  u10clk;           // 10 microsecond clock pulse
+    input  m1clk;            // 1 millisecond clock pulse
+    output pin2;             // Pin2 to the io8 card.  Clock control and data.
+    output pin4;             // Pin4 to the io8 card.  Clock control.
+    output pin6;             // Pin6 to the io8 card.  Clock control.
+    input  pin8;             // Serial data from the io8
+
+    // Card scan state
+    reg    [2:0] bst;        // Bit number for current card access
+    reg    [3:0] gst;        // global state for xfer from card
+    reg    sample;           // used to bring pin8 into our clock domain
+    reg    [6:0] scancfg;    // dwell time
+    reg    [6:0] dwcnt;      // counts sysclks in a scan state
+    wire   tick;             // advance the scan state machine
+    reg    [7:0] inval;      // input values
+    reg    [7:0] inold;      // input values at the end of the last scan
+    reg    scandone;         // ==1 at the end of a scan
+    reg    [7:0] outval;     // output values from the host
+    reg    [7:0] outshift;   // outputs being shifted out this cycle
+
+    // Counts, rate limit, and velocity
+    reg    [15:0] cnt [3:0]; // signed count of each encoder
+    reg    [15:0] wcount [3:0]; // signed count in this window
+    reg    [7:0] vel [3:0];  // signed count in the last window
+    reg    [7:0] acc [3:0];  // change in velocity
+    reg    [7:0] lolatch;    // count low byte latched on a high byte read
+    reg    data_avail;       // Flag to say data is ready to send
+    reg    [7:0] holdoff;    // autosend holdoff in ms
+    reg    [7:0] hold;       // ms left in the holdoff
+    reg    ext;              // ==1 to send counts, velocity, and acceleration
+    reg    [7:0] velwin;     // velocity window in ms
+    reg    [7:0] wtime;      // ms into the velocity window
+    reg    winend;           // ==1 at the end of a velocity window
+    wire   sendok;           // ==1 if there is data and no holdoff
+    reg    upopen;           // ==1 while an extended autosend is open
+    reg    [3:0] upidx;      // next byte of the autosend
+    wire   uprd;             // ==1 on an in-order read of an autosend byte
+    wire   poll;             // ==1 on an autosend poll
+    wire   [3:0] rdreg;      // Reg 16-31 being read
+    wire   [15:0] rdcnt;     // count of the encoder being read
+    wire   [7:0] rdvel;      // velocity of the encoder being read
+    wire   [7:0] rdacc;      // acceleration of the encoder being read
+    wire   [15:0] bcnt;      // count read in Regs 0-3
+    wire   [6:0] bcnt7;      // that count as read
+    integer j;               // loop counter
+
+    // Addressing and bus interface lines 
+    wire   myaddr;           // ==1 if a correct read/write on our address
+    wire   mywrite;          // ==1 on a host write to us
+
+
+    initial
+    begin
+        gst = 0;
+        bst = 0;
+        scancfg = 7'h00;
+        dwcnt = 7'h00;
+        inval = 8'h00;
+        inold = 8'h00;
+        scandone = 0;
+        outval = 8'h00;
+        outshift = 8'h00;
+        data_avail = 0;
+        holdoff = 0;
+        hold = 0;
+        ext = 0;
+        velwin = 50;
+        wtime = 0;
+        winend = 0;
+        upopen = 0;
+        upidx = 0;
+        for (j = 0; j < 4; j = j + 1)
+        begin
+            cnt[j] = 0;
+            wcount[j] = 0;
+            vel[j] = 0;
+            acc[j] = 0;
+        end
+    end
+
+    always @(posedge clk)
+    begin
+        // Millisecond timers for the holdoff and velocity window
+        if (m1clk)
+        begin
+            if (hold != 0)
+                hold <= hold - 8'h01;
+            if (velwin != 0)
+            begin
+                if ((wtime + 8'h01) >= velwin)
+                begin
+                    wtime <= 0;
+                    winend <= 1;
+                end
+                else
+                    wtime <= wtime + 8'h01;
+            end
+        end
+
+        // dwell counter for short cables
+        if (dwcnt == 0)
+            dwcnt <= scancfg - 7'h01;
+        else
+            dwcnt <= dwcnt - 7'h01;
+
+        // Open an extended autosend on a poll
+        if (~upopen & ext & sendok & poll)
+        begin
+            upopen <= 1;
+            upidx <= 0;
+        end
+
+        // host writes
+        if (mywrite)
+        begin
+            if (addr[3:0] == 4)
+                outval <= datin;
+            else if (addr[3:0] == 5)
+                holdoff <= datin;
+            else if (addr[3:0] == 6)
+                ext <= datin[0];
+            else if (addr[3:0] == 7)
+                velwin <= datin;
+            else if (addr[3:0] == 8)
+                scancfg <= datin[6:0];
+        end
+
+        // host reads
+        else if (strobe && myaddr && rdwr)
+        begin
+            if (uprd)
+            begin
+                upidx <= upidx + 4'h1;
+                if (upidx == 15)
+                begin
+                    upopen <= 0;
+                    data_avail <= ((cnt[0] | cnt[1] | cnt[2] | cnt[3]) != 0);
+                    hold <= holdoff;
+                end
+            end
+            if ((uprd || addr[4]) && (rdreg[1:0] == 0))
+            begin
+                lolatch <= rdcnt[7:0];
+                cnt[rdreg[3:2]] <= 0;
+            end
+            else if (~uprd && (addr[4:2] == 0))
+            begin
+                // Take the count read out of the count
+                cnt[addr[1:0]] <= bcnt - {{9{bcnt7[6]}}, bcnt7};
+                if (addr[1:0] == 3)
+                begin
+                    data_avail <= ((cnt[0] | cnt[1] | cnt[2]) != 0) ||
+                                  (bcnt != {{9{bcnt7[6]}}, bcnt7});
+                    hold <= holdoff;
+                end
+            end
+        end
+
+        else
+        begin
+            // Scan the card
+            if (tick)
+            begin
+                // latch the outputs for this shift cycle
+                if (gst == 0)
+                    outshift <= outval;
+                // grab the input on 4, save it on 5
+                if (gst == 4)
+                    sample <= pin8;
+                if (gst == 5)
+                    inval[bst] <= sample;
+
+                if (gst < 8)
+                    gst <= gst + 4'h1;
+                else
+                begin
+                    bst <= bst + 3'h1;  // next bit
+                    gst <= (bst == 7) ? 3'h0 : 3'h4;
+                    if (bst == 7)   // Done with all bits?
+                        scandone <= 1;
+                end
+            end
+
+            // Count the encoders at the end of each scan
+            if (scandone)
+            begin
+                scandone <= 0;
+                inold <= inval;
+                if (winend)
+                    winend <= 0;
+                for (j = 0; j < 4; j = j + 1)
+                begin
+                    cnt[j] <= qcount(cnt[j], inold[2*j], inold[2*j+1], inval[2*j], inval[2*j+1]);
+                    if (qcount(16'h0000, inold[2*j], inold[2*j+1], inval[2*j], inval[2*j+1]) != 0)
+                        data_avail <= 1;
+                    if (winend)
+                    begin
+                        wcount[j] <= 0;
+                        vel[j] <= sat8(qcount(wcount[j], inold[2*j], inold[2*j+1],
+                                              inval[2*j], inval[2*j+1]));
+                        acc[j] <= sat8(qcount(wcount[j], inold[2*j], inold[2*j+1],
+                                              inval[2*j], inval[2*j+1]) - sext8(vel[j]));
+                    end
+                    else
+                        wcount[j] <= qcount(wcount[j], inold[2*j], inold[2*j+1],
+                                            inval[2*j], inval[2*j+1]);
+                end
+            end
+        end
+
+        // Any access other than the next in-order read ends the autosend
+        if (upopen & strobe & myaddr & ~uprd)
+            upopen <= 0;
+    end
+
+    // Add a quadrature transition from a1,b1 to a,b to a saturating count
+    function [15:0] qcount;
+        input [15:0] c;
+        input a1;
+        input b1;
+        input a;
+        input b;
+        reg   inc;
+        reg   dec;
+        begin
+            inc = ((a1 != a) && (a1 ^ b1)) || ((b1 != b) && ~(a1 ^ b1));
+            dec = ((a1 != a) && ~(a1 ^ b1)) || ((b1 != b) && (a1 ^ b1));
+            qcount = (inc && ~dec && (c != 16'h7fff)) ? (c + 16'h0001) :
+                     (dec && ~inc && (c != 16'h8000)) ? (c - 16'h0001) : c;
+        end
+    endfunction
+
+    // Saturate a signed count to 8 or 7 bits
+    function [7:0] sat8;
+        input [15:0] v;
+        sat8 = (~v[15] && (v[14:7] != 8'h00)) ? 8'h7f :
+               (v[15] && (v[14:7] != 8'hff)) ? 8'h80 : v[7:0];
+    endfunction
+    function [6:0] sat7;
+        input [15:0] v;
+        sat7 = (~v[15] && (v[14:6] != 9'h000)) ? 7'h3f :
+               (v[15] && (v[14:6] != 9'h1ff)) ? 7'h40 : v[6:0];
+    endfunction
+    function [15:0] sext8;
+        input [7:0] v;
+        sext8 = {{8{v[7]}}, v};
+    endfunction
+
+    // Assign the outputs.
+    assign tick = (scancfg == 0) ? u10clk : (dwcnt == 0);
+    assign pin2 = (gst == 2) || (gst == 3) ||                    // LD == 0
+                   (((gst == 4) || (gst == 5)) && outshift[bst]) ||  // data out value
+                   (gst == 6) || (gst == 7) || (gst == 8);       // LD == 1
+    assign pin4 = (gst == 5);
+    assign pin6 = (gst == 1) || (gst == 3) || (gst == 4) || (gst == 5) ||
+                  (gst == 6) || (gst == 8);
+
+    assign sendok = data_avail && (hold == 0);
+    assign uprd = strobe & rdwr & upopen & (addr[11:8] == our_addr) &
+                  (addr[7:0] == {4'h0, upidx});
+    assign poll = myaddr & ~strobe & (addr[4:0] == 0);
+    assign rdreg = (uprd) ? upidx : addr[3:0];
+    assign rdcnt = cnt[rdreg[3:2]];
+    assign rdvel = vel[rdreg[3:2]];
+    assign rdacc = acc[rdreg[3:2]];
+    assign bcnt = cnt[addr[1:0]];
+    assign bcnt7 = sat7(bcnt);
+
+    assign myaddr = (addr[11:8] == our_addr) && (((addr[7:5] == 0) &&
+                    ((addr[4] == 1) || (addr[3:0] < 9))) || uprd);
+    assign mywrite = strobe & myaddr & ~rdwr;
+    assign datout = (~myaddr) ? datin :
+                     (poll && upopen) ? 8'h10 :       // Counts, velocities, and accelerations
+                     (poll && sendok && ext) ? 8'h10 :
+                     (~strobe && sendok) ? 8'h04 :    // send up the four counts
+                     (~strobe) ? 8'h00 :
+                     (uprd || addr[4]) ?
+                         ((rdreg[1:0] == 0) ? rdcnt[15:8] :
+                          (rdreg[1:0] == 1) ? lolatch :
+                          (rdreg[1:0] == 2) ? rdvel : rdacc) :
+                     (addr[3:2] == 0) ? {1'b0,bcnt7} :
+                     (addr[3:0] == 4) ? outval :
+                     (addr[3:0] == 5) ? holdoff :
+                     (addr[3:0] == 6) ? {7'h00,ext} :
+                     (addr[3:0] == 7) ? velwin :
+                     (addr[3:0] == 8) ? {1'b0,scancfg} :
+                     8'h00 ; 
+
+    // Loop in-to-out where appropriate
+    assign busy_out = busy_in;
+    assign addr_match_out = myaddr | addr_match_in;
+
+endmodule
+
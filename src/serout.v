@@ -30,38 +30,71 @@
 
 //////////////////////////////////////////////////////////////////////////
 //
-//  File: serialout: Quad/Octal serial output port
+//  File: serialout: Quad/Octal full-duplex serial port
 //
 //  Registers are (for quad port)
-//    Addr=0    Data Out port #1
-//    Addr=1    Data Out port #2
-//    Addr=2    Data Out port #3
-//    Addr=3    Data Out port #4
-//    Addr=4    Baud rate divider
+//    Addr=0    Data Out port #1 (write), upload port number (read)
+//    Addr=1    Data Out port #2 (write), upload byte count (read)
+//    Addr=2    Data Out port #3 (write), Rx data (read)
+//    Addr=3    Data Out port #4 (write), Rx data (read)
+//    Addr=4    Baud rate divider and number of stop bits
+//    Addr=16   Rx mask.  Bit n set makes port n a receiver
+//    Addr=17   Rx byte count that triggers an upload. 0 disables
+//    Addr=18   Rx line idle time in bit times that triggers an upload
+//    Addr=19   Tx low-water level.  0 disables
+//    Addr=32+2n  High byte of port n bit time in units of 12.5 ns
+//    Addr=33+2n  Low byte of port n bit time
+//    Addr=128+n  Read back of the configuration register at Addr=n
 //
-// NOTES:  The FIFO buffers are implemented using one dual-port
-// block RAM.   The only write source is the host.  Depending on
-// the activity all of the ports may try to read the RAM at the
-// baud clock edge.  To resolve the conflicting read access we use
-// a counter (rdsel) that sequentially gives two sysclk cycles to
-// each  port.  The RAM read address is set in the first cycle and
-// the character to send is read from RAM in the second cycle.  This
-// counter has 3 or 4 bits depending the number if ports.  Two (or
-// three) bits are for the port and one bit is for the addr/read cycle.
+//  Each pin is either a transmitter or a receiver as set by the
+//  Rx mask.  A full-duplex port is a pair of pins, one of each.
+//  Each port has one FIFO used in the direction of the port.  The
+//  FIFO depth is the parameter LOGDEPTH and all of the FIFOs share
+//  one RAMB16 so NPORT times the depth can be at most 2048.
+//  Received characters go into the port's FIFO.  A port is
+//  ready to upload when its FIFO has at least the Rx count of
+//  characters, when the line has been idle for the Rx idle time,
+//  or when the FIFO is full.  An upload is a read starting at
+//  register 0 and gives the port number, the number of characters
+//  that follow (at most 126), and then the characters.  The upload
+//  is read in order from register 0 and each read of the next
+//  register takes the next character from the FIFO of the port
+//  being uploaded.  Any other access ends the upload and leaves the
+//  unread characters in the FIFO.  The autosend byte count is the
+//  number of characters plus two.
+//     A transmitter reports a low-water mark when its FIFO drops
+//  to the low-water level after having been above it.  The report
+//  is an upload of two bytes, the port number with bit 7 set and
+//  the number of characters still in the FIFO.
+//
+//  Each port has its own fractional bit clock.  The bit time is in
+//  units of a quarter sysclk and should be at least 16 (5 Mbaud).
+//  A write to the divider register sets the bit time of all ports
+//  to 38400 baud divided by one more than the divider.  Bits 5-4 of
+//  the divider register are the number of stop bits minus one.
+//
+// NOTES:  The FIFO buffers are implemented using one true dual-port
+// block RAM.  Port A is for the host.  It writes into the Tx FIFOs
+// and reads from the Rx FIFOs.  Port B is for the
+// serial ports.  A counter (scan) gives two sysclk cycles to each
+// port in turn.  In the first cycle a transmitter with an empty
+// holding register sets the RAM read address, or a receiver with a
+// new character writes it into its Rx FIFO.  In the second cycle
+// the character read from RAM goes to the transmitter's holding
+// register.  Each port has its own bit clock so that a receiver
+// can align its bit sampling to the start bit.
 //
 /////////////////////////////////////////////////////////////////////////
 
-        // Log Base 2 of the buffer size for each port.  Should be betwee
-        // 4 and 8.  Larger values ease the load on the USB port by sending
-        // fuller USB packets.  Smaller buffers ease the FPGA resources 
-        // needed.  
-`define LB2BUFSZ   5
-
 
 module serout(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
-       addr_match_in,addr_match_out,datin,datout,u1clk,txd);
+       addr_match_in,addr_match_out,datin,datout,sio);
     parameter NPORT = 8;
     parameter LOGNPORT = 3;
+        // Log Base 2 of the buffer size for each port.  Should be between
+        // 4 and 11-LOGNPORT.  Larger values ease the load on the USB port
+        // by sending fuller USB packets and longer bursts.
+    parameter LOGDEPTH = 5;
     input  clk;              // system clock
     input  rdwr;             // direction of this transfer. Read=1; Write=0
     input  strobe;           // true on full valid command
@@ -73,271 +106,487 @@ module serout(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     output addr_match_out;   // ==1 if we claim the above address, pass through otherwise
     input  [7:0] datin ;     // Data INto the peripheral;
     output [7:0] datout ;    // Data OUTput from the peripheral, = datin if not us.
-    input  u1clk;            // one sysclk pulse per microsecond
-    output [NPORT-1:0] txd;  // output lines
+    inout  [NPORT-1:0] sio;  // serial lines, Tx or Rx
 
     wire   myaddr;           // ==1 if a correct read/write on our address
     genvar  i;               // loop counter to generate code
     integer j;               // loop counter
 
-           //   baud rate generator and divider
+           //   configuration
     reg    [1:0] nstop;      // # stop bits -1 (ie 0 means 1 stop bit)
     reg    [3:0] bauddiv;    // configured value from the host
-    reg    [3:0] baudcount;  // counter to divide the 38400 clock down
-    wire   baudclk;
-    wire   baudreset;
-    baud38400 b1(clk, u1clk, baudreset, baudclk);
+    reg    [NPORT-1:0] rxmode; // ==1 if the port is a receiver
+    reg    [7:0] rxthresh;   // upload when this many characters are in a FIFO
+    reg    [7:0] idletime;   // upload after this many idle bit times
+    reg    [7:0] lowwater;   // Tx low-water level
+    wire   [7:0] rxmask;     // rxmode as a byte for read back
+    reg    [15:0] bittime [NPORT-1:0]; // bit time in units of 12.5 ns
+    wire   [15:0] divtime;   // bit time set by the divider register
+    wire   [2:0] bport;      // port addressed by a bit time register
+           // 38400 baud is 2083 quarter sysclks
+    assign divtime = ({12'h000, datin[3:0]} + 16'h0001) * 16'd2083;
+    assign bport = addr[3:1];
+    assign rxmask = rxmode;
+
+           // serial port lines
+    reg    [NPORT-1:0] txload;    // load txbyte into the port's holding register
+    reg    [7:0] txbyte;          // character to send
+    reg    [NPORT-1:0] rxtake;    // Rx character has been taken
+    wire   [NPORT-1:0] txrdy;     // ==1 if Tx holding register is empty
+    wire   [NPORT-1:0] rxrdy;     // ==1 if Rx holding register is full
+    wire   [NPORT-1:0] rxidle;    // ==1 if the Rx line has been idle
+    wire   [8*NPORT-1:0] rxbytes; // received characters
 
            //  FIFO control lines
-    reg    [LOGNPORT:0] rdsel;      // read select line
-    reg    [`LB2BUFSZ-1:0] watx [NPORT-1:0]; // FIFO write address for Tx
-    reg    [`LB2BUFSZ-1:0] ratx [NPORT-1:0]; // FIFO read address for Tx
+    reg    [LOGNPORT:0] scan;       // port and RAM cycle for the serial ports
+    wire   [LOGNPORT-1:0] sport;    // port being serviced
+    reg    txrd;                    // ==1 if a Tx character was read from RAM
+    reg    [NPORT-1:0] lwarm;       // ==1 to report the Tx low-water mark
+    reg    [LOGDEPTH-1:0] watx [NPORT-1:0]; // FIFO write address for Tx
+    reg    [LOGDEPTH-1:0] ratx [NPORT-1:0]; // FIFO read address for Tx
+    reg    [LOGDEPTH-1:0] warx [NPORT-1:0]; // FIFO write address for Rx
+    reg    [LOGDEPTH-1:0] rarx [NPORT-1:0]; // FIFO read address for Rx
     wire   [NPORT-1:0] buffull;    // ==1 if FIFO can not take more characters
     wire   [NPORT-1:0] bufempty;   // ==1 if there are no characters to send
+    wire   [NPORT-1:0] rxfull;     // ==1 if the Rx FIFO is full
     for (i = 0; i < NPORT; i=i+1)
     begin : gen_fifo_wires
-        assign buffull[i] = ((watx[i] + `LB2BUFSZ'h01) == ratx[i]);
+        wire [LOGDEPTH-1:0] txnext;   // next Tx FIFO write address
+        wire [LOGDEPTH-1:0] rxnext;   // next Rx FIFO write address
+        assign txnext = watx[i] + 1;
+        assign rxnext = warx[i] + 1;
+        assign buffull[i] = (txnext == ratx[i]);
         assign bufempty[i] = (watx[i] == ratx[i]);
+        assign rxfull[i] = (rxnext == rarx[i]);
     end
-           // latch the buff empty status at start of each Tx byte
-    reg    [NPORT-1:0] emptylatch;
+    assign sport = scan[LOGNPORT:1];
+
+           // Upload.  qport looks at each port in turn and stops on
+           // one that is ready to upload.
+    reg    [LOGNPORT-1:0] qport;    // port checked for upload
+    wire   [LOGDEPTH-1:0] qcnt;     // number of characters in its Rx FIFO
+    wire   [15:0] qcntw;            // qcnt as a 16 bit value
+    wire   [6:0] qlen;              // number of characters to upload
+    wire   [LOGDEPTH-1:0] qtxcnt;   // number of characters in its Tx FIFO
+    wire   [15:0] qtxcntw;          // qtxcnt as a 16 bit value
+    wire   qtxlow;                  // ==1 if qport is at its low-water mark
+    wire   qready;                  // ==1 if qport should be uploaded
+    reg    upopen;                  // ==1 while an upload is in progress
+    reg    uptx;                    // ==1 if the upload is a low-water mark
+    reg    [LOGNPORT-1:0] upport;   // port being uploaded
+    reg    [7:0] upcnt;             // character count of the upload
+    reg    [6:0] upleft;            // characters left to read
+    reg    [7:0] upidx;             // register of the next upload read
+    wire   upread;                  // ==1 on an in-order read of the upload
+    wire   [LOGDEPTH-1:0] txlevel;  // characters in the Tx FIFO of txport
+    wire   poll;                    // ==1 on an autosend poll or read of Addr=0
+    wire   rxrd;                    // ==1 on a read of Rx data
+    reg    imbusy;                  // stretch Rx data reads by one clock
+    assign qcnt = warx[qport] - rarx[qport];
+    assign qcntw = qcnt;
+    assign qlen = (qcntw > 16'd126) ? 7'd126 : qcntw[6:0];
+    assign qtxcnt = watx[qport] - ratx[qport];
+    assign qtxcntw = qtxcnt;
+    assign qtxlow = ~rxmode[qport] & lwarm[qport] & (qtxcntw <= lowwater);
+    assign qready = qtxlow | (rxmode[qport] & (qcnt != 0) & (rxfull[qport] |
+                    rxidle[qport] | ((rxthresh != 0) & (qcntw >= rxthresh))));
+    assign poll = myaddr & (addr[7:0] == 8'h00) & (~strobe | rdwr);
+    assign upread = strobe & rdwr & myaddr & upopen & (addr[7:0] == upidx);
+    assign rxrd = upread & (addr[7] == 1'b0) & (addr[6:1] != 6'h00) & (upleft != 0);
 
            // RAM control lines
-    wire   we;                    // RAM write strobe for Tx
-    wire   [`LB2BUFSZ+LOGNPORT-1:0] wa;     // bit write address (`LB2BUFSZ bytes per port)
-    wire   [`LB2BUFSZ+LOGNPORT-1:0] ra;     // bit read address
-    wire   [7:0] rd;              // registered read data from RAM
-    dpram   #(.LOGNPORT(LOGNPORT)) memtx(clk, we, wa, datin, ra, rd);
-           // write when (our address) and (not config register) and (selected 
+    wire   wea;                   // host write into a Tx FIFO
+    wire   [10:0] addra;          // host side RAM address
+    wire   [7:0] rda;             // host side read data
+    wire   web;                   // Rx character write into an Rx FIFO
+    wire   [10:0] addrb;          // serial port side RAM address
+    wire   [7:0] rdb;             // serial port side read data
+    wire   [LOGNPORT-1:0] txport; // port addressed by a host write
+    assign txport = addr[LOGNPORT-1:0];
+    assign txlevel = watx[txport] - ratx[txport];
+           // write when (our address) and (a Tx data register) and (selected 
            // port is not full)
-    assign we = ((strobe & myaddr & ~rdwr) & (addr[LOGNPORT] ==0) & (buffull[addr[LOGNPORT-1:0]] == 0));
-           // write address is port number in high two bits and port's FIFO
-           // write address in the lower bits
-    assign wa = {addr[LOGNPORT-1:0], watx[addr[LOGNPORT-1:0]]};
-           // read address is port number from rdsel and the FIFO read address
-    assign ra = {rdsel[LOGNPORT:1],ratx[rdsel[LOGNPORT:1]]};
-
-           // Serial bit shifting
-           // baudflag is set on each baudclk.  It starts the port counter rdsel
-    reg    baudflag;
-           // Bit multiplexer to select start bit, stop bits, or data bits
-    reg    [3:0] bitreg;     // shift counters to set which bit is on output Tx line
-           // state of the Tx lines
-    reg    [NPORT-1:0] sendbit;
-    assign txd = sendbit;
+    assign wea = strobe & myaddr & ~rdwr & (addr[7:0] < NPORT) &
+                 ~buffull[txport] & ~rxmode[txport];
+           // address is port number then the FIFO address
+    assign addra = (rxrd) ? ((upport << LOGDEPTH) | rarx[upport]) :
+                            ((txport << LOGDEPTH) | watx[txport]);
+    assign web = (scan[0] == 1'b0) & rxmode[sport] & rxrdy[sport] & ~rxfull[sport];
+    assign addrb = (rxmode[sport]) ? ((sport << LOGDEPTH) | warx[sport]) :
+                                     ((sport << LOGDEPTH) | ratx[sport]);
+    serram sram(clk, addra, datin, rda, wea, addrb, rxbytes[sport*8 +: 8], rdb, web);
+
+           // The serial ports
+    for (i = 0; i < NPORT; i=i+1)
+    begin : gen_ports
+        serport sp(clk, bittime[i], nstop, rxmode[i], sio[i], txrdy[i], txload[i],
+                   txbyte, rxrdy[i], rxtake[i], rxbytes[i*8 +: 8], idletime, rxidle[i]);
+    end
 
 
     initial
     begin
         nstop = 2'h0;
         bauddiv = 4'h0;
-        baudcount = 4'h0;
-        rdsel = 4'h0;
-        baudflag = 1'b0;
+        rxmode = 0;
+        rxthresh = 8'd16;
+        idletime = 8'd20;
+        lowwater = 8'h00;
+        lwarm = 0;
+        uptx = 1'b0;
+        scan = 0;
+        txrd = 1'b0;
+        txload = 0;
+        rxtake = 0;
+        qport = 0;
+        upopen = 1'b0;
+        upport = 0;
+        upcnt = 8'h00;
+        upleft = 7'h00;
+        upidx = 8'h00;
+        imbusy = 1'b1;
         for (j = 0; j < NPORT; j = j+1)
         begin : initfifo
-            watx[j]   = `LB2BUFSZ'h000;
-            ratx[j]   = `LB2BUFSZ'h000;
-            bitreg[j] = 4'h0;
+            watx[j]   = 0;
+            ratx[j]   = 0;
+            warx[j]   = 0;
+            rarx[j]   = 0;
+            bittime[j] = 16'd2083;
         end
     end
 
     always @(posedge clk)
     begin
-        if (strobe & myaddr & ~rdwr)  // latch data on a write
+        // Give each serial port two clocks of RAM access
+        scan <= scan + 1;
+        txload <= 0;
+        rxtake <= 0;
+        if (scan[0] == 1'b0)
         begin
-            if ((addr[LOGNPORT] == 1'b0) & (~buffull[addr[LOGNPORT-1:0]]))
+            txrd <= ~rxmode[sport] & txrdy[sport] & ~bufempty[sport];
+            if (rxmode[sport] & rxrdy[sport])
             begin
-                // store new character
-                watx[addr[LOGNPORT-1:0]] <= watx[addr[LOGNPORT-1:0]] + `LB2BUFSZ'h01;
+                // character is written into RAM on this clock.  It is
+                // dropped if the FIFO is full.
+                rxtake[sport] <= 1'b1;
+                if (~rxfull[sport])
+                    warx[sport] <= warx[sport] + 1;
             end
-            else if (addr[LOGNPORT] == 1'b1)
+        end
+        else if (txrd)
+        begin
+            txbyte <= rdb;
+            txload[sport] <= 1'b1;
+            ratx[sport] <= ratx[sport] + 1;
+        end
+
+        // Look for a port to upload and latch it on a poll
+        if (~upopen)
+        begin
+            if (qready & poll)
             begin
-                bauddiv <= datin[3:0];
-                nstop <= datin[5:4];
+                upopen <= 1'b1;
+                upport <= qport;
+                uptx <= qtxlow;
+                upcnt <= (qtxlow) ? qtxcntw[7:0] : {1'b0,qlen};
+                upleft <= (qtxlow) ? 7'h00 : qlen;
+                // A read of Addr=0 is the first byte of the upload
+                upidx <= (strobe) ? 8'h01 : 8'h00;
             end
+            else if (~qready)
+                qport <= (qport == NPORT-1) ? 0 : qport + 1;
         end
 
-        if (baudclk)
+        // Rx data reads take two clocks, one to set the RAM address
+        // and one to read the character.
+        if (rxrd)
         begin
-            // divide baudclk by bauddiv and set flag to start new bit output
-            if (baudcount == 0)
+            imbusy <= 1'b0;
+            if (imbusy == 1'b0)
             begin
-                baudflag <= 1'b1;
-                baudcount <= bauddiv;
-                // Increment bitreg if not the last bit.
-                // 10 bits (0-9) if 1 stop bit.  More if more stop bits
-                if (bitreg == (4'd9 + {2'h0, nstop[1:0]}))
-                begin
-                    bitreg <= 4'h0;
-                    emptylatch <= bufempty;
-                end
-                else // not last bit to send
-                    bitreg <= bitreg + 4'h1;
+                rarx[upport] <= rarx[upport] + 1;
+                upleft <= upleft - 7'h01;
+                upidx <= upidx + 8'h01;
+                if (upleft == 7'h01)
+                    upopen <= 1'b0;
             end
-            else
-                baudcount <= baudcount - 4'h1;
         end
-        else if (baudflag)
+        else
+            imbusy <= 1'b1;
+
+        // The port number and count are one clock reads
+        if (upread & (addr[7:1] == 7'h00))
+            upidx <= upidx + 8'h01;
+
+        // A low-water upload is done when the count is read
+        if (upread & (addr[7:0] == 8'h01) & uptx)
         begin
-            // reset baudflag when we are done looking at all ports
-            //if (~rdsel == 0)        // inverse == 0 when all bits set
-            if (rdsel == NPORT-1)
-                baudflag <= 1'b0;
+            upopen <= 1'b0;
+            lwarm[upport] <= 1'b0;
+        end
 
-            // increment to the next state to control sequential RAM access
-            rdsel <= rdsel + 4'h1;
+        // Any other access to us ends the upload.  This keeps a read of
+        // another register from taking characters out of the FIFO.
+        if (strobe & myaddr & upopen & ~upread)
+            upopen <= 1'b0;
 
-            // Latch the serial bit from RAM on the second (of two) 
-            // states of rdsel.
-            if ((rdsel[0] == 1'b1) & (~emptylatch[rdsel[LOGNPORT:1]]))
+        if (strobe & myaddr & ~rdwr)  // latch data on a write
+        begin
+            if (wea)
+            begin
+                // store new character.  Arm the low-water report if
+                // this takes the FIFO above the low-water level.
+                watx[txport] <= watx[txport] + 1;
+                if ((lowwater != 0) & (txlevel >= lowwater))
+                    lwarm[txport] <= 1'b1;
+            end
+            else if (addr[7:0] == NPORT)
+            begin
+                bauddiv <= datin[3:0];
+                nstop <= datin[5:4];
+                for (j = 0; j < NPORT; j = j+1)
+                    bittime[j] <= divtime;
+            end
+            else if (addr[7:0] == 8'd16)
             begin
-                sendbit[rdsel[LOGNPORT:1]] <= 
-                    (bitreg == 0) ? 1'b0 :
-                    (bitreg == 1) ? rd[0] :
-                    (bitreg == 2) ? rd[1] :
-                    (bitreg == 3) ? rd[2] :
-                    (bitreg == 4) ? rd[3] :
-                    (bitreg == 5) ? rd[4] :
-                    (bitreg == 6) ? rd[5] :
-                    (bitreg == 7) ? rd[6] :
-                    (bitreg == 8) ? rd[7] :
-                    (bitreg == 9) ? 1'b1 :
-                    (bitreg == 10) ? 1'b1 :
-                    (bitreg == 11) ? 1'b1 :
-                    (bitreg == 12) ? 1'b1 :
-                    (bitreg == 13) ? 1'b1 :
-                    (bitreg == 14) ? 1'b1 : 1'b1;
-
-                // We are at the bit transition of the port specified by the
-                // high bits of rdsel.  If this the last bit to send then
-                // increment the read index to the next location in the FIFO.
-                // 10 bits (0-9) if 1 stop bit.  More if more stop bits
-                if (bitreg == (4'd9 + {2'h0, nstop[1:0]}))
+                rxmode <= datin[NPORT-1:0];
+                // discard any characters queued in the other direction
+                for (j = 0; j < NPORT; j = j+1)
                 begin
-                    ratx[rdsel[LOGNPORT:1]] <= ratx[rdsel[LOGNPORT:1]] + `LB2BUFSZ'h01;
+                    if (datin[j])
+                    begin
+                        ratx[j] <= watx[j];
+                        lwarm[j] <= 1'b0;
+                    end
+                    else
+                        rarx[j] <= warx[j];
                 end
             end
+            else if (addr[7:0] == 8'd17)
+                rxthresh <= datin;
+            else if (addr[7:0] == 8'd18)
+                idletime <= datin;
+            else if (addr[7:0] == 8'd19)
+                lowwater <= datin;
+            else if ((addr[7:4] == 4'h2) & (bport < NPORT))
+            begin
+                if (addr[0] == 1'b0)
+                    bittime[bport][15:8] <= datin;
+                else
+                    bittime[bport][7:0] <= datin;
+            end
         end
     end
 
     // Assign the outputs.
-    assign baudreset = 1'b0;
-
-    assign myaddr = (addr[11:8] == our_addr) && (addr[7:LOGNPORT+1] == 5'h00);
+    assign myaddr = (addr[11:8] == our_addr);
     assign datout = (~myaddr) ? datin : 
-                     (strobe && (addr[LOGNPORT:0] == NPORT)) ? {4'h0,bauddiv} : 8'h00;
-
-    // Loop in-to-out where appropriate
-    assign busy_out = busy_in;
-    // Accept write byte if our address and the config register or a FIFO that is not full
-    assign addr_match_out = addr_match_in | (myaddr & addr[LOGNPORT]) |
-                            (myaddr & ~buffull[addr[LOGNPORT-1:0]]);
+                     (~strobe) ? ((upopen) ? ((uptx) ? 8'h02 : (upcnt + 8'h02)) :
+                                  (qtxlow) ? 8'h02 :
+                                  (qready) ? ({1'b0,qlen} + 8'h02) : 8'h00) :
+                     (~rdwr) ? 8'h00 :
+                     (addr[7:0] == 8'h00) ? ((upopen) ? {uptx,upport} :
+                                             (qready) ? {qtxlow,qport} : 8'hff) :
+                     (addr[7:0] == 8'h01) ? ((upopen) ? upcnt : 8'h00) :
+                     (addr[7] == 1'b0) ? ((rxrd) ? rda : 8'h00) :
+                     (addr[6:0] == NPORT) ? {2'h0,nstop,bauddiv} :
+                     (addr[6:0] == 7'd16) ? rxmask :
+                     (addr[6:0] == 7'd17) ? rxthresh :
+                     (addr[6:0] == 7'd18) ? idletime :
+                     (addr[6:0] == 7'd19) ? lowwater :
+                     ((addr[6:4] == 3'h2) & (bport < NPORT)) ?
+                         ((addr[0] == 1'b0) ? bittime[bport][15:8] : bittime[bport][7:0]) :
+                     8'h00;
+
+    assign busy_out = (rxrd) ? imbusy : busy_in;
+    // Accept write byte if our address and not a full Tx FIFO
+    assign addr_match_out = addr_match_in | (myaddr & ~(~rdwr & (addr[7:0] < NPORT) &
+                            buffull[txport]));
 
 endmodule
 
 
-// baud38400
-// This module generates a 38461 Hertz clock.  The error is less
-// 0.2 percent.  
-module baud38400(clk, u1clk, reset, baudout);
+// serport
+// One serial port.  The pin is a transmitter or a receiver as set by
+// rxmode.  The bit clock is a fractional divider of the system clock
+// with a resolution of a quarter sysclk.  The receiver restarts the
+// bit clock at half a bit time on the falling edge of the start bit
+// so that all bits are sampled near their middle.
+module serport(clk, bittime, nstop, rxmode, sio, txrdy, txload, txbyte,
+               rxrdy, rxtake, rxbyte, idletime, rxidle);
     input  clk;              // system clock
-    input  u1clk;            // a pulse every 1 microseconds
-    input  reset;            // reset the counters to zero, active high
-    output baudout;          // a clk wide pulse 38461 times per second
-
-    //  38400 Hz is has a period of almost exactly 26 microseconds
-    reg    [4:0] u1count;    // counts from zero to 25
-    reg    baudreg;
+    input  [15:0] bittime;   // bit time in units of 12.5 ns
+    input  [1:0] nstop;      // # stop bits -1
+    input  rxmode;           // ==1 if a receiver
+    inout  sio;              // the serial line
+    output txrdy;            // ==1 if the Tx holding register is empty
+    input  txload;           // load txbyte into the holding register
+    input  [7:0] txbyte;     // character to send
+    output rxrdy;            // ==1 if a received character is waiting
+    input  rxtake;           // the received character has been taken
+    output [7:0] rxbyte;     // the received character
+    input  [7:0] idletime;   // idle bit times before rxidle is set
+    output rxidle;           // ==1 if the Rx line has been idle
+
+    reg    [15:0] bitacc;    // fractional bit clock divider
+    wire   bitclk;           // one sysclk pulse per bit time
+    wire   rxstart;          // falling edge of a start bit
+
+           // transmitter
+    reg    [7:0] txhold;     // holding register
+    reg    txfull;           // ==1 if holding register is full
+    reg    [10:0] txsh;      // data and stop bits to send
+    reg    [3:0] txcnt;      // number of bits left to send
+    reg    txout;            // state of the Tx line
+
+           // receiver
+    reg    [2:0] rxmeta;     // bring the Rx line into our clock domain
+    reg    [3:0] rxstate;    // 0=idle, 1=start bit, 2-9=data, 10=stop
+    reg    [7:0] rxsh;       // received bits
+    reg    [7:0] rxhold;     // received character
+    reg    rxfull;           // ==1 if rxhold is full
+    reg    [7:0] idlecnt;    // idle bit times since the last character
 
     initial
     begin
-        u1count = 0;
+        bitacc = 16'h0000;
+        txfull = 1'b0;
+        txcnt = 4'h0;
+        txout = 1'b1;
+        rxmeta = 3'h7;
+        rxstate = 4'h0;
+        rxfull = 1'b0;
+        idlecnt = 8'h00;
     end
 
+    assign bitclk = (bitacc[15:2] == 14'h0000);
+    assign rxstart = rxmode & (rxstate == 4'h0) & rxmeta[2] & ~rxmeta[1];
+
     always @(posedge clk)
     begin
-        if (u1clk)
+        // Bit clock.  Realign to half a bit on a start bit.
+        if (rxstart)
+            bitacc <= {1'b0, bittime[15:1]};
+        else if (bitclk)
+            bitacc <= bitacc + bittime - 16'h0004;
+        else
+            bitacc <= bitacc - 16'h0004;
+
+        // Transmitter
+        if (txload)
+        begin
+            txhold <= txbyte;
+            txfull <= 1'b1;
+        end
+        if (bitclk)
         begin
-            if (u1count == 5'd25)
-                u1count <= 5'd0;
+            if (txcnt != 4'h0)
+            begin
+                txout <= txsh[0];
+                txsh <= {1'b1, txsh[10:1]};
+                txcnt <= txcnt - 4'h1;
+            end
+            else if (txfull & ~rxmode)
+            begin
+                txout <= 1'b0;          // start bit
+                txsh <= {3'h7, txhold};
+                txcnt <= 4'd9 + {2'h0, nstop};
+                txfull <= 1'b0;
+            end
             else
-                u1count <= u1count + 1;
+                txout <= 1'b1;
         end
-        baudreg <= ((u1count == 0) && (u1clk == 1));
-    end
-
-    assign baudout = baudreg;
-
-endmodule
-
 
-`ifdef notyet
-// baud921k
-// This module generates a 921600 Hertz clock.  The error is less
-// 0.2 percent.  
-module baud921k(clk, reset, baudout);
-    input  clk;              // system clock (20 MHz)
-    input  reset;            // reset the counters to zero, active high
-    output baudout;          // a clk wide pulse 38461 times per second
-
-    //  921600 is between 21 and 22 50ns clocks.  We use a phase accumulator
-    //  delay 21 or 22 clocks depending on the accumulated phase.  We accumulate
-    //  50 ns of phase on each 20 MHz clock.  The period jumps between 1050ns and
-    //  1100ns with an average of 1085ns, or about 921660 Hertz
-
-    reg    [11:0] phacc;     // phase accumulator
-    reg    baudreg;
-
-    initial
-    begin
-        phacc = 0;
-    end
-
-    always @(posedge clk)
-    begin
-        if (phacc[11] == 1)
+        // Receiver
+        rxmeta <= {rxmeta[1:0], sio};
+        if (rxtake)
+            rxfull <= 1'b0;
+        if (~rxmode)
         begin
-            phacc <= phacc + 12'd1035;
-            baudreg <= 1;
+            rxstate <= 4'h0;
+            idlecnt <= 8'h00;
         end
-        else
+        else if (rxstate == 4'h0)
+        begin
+            if (rxstart)
+                rxstate <= 4'h1;
+            else if (bitclk & (idlecnt != 8'hff))
+                idlecnt <= idlecnt + 8'h01;
+        end
+        else if (bitclk)
         begin
-            phacc <= phacc - 50;
-            baudreg <= 0;
+            if (rxstate == 4'h1)        // not a start bit if line is high
+                rxstate <= (rxmeta[1]) ? 4'h0 : 4'h2;
+            else if (rxstate == 4'd10)  // stop bit, drop character on framing error
+            begin
+                rxstate <= 4'h0;
+                if (rxmeta[1])
+                begin
+                    rxhold <= rxsh;
+                    rxfull <= 1'b1;
+                    idlecnt <= 8'h00;
+                end
+            end
+            else
+            begin
+                rxsh <= {rxmeta[1], rxsh[7:1]};
+                rxstate <= rxstate + 4'h1;
+            end
         end
     end
 
-    assign baudout = baudreg;
+    assign sio = (rxmode) ? 1'bz : txout;
+    assign txrdy = ~txfull;
+    assign rxrdy = rxfull;
+    assign rxbyte = rxhold;
+    assign rxidle = (idletime != 8'h00) & (idlecnt >= idletime);
 
 endmodule
-`endif
 
 
 //
-// Dual-Port RAM with synchronous Read
-//
-module
-dpram(clk,we,wa,wd,ra,rd);
-    parameter LOGNPORT = 3;
-    input    clk;                           // system clock
-    input    we;                            // write strobe
-    input    [`LB2BUFSZ+LOGNPORT-1:0] wa;   // write address
-    input    [7:0] wd;                      // write data
-    input    [`LB2BUFSZ+LOGNPORT-1:0] ra;   // read address
-    output   [7:0] rd;                      // read data
-
-    reg      [7:0] rdreg;
-    reg      [7:0] ram [2047:0];
-
-    always@(posedge clk)
-    begin
-        if (we)
-            ram[wa] <= wd;
-        rdreg <= ram[ra];
-    end
-
-    assign rd = rdreg;
+// A wrapper around a true dual port Xilinx RAM block.  Port A is for
+// the host and port B is for the serial ports.
+module serram(clk, addra, dia, doa, wea, addrb, dib, dob, web);
+    input clk;
+    input [10 : 0] addra;
+    input [7 : 0] dia;
+    output [7 : 0] doa;
+    input wea;
+    input [10 : 0] addrb;
+    input [7 : 0] dib;
+    output [7 : 0] dob;
+    input web;
+
+    wire DOPA;
+    wire DOPB;
+    RAMB16_S9_S9 #(
+        .INIT_A(9'h000),  // Value of output RAM registers on Port A at startup
+        .INIT_B(9'h000),  // Value of output RAM registers on Port B at startup
+        .SRVAL_A(9'h000), // Port A output value upon SSR assertion
+        .SRVAL_B(9'h000), // Port B output value upon SSR assertion
+        .WRITE_MODE_A("WRITE_FIRST"), // WRITE_FIRST, READ_FIRST or NO_CHANGE
+        .WRITE_MODE_B("WRITE_FIRST"), // WRITE_FIRST, READ_FIRST or NO_CHANGE
+        .SIM_COLLISION_CHECK("NONE")  // "NONE", "WARNING_ONLY", "GENERATE_X_ONLY", "ALL"
+       ) RAMB16_S9_S9_inst (
+          .DOA(doa),      // Port A 8-bit Data Output
+          .DOB(dob),      // Port B 8-bit Data Output
+          .DOPA(DOPA),    // Port A 1-bit Parity Output
+          .DOPB(DOPB),    // Port B 1-bit Parity Output
+          .ADDRA(addra),  // Port A 11-bit Address Input
+          .ADDRB(addrb),  // Port B 11-bit Address Input
+          .CLKA(clk),     // Port A Clock
+          .CLKB(clk),     // Port B Clock
+          .DIA(dia),      // Port A 8-bit Data Input
+          .DIB(dib),      // Port B 8-bit Data Input
+          .DIPA(1'b0),    // Port A 1-bit parity Input
+          .DIPB(1'b0),    // Port B 1-bit parity Input
+          .ENA(1'b1),     // Port A RAM Enable Input
+          .ENB(1'b1),     // Port B RAM Enable Input
+          .SSRA(1'b0),    // Port A Synchronous Set/Reset Input
+          .SSRB(1'b0),    // Port B Synchronous Set/Reset Input
+          .WEA(wea),      // Port A Write Enable Input
+          .WEB(web)       // Port B Write Enable Input
+       );
 
 endmodule
-
@@ -30,20 +30,41 @@
 //  File: servo4.v;   Four channel servo controller
 //
 //  Registers: (high byte)
-//      Reg 0:  Servo channel 0 pulse width with a resolution of 50 ns.
-//              The value in the register specifies the 50 ns count at
-//              which the pin goes high.  The pin stays high until the
+//      Reg 0:  Servo channel 0 target pulse width with a resolution of
+//              50 ns.  The value in the register specifies the 50 ns count
+//              at which the pin goes high.  The pin stays high until the
 //              count reaches 2.5 milliseconds or a count of 50000 50
 //              nanosecond pulses.  Thus to get a pulse width of 1.0 ms
 //              you would subtract 1.0 from 2.5 giving how long the low
 //              time should be.  The low time would be 1.5 ms or a count
 //              of 30000 clock pulses, or a count of 16'h7530.
-//      Reg 2:  Servo 1 low pulse width in units of 50 ns.
-//      Reg 4:  Servo 2 low pulse width in units of 50 ns.
-//      Reg 6:  Servo 3 low pulse width in units of 50 ns.
+//      Reg 2:  Servo 1 target low pulse width in units of 50 ns.
+//      Reg 4:  Servo 2 target low pulse width in units of 50 ns.
+//      Reg 6:  Servo 3 target low pulse width in units of 50 ns.
+//      Reg 8:  Servo 0 velocity.  The maximum change in the low pulse
+//              width per frame in units of 50 ns.  At the start of each
+//              frame the pulse width moves toward the target by at most
+//              this amount.  A velocity of zero or of 16'hffff moves the
+//              servo to its target in one frame.
+//      Reg 10: Servo 1 velocity in units of 50 ns per frame.
+//      Reg 12: Servo 2 velocity in units of 50 ns per frame.
+//      Reg 14: Servo 3 velocity in units of 50 ns per frame.
+//      Reg 16: Frame period in units of 100 microseconds.  A value of
+//              zero (the default) selects the standard analog servo
+//              timing in which the four pulses are sent one after the
+//              other in a 20 millisecond frame.  A non-zero value selects
+//              the digital servo timing in which all four pulses are sent
+//              at the same time in the first 2.5 ms of each frame.  The
+//              shortest frame is 2.5 ms and values below 25 are treated
+//              as 25.  A value of 30 gives a frame rate of 333 Hertz.
 //
 //  Each pulse is from 0 to 2.50 milliseconds.  The cycle time for
-//  all four servoes is 20 milliseconds.
+//  all four servoes is 20 milliseconds unless a frame period is set.
+//
+//  The pulse widths sent to the servos are kept in flip-flops and are
+//  moved toward the target values in the first eight clocks of each
+//  frame.  A smooth sweep takes one target write and one velocity
+//  write instead of a stream of intermediate positions from the host.
 //
 /////////////////////////////////////////////////////////////////////////
 module servo4(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
@@ -70,50 +91,125 @@ module servo4(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     wire   wenh;             // High RAM write enable
     reg    [2:0] servoid;    // Which servo has the clock
     reg    [15:0] servoclk;  // Comparison clock
-    reg    val;              // Latched value of the comparison
+    reg    [3:0] val;        // Latched value of the comparisons
+    reg    [7:0] frame;      // Frame period in units of 100 us.  0==20 ms sequential
+    reg    [10:0] tickdiv;   // Divide 20 MHz down to 100 us for the frame gap
+    reg    [7:0] ticks;      // Number of 100 us ticks into the frame gap
+    reg    [15:0] pos0;      // Current low pulse width of servo 0
+    reg    [15:0] pos1;      // Current low pulse width of servo 1
+    reg    [15:0] pos2;      // Current low pulse width of servo 2
+    reg    [15:0] pos3;      // Current low pulse width of servo 3
+    reg    [15:0] tgt;       // Target of the servo being updated
+    wire   [1:0] upid;       // Which servo is being updated
+    wire   updating;         // ==1 in the first eight clocks of a frame
+    wire   [15:0] cur;       // Current position of the servo being updated
+    wire   [15:0] vel;       // Velocity of the servo being updated
+    wire   [15:0] dist;      // Distance from current position to target
+    wire   [15:0] nxt;       // Next position of the servo being updated
 
 
     // Register array in RAM
     sv4ram16x8 freqramL(doutl,raddr,datin,wclk,wenl);
     sv4ram16x8 freqramH(douth,raddr,datin,wclk,wenh);
 
+    initial
+    begin
+        frame = 0;
+        pos0 = 16'hffff;
+        pos1 = 16'hffff;
+        pos2 = 16'hffff;
+        pos3 = 16'hffff;
+    end
 
     always @(posedge clk)
     begin
-        if (~(strobe & myaddr & ~rdwr))  // Only when the host is not writing our regs
+        if (strobe & myaddr & ~rdwr & (addr[7:0] == 8'h10))
+            frame <= datin;
+
+        if (~(strobe & myaddr))  // Only when the host is not using our regs
         begin
             if (servoclk[15:0] == 49999)  // 2.500 ms @ 20 MHz
             begin
                 val <= 0;
-                servoclk <= 0;
-                // 8 servos at 2.5 ms each is 20 ms
-                servoid <= servoid + 3'h1;
+                if (frame == 0)
+                begin
+                    servoclk <= 0;
+                    // 8 servos at 2.5 ms each is 20 ms
+                    servoid <= servoid + 3'h1;
+                end
+                // Digital servo timing: wait out the rest of the frame.
+                else if ((frame <= 25) ||
+                         ((ticks >= (frame - 8'd26)) && (tickdiv == 1999)))
+                begin
+                    servoclk <= 0;
+                    servoid <= 0;
+                    ticks <= 0;
+                    tickdiv <= 0;
+                end
+                else if (tickdiv == 1999)
+                begin
+                    tickdiv <= 0;
+                    ticks <= ticks + 8'h01;
+                end
+                else
+                    tickdiv <= tickdiv + 11'h001;
             end
             else
             begin
-                // check for a value match
-                if ((doutl == servoclk[7:0]) && (douth == servoclk[15:8]))
-                    val <= 1;
+                // check for a value match.  All four at once in digital mode
+                if ((pos0 == servoclk) && ((frame != 0) || (servoid == 0)))
+                    val[0] <= 1;
+                if ((pos1 == servoclk) && ((frame != 0) || (servoid == 1)))
+                    val[1] <= 1;
+                if ((pos2 == servoclk) && ((frame != 0) || (servoid == 2)))
+                    val[2] <= 1;
+                if ((pos3 == servoclk) && ((frame != 0) || (servoid == 3)))
+                    val[3] <= 1;
 
                 servoclk <= servoclk + 16'h0001;   // increment PWM clock
             end
+
+            // Move each servo toward its target at the start of the frame.
+            // Get the target on even clocks and the velocity on odd clocks.
+            if (updating & (servoclk[0] == 0))
+                tgt <= {douth,doutl};
+            if (updating & (servoclk[0] == 1))
+            begin
+                if (upid == 0)
+                    pos0 <= nxt;
+                if (upid == 1)
+                    pos1 <= nxt;
+                if (upid == 2)
+                    pos2 <= nxt;
+                if (upid == 3)
+                    pos3 <= nxt;
+            end
         end
     end
 
+    // Interpolate from the current position toward the target
+    assign updating = (servoid == 0) && (servoclk[15:3] == 0);
+    assign upid = servoclk[2:1];
+    assign vel  = {douth,doutl};
+    assign cur  = (upid == 0) ? pos0 :
+                  (upid == 1) ? pos1 :
+                  (upid == 2) ? pos2 : pos3;
+    assign dist = (tgt > cur) ? (tgt - cur) : (cur - tgt);
+    assign nxt  = ((vel == 0) || (dist <= vel)) ? tgt :
+                  (tgt > cur) ? (cur + vel) : (cur - vel);
 
     // Assign the outputs.
-    assign servo[3] = (servoid != 3) ? 1'b0 : val ;
-    assign servo[2] = (servoid != 2) ? 1'b0 : val ;
-    assign servo[1] = (servoid != 1) ? 1'b0 : val ;
-    assign servo[0] = (servoid != 0) ? 1'b0 : val ;
+    assign servo = val;
 
     assign wclk  = clk;
-    assign wenh  = (strobe & myaddr & ~rdwr & (addr[0] == 0)); // latch data on a write
-    assign wenl  = (strobe & myaddr & ~rdwr & (addr[0] == 1)); // latch data on a write
-    assign raddr = (strobe & myaddr) ? {2'h0,addr[2:1]} : {1'h0,servoid} ;
+    assign wenh  = (strobe & myaddr & ~rdwr & (addr[4] == 0) & (addr[0] == 0));
+    assign wenl  = (strobe & myaddr & ~rdwr & (addr[4] == 0) & (addr[0] == 1));
+    assign raddr = (strobe & myaddr) ? {1'h0,addr[3:1]} : {1'h0,servoclk[0],upid} ;
 
-    assign myaddr = (addr[11:8] == our_addr) && (addr[7:3] == 0);
+    assign myaddr = (addr[11:8] == our_addr) &&
+                    ((addr[7:4] == 0) || (addr[7:0] == 8'h10));
     assign datout = (~myaddr) ? datin :
+                    (strobe & (addr[4] == 1)) ? frame :
                     (strobe & (addr[0] == 0)) ? douth :
                     (strobe & (addr[0] == 1)) ? doutl :
                     8'h00 ; 
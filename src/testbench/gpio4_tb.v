@@ -34,6 +34,8 @@
 //    Addr=0    Data In/Out
 //    Addr=1    Data direction register.  1==output,  default=0 (input)
 //    Addr=2    Update on change register.  If set, input change send auto update
+//    Addr=3    Event mode.  Input changes are queued with a timestamp
+//    Addr=4    Debounce time in units of 100 microseconds
 //
 //  GPIO4 is a quad general purpose input/output peripheral.  The
 //  four FPGA pins can be configured as any cobbination of inputs
@@ -57,6 +59,17 @@
 //  - Verify that datout is 8'h01 on a poll (test update-on-change)
 //  - Read the data register (clears update pending)
 //  - Verify that peripheral does not respond to a poll
+//  - Turn on event mode
+//  - Drop pin 3, wait 100 us, and raise it again
+//  - Verify that a poll asks to send two events, 6 bytes
+//  - Read the update-on-change register (ends the autosend)
+//  - Verify that the read gave the register and the events are kept
+//  - Read the 6 bytes in order.  Verify the pins and levels and that
+//    the timestamps are 100 us apart
+//  - Verify that peripheral does not respond to a poll
+//  - Set a 300 us debounce time
+//  - Drop pin 2 for 150 us and verify there is no event
+//  - Drop pin 2 for 500 us and verify there is one event for pin 2
 //
  
 `timescale 1ns/1ns
@@ -74,19 +87,30 @@ module gpio4_tb;
     wire   addr_match_out;   // ==1 if we claim the above address, pass through otherwise
     reg    [7:0] datin ;     // Data INto the peripheral;
     wire   [7:0] datout ;    // Data OUTput from the peripheral, = datin if not us.
+    reg    u1clk;            // one sysclk pulse per microsecond
     wire   [3:0] sbio;       // Simple Bidirectional I/O 
     reg    [3:0] pinval;     // Actual values at the _input_ pins
     reg    [3:0] pinmask;    // Which pins our test drives on the peripheral pins
     wire   [3:0] pins;       // test multiplexer tied to peripheral pins
+    reg    [4:0] uscnt;      // sysclk count for u1clk
+    reg    [47:0] evbytes;   // event bytes read from the peripheral
+    integer k;               // byte count of an event read
 
 
     // Add the device under test
     gpio4 gpio4_dut(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
-          addr_match_in,addr_match_out,datin,datout,sbio);
+          addr_match_in,addr_match_out,datin,datout,u1clk,sbio);
 
     // generate the clock(s)
     initial  clk = 0;
     always   #25 clk = ~clk;
+    initial  u1clk = 0;
+    initial  uscnt = 0;
+    always @(posedge clk)
+    begin
+        uscnt <= (uscnt == 19) ? 5'h00 : uscnt + 5'h01;
+        u1clk <= (uscnt == 19);
+    end
 
     // wire the pin mux
     assign sbio = pins;
@@ -185,6 +209,138 @@ module gpio4_tb;
             $display("FAIL: gpio4 update pending cleared test");
 
 
+        // Test the event FIFO and the timestamps
+        //  - Turn on event mode
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h203;
+        busy_in = 0; addr_match_in = 0; datin = 8'h01;
+        #50
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+        #500  // some time later ...
+        //  - Drop pin 3, wait 100 us, and raise it again
+        pinval = 4'b0100;
+        #100000
+        pinval = 4'b1100;
+
+        #500  // some time later ...
+        //  - Verify that a poll asks to send two events, 6 bytes
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h06)
+            $display("PASS: gpio4 event poll test");
+        else
+            $display("FAIL: gpio4 event poll test");
+
+        //  - Read the update-on-change register (ends the autosend)
+        rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h202;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #10
+        if (datout === 8'h0c)
+            $display("PASS: gpio4 register read during autosend test");
+        else
+            $display("FAIL: gpio4 register read during autosend test");
+        #40
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+        #500  // some time later ...
+        //  - Verify that the events are kept
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h06)
+            $display("PASS: gpio4 events kept test");
+        else
+            $display("FAIL: gpio4 events kept test");
+
+        //  - Read the 6 bytes in order.  Sample before the clock edge
+        //    since each read moves to the next byte.
+        for (k = 0; k < 6; k = k + 1)
+        begin
+            rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h200 + k;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #10
+            evbytes = {evbytes[39:0], datout};
+            #40
+            rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #50;
+        end
+        //  - Verify pin 3 went low then high
+        if ((evbytes[47:44] === 4'b0011) && (evbytes[23:20] === 4'b1011))
+            $display("PASS: gpio4 event pin and level test");
+        else
+            $display("FAIL: gpio4 event pin and level test");
+        //  - Verify the timestamps are 100 us apart
+        if ((evbytes[19:0] - evbytes[43:24]) === 20'd100)
+            $display("PASS: gpio4 event timestamp test");
+        else
+            $display("FAIL: gpio4 event timestamp test");
+
+        #500  // some time later ...
+        //  - Verify that peripheral does not respond to a poll
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h00)
+            $display("PASS: gpio4 event FIFO empty test");
+        else
+            $display("FAIL: gpio4 event FIFO empty test");
+
+
+        // Test the debounce filter
+        //  - Set a 300 us debounce time
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h204;
+        busy_in = 0; addr_match_in = 0; datin = 8'h03;
+        #50
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+        #500  // some time later ...
+        //  - Drop pin 2 for 150 us and verify there is no event
+        pinval = 4'b1000;
+        #150000
+        pinval = 4'b1100;
+        #500000
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h00)
+            $display("PASS: gpio4 debounce glitch test");
+        else
+            $display("FAIL: gpio4 debounce glitch test");
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+        //  - Drop pin 2 for 500 us and verify there is one event
+        pinval = 4'b1000;
+        #500000
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h03)
+            $display("PASS: gpio4 debounce test");
+        else
+            $display("FAIL: gpio4 debounce test");
+        for (k = 0; k < 3; k = k + 1)
+        begin
+            rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h200 + k;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #10
+            evbytes = {evbytes[39:0], datout};
+            #40
+            rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #50;
+        end
+        if (evbytes[23:20] === 4'b0010)
+            $display("PASS: gpio4 debounce event test");
+        else
+            $display("FAIL: gpio4 debounce event test");
+
+
         #500  // some time later ...
         $finish;
     end
@@ -0,0 +1,291 @@
+// *********************************************************
+// Copyright (c) 2021 Demand Peripherals, Inc.
+//
+// This file is licensed separately for private and commercial
+// use.  See LICENSE.txt which should have accompanied this file
+// for details.  If LICENSE.txt is not available please contact
+// support@demandperipherals.com to receive a copy.
+//
+// In general, you may use, modify, redistribute this code, and
+// use any associated patent(s) as long as
+// 1) the above copyright is included in all redistributions,
+// 2) this notice is included in all source redistributions, and
+// 3) this code or resulting binary is not sold as part of a
+//    commercial product.  See LICENSE.txt for definitions.
+//
+// DPI PROVIDES THE SOFTWARE "AS IS," WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING
+// WITHOUT LIMITATION ANY WARRANTIES OR CONDITIONS OF TITLE,
+// NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR
+// PURPOSE.  YOU ARE SOLELY RESPONSIBLE FOR DETERMINING THE
+// APPROPRIATENESS OF USING OR REDISTRIBUTING THE SOFTWARE (WHERE
+// ALLOWED), AND ASSUME ANY RISKS ASSOCIATED WITH YOUR EXERCISE OF
+// PERMISSIONS UNDER THIS AGREEMENT.
+//
+// This software may be covered by US patent #10,324,889. Rights
+// to use these patents is included in the license agreements.
+// See LICENSE.txt for more information.
+// *********************************************************
+
+/////////////////////////////////////////////////////////////////////////
+// in4_tb.v : Testbench for the IN4 peripheral
+//
+//  Registers are
+//    Addr=0    Data In
+//    Addr=1    Update on change register.  If set, input change sends auto update
+//    Addr=2    Event mode.  Input changes are queued with a timestamp
+//    Addr=3    Debounce time in units of 100 microseconds
+//
+//  IN4 is a quad input peripheral.  Input pins can be configured to
+//  send the host an update when the pin changes value or to queue
+//  each change as a timestamped event.  The peripheral swaps the bit
+//  order of its inputs so in[3] is pin 0 and in[0] is pin 3.
+//
+//  The test procedure is as follows:
+//  - Set bus lines and inputs to default state
+//  - Write 1111 to the update-on-change register
+//  - Set in[0] high (pin 3)
+//  - Verify that datout is 8'h01 on a poll (test update-on-change)
+//  - Read the data register and verify it is 1000
+//  - Verify that peripheral does not respond to a poll
+//  - Turn on event mode
+//  - Raise in[3] (pin 0), wait 100 us, and drop it again
+//  - Verify that a poll asks to send two events, 6 bytes
+//  - Read the update-on-change register (ends the autosend)
+//  - Verify that the read gave the register and the events are kept
+//  - Read the 6 bytes in order.  Verify the pins and levels and that
+//    the timestamps are 100 us apart
+//  - Verify that peripheral does not respond to a poll
+//  - Set a 300 us debounce time
+//  - Raise in[1] (pin 2) for 150 us and verify there is no event
+//  - Raise in[1] for 500 us and verify there is one event for pin 2
+//
+ 
+`timescale 1ns/1ns
+
+module in4_tb;
+    // direction is relative to the DUT
+    reg    clk;              // system clock
+    reg    rdwr;             // direction of this transfer. Read=1; Write=0
+    reg    strobe;           // true on full valid command
+    reg    [3:0] our_addr;   // high byte of our assigned address
+    reg    [11:0] addr;      // address of target peripheral
+    reg    busy_in;          // ==1 if a previous peripheral is busy
+    wire   busy_out;         // ==our busy state if our address, pass through otherwise
+    reg    addr_match_in;    // ==1 if a previous peripheral claims the address
+    wire   addr_match_out;   // ==1 if we claim the above address, pass through otherwise
+    reg    [7:0] datin ;     // Data INto the peripheral;
+    wire   [7:0] datout ;    // Data OUTput from the peripheral, = datin if not us.
+    reg    u1clk;            // one sysclk pulse per microsecond
+    reg    [3:0] in;         // the peripheral inputs
+    reg    [4:0] uscnt;      // sysclk count for u1clk
+    reg    [47:0] evbytes;   // event bytes read from the peripheral
+    integer k;               // byte count of an event read
+
+
+    // Add the device under test
+    in4 in4_dut(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
+          addr_match_in,addr_match_out,datin,datout,u1clk,in);
+
+    // generate the clock(s)
+    initial  clk = 0;
+    always   #25 clk = ~clk;
+    initial  u1clk = 0;
+    initial  uscnt = 0;
+    always @(posedge clk)
+    begin
+        uscnt <= (uscnt == 19) ? 5'h00 : uscnt + 5'h01;
+        u1clk <= (uscnt == 19);
+    end
+
+
+    // Test the device
+    initial
+    begin
+        $dumpfile ("in4_tb.xt2");
+        $dumpvars (0, in4_tb);
+
+        //  - Set bus lines and inputs to default state
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        in = 4'b0000;
+
+        #500  // some time later ...
+        //  - Write 1111 to the update-on-change register
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h201;
+        busy_in = 0; addr_match_in = 0; datin = 8'h0f;
+        #50
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+        #500  // some time later ...
+        //  - Set in[0] high (pin 3)
+        in = 4'b0001;
+
+        #500  // some time later ...
+        //  - Verify that datout is 8'h01 on a poll (test update-on-change)
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h01)
+            $display("PASS: in4 update on change test");
+        else
+            $display("FAIL: in4 update on change test");
+
+        //  - Read the data register and verify it is 1000
+        rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #10
+        if (datout === 8'h08)
+            $display("PASS: in4 input test");
+        else
+            $display("FAIL: in4 input test");
+        #40
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+        #500  // some time later ...
+        //  - Verify that peripheral does not respond to a poll
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h00)
+            $display("PASS: in4 update pending cleared test");
+        else
+            $display("FAIL: in4 update pending cleared test");
+
+
+        // Test the event FIFO and the timestamps
+        //  - Turn on event mode
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h202;
+        busy_in = 0; addr_match_in = 0; datin = 8'h01;
+        #50
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+        #500  // some time later ...
+        //  - Raise in[3] (pin 0), wait 100 us, and drop it again
+        in = 4'b1001;
+        #100000
+        in = 4'b0001;
+
+        #500  // some time later ...
+        //  - Verify that a poll asks to send two events, 6 bytes
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h06)
+            $display("PASS: in4 event poll test");
+        else
+            $display("FAIL: in4 event poll test");
+
+        //  - Read the update-on-change register (ends the autosend)
+        rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h201;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #10
+        if (datout === 8'h0f)
+            $display("PASS: in4 register read during autosend test");
+        else
+            $display("FAIL: in4 register read during autosend test");
+        #40
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+        #500  // some time later ...
+        //  - Verify that the events are kept
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h06)
+            $display("PASS: in4 events kept test");
+        else
+            $display("FAIL: in4 events kept test");
+
+        //  - Read the 6 bytes in order.  Sample before the clock edge
+        //    since each read moves to the next byte.
+        for (k = 0; k < 6; k = k + 1)
+        begin
+            rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h200 + k;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #10
+            evbytes = {evbytes[39:0], datout};
+            #40
+            rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #50;
+        end
+        //  - Verify pin 0 went high then low
+        if ((evbytes[47:44] === 4'b1000) && (evbytes[23:20] === 4'b0000))
+            $display("PASS: in4 event pin and level test");
+        else
+            $display("FAIL: in4 event pin and level test");
+        //  - Verify the timestamps are 100 us apart
+        if ((evbytes[19:0] - evbytes[43:24]) === 20'd100)
+            $display("PASS: in4 event timestamp test");
+        else
+            $display("FAIL: in4 event timestamp test");
+
+        #500  // some time later ...
+        //  - Verify that peripheral does not respond to a poll
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h00)
+            $display("PASS: in4 event FIFO empty test");
+        else
+            $display("FAIL: in4 event FIFO empty test");
+
+
+        // Test the debounce filter
+        //  - Set a 300 us debounce time
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h203;
+        busy_in = 0; addr_match_in = 0; datin = 8'h03;
+        #50
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+        #500  // some time later ...
+        //  - Raise in[1] (pin 2) for 150 us and verify there is no event
+        in = 4'b0011;
+        #150000
+        in = 4'b0001;
+        #500000
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h00)
+            $display("PASS: in4 debounce glitch test");
+        else
+            $display("FAIL: in4 debounce glitch test");
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+        //  - Raise in[1] for 500 us and verify there is one event
+        in = 4'b0011;
+        #500000
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h03)
+            $display("PASS: in4 debounce test");
+        else
+            $display("FAIL: in4 debounce test");
+        for (k = 0; k < 3; k = k + 1)
+        begin
+            rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h200 + k;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #10
+            evbytes = {evbytes[39:0], datout};
+            #40
+            rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #50;
+        end
+        if (evbytes[23:20] === 4'b1010)
+            $display("PASS: in4 debounce event test");
+        else
+            $display("FAIL: in4 debounce event test");
+
+        $finish;
+    end
+endmodule
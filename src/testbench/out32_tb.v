@@ -0,0 +1,249 @@
+// *********************************************************
+// Copyright (c) 2021 Demand Peripherals, Inc.
+//
+// This file is licensed separately for private and commercial
+// use.  See LICENSE.txt which should have accompanied this file
+// for details.  If LICENSE.txt is not available please contact
+// support@demandperipherals.com to receive a copy.
+//
+// In general, you may use, modify, redistribute this code, and
+// use any associated patent(s) as long as
+// 1) the above copyright is included in all redistributions,
+// 2) this notice is included in all source redistributions, and
+// 3) this code or resulting binary is not sold as part of a
+//    commercial product.  See LICENSE.txt for definitions.
+//
+// DPI PROVIDES THE SOFTWARE "AS IS," WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING
+// WITHOUT LIMITATION ANY WARRANTIES OR CONDITIONS OF TITLE,
+// NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR
+// PURPOSE.  YOU ARE SOLELY RESPONSIBLE FOR DETERMINING THE
+// APPROPRIATENESS OF USING OR REDISTRIBUTING THE SOFTWARE (WHERE
+// ALLOWED), AND ASSUME ANY RISKS ASSOCIATED WITH YOUR EXERCISE OF
+// PERMISSIONS UNDER THIS AGREEMENT.
+//
+// This software may be covered by US patent #10,324,889. Rights
+// to use these patents is included in the license agreements.
+// See LICENSE.txt for more information.
+// *********************************************************
+
+/////////////////////////////////////////////////////////////////////////
+// out32_tb.v : Testbench for the OUT32 peripheral
+//
+//  Registers are
+//    Addr=16-19  Packed output value, pins 31-24 in Reg 16
+//    Addr=20-23  Set the outputs set in the mask
+//    Addr=24-27  Clear the outputs set in the mask
+//    Addr=28-31  Toggle the outputs set in the mask
+//
+//  The test procedure is as follows:
+//  - Set bus lines to default state
+//  - Write 12345678 to Regs 16-19 and verify the outputs
+//  - Set 80000001 with Regs 20-23 and verify the outputs
+//  - Toggle with a write of Reg 31 alone and verify only pins 7-0 change
+//  - Clear with a write of Reg 27 alone and verify only pins 7-0 change
+//  - Set with a write of Reg 23 alone and verify only pins 7-0 change
+//  - Load with a write of Regs 18-19 and verify the upper bytes are zero
+//
+ 
+`timescale 1ns/1ns
+
+module out32_tb;
+    // direction is relative to the DUT
+    reg    clk;              // system clock
+    reg    rdwr;             // direction of this transfer. Read=1; Write=0
+    reg    strobe;           // true on full valid command
+    reg    [3:0] our_addr;   // high byte of our assigned address
+    reg    [11:0] addr;      // address of target peripheral
+    reg    busy_in;          // ==1 if a previous peripheral is busy
+    wire   busy_out;         // ==our busy state if our address, pass through otherwise
+    reg    addr_match_in;    // ==1 if a previous peripheral claims the address
+    wire   addr_match_out;   // ==1 if we claim the above address, pass through otherwise
+    reg    [7:0] datin ;     // Data INto the peripheral;
+    wire   [7:0] datout ;    // Data OUTput from the peripheral, = datin if not us.
+    reg    u10clk;           // 10 microsecond clock pulse
+    wire   pin2;             // Pin2 to the out32 card.  Clock control and MS data.
+    wire   pin4;             // Pin4 to the out32 card.  Clock control.
+    wire   pin6;             // Pin6 to the out32 card.  Clock control.
+    wire   pin8;             // Pin8 to the out32 card.  LS data.
+    reg    [31:0] wrval;     // packed value to write
+    reg    [31:0] rdval;     // packed outputs read back
+    integer k;               // byte count
+
+
+    // Add the device under test
+    out32 out32_dut(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
+          addr_match_in,addr_match_out,datin,datout,
+          u10clk,pin2,pin4,pin6,pin8);
+
+    // generate the clock(s)
+    initial  clk = 0;
+    always   #25 clk = ~clk;
+    initial  u10clk = 0;
+
+
+    // Test the device
+    initial
+    begin
+        $dumpfile ("out32_tb.xt2");
+        $dumpvars (0, out32_tb);
+
+        //  - Set bus lines to default state
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+        #500  // some time later ...
+        //  - Write 12345678 to Regs 16-19 and verify the outputs
+        wrval = 32'h12345678;
+        for (k = 0; k < 4; k = k + 1)
+        begin
+            rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h210 + k;
+            busy_in = 0; addr_match_in = 0; datin = wrval[31:24];
+            wrval = {wrval[23:0], 8'h00};
+            #50;
+        end
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        for (k = 0; k < 4; k = k + 1)
+        begin
+            rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h210 + k;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #10
+            rdval = {rdval[23:0], datout};
+            #40;
+        end
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        if (rdval === 32'h12345678)
+            $display("PASS: out32 packed write test");
+        else
+            $display("FAIL: out32 packed write test");
+
+        #500  // some time later ...
+        //  - Set 80000001 with Regs 20-23 and verify the outputs
+        wrval = 32'h80000001;
+        for (k = 0; k < 4; k = k + 1)
+        begin
+            rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h214 + k;
+            busy_in = 0; addr_match_in = 0; datin = wrval[31:24];
+            wrval = {wrval[23:0], 8'h00};
+            #50;
+        end
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        for (k = 0; k < 4; k = k + 1)
+        begin
+            rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h210 + k;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #10
+            rdval = {rdval[23:0], datout};
+            #40;
+        end
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        if (rdval === 32'h92345679)
+            $display("PASS: out32 packed set test");
+        else
+            $display("FAIL: out32 packed set test");
+
+        #500  // some time later ...
+        //  - Toggle with a write of Reg 31 alone and verify only pins 7-0 change
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h21f;
+        busy_in = 0; addr_match_in = 0; datin = 8'h0f;
+        #50
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        for (k = 0; k < 4; k = k + 1)
+        begin
+            rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h210 + k;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #10
+            rdval = {rdval[23:0], datout};
+            #40;
+        end
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        if (rdval === 32'h92345676)
+            $display("PASS: out32 single byte toggle test");
+        else
+            $display("FAIL: out32 single byte toggle test");
+
+        #500  // some time later ...
+        //  - Clear with a write of Reg 27 alone and verify only pins 7-0 change
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h21b;
+        busy_in = 0; addr_match_in = 0; datin = 8'h06;
+        #50
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        for (k = 0; k < 4; k = k + 1)
+        begin
+            rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h210 + k;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #10
+            rdval = {rdval[23:0], datout};
+            #40;
+        end
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        if (rdval === 32'h92345670)
+            $display("PASS: out32 single byte clear test");
+        else
+            $display("FAIL: out32 single byte clear test");
+
+        #500  // some time later ...
+        //  - Set with a write of Reg 23 alone and verify only pins 7-0 change
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h217;
+        busy_in = 0; addr_match_in = 0; datin = 8'h80;
+        #50
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        for (k = 0; k < 4; k = k + 1)
+        begin
+            rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h210 + k;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #10
+            rdval = {rdval[23:0], datout};
+            #40;
+        end
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        if (rdval === 32'h923456f0)
+            $display("PASS: out32 single byte set test");
+        else
+            $display("FAIL: out32 single byte set test");
+
+        #500  // some time later ...
+        //  - Load with a write of Regs 18-19 and verify the upper bytes are zero
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h212;
+        busy_in = 0; addr_match_in = 0; datin = 8'h01;
+        #50
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h213;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        for (k = 0; k < 4; k = k + 1)
+        begin
+            rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h210 + k;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #10
+            rdval = {rdval[23:0], datout};
+            #40;
+        end
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        if (rdval === 32'h00000100)
+            $display("PASS: out32 partial write test");
+        else
+            $display("FAIL: out32 partial write test");
+
+        #500  // some time later ...
+        $finish;
+    end
+endmodule
@@ -0,0 +1,265 @@
+// *********************************************************
+// Copyright (c) 2021 Demand Peripherals, Inc.
+//
+// This file is licensed separately for private and commercial
+// use.  See LICENSE.txt which should have accompanied this file
+// for details.  If LICENSE.txt is not available please contact
+// support@demandperipherals.com to receive a copy.
+//
+// In general, you may use, modify, redistribute this code, and
+// use any associated patent(s) as long as
+// 1) the above copyright is included in all redistributions,
+// 2) this notice is included in all source redistributions, and
+// 3) this code or resulting binary is not sold as part of a
+//    commercial product.  See LICENSE.txt for definitions.
+//
+// DPI PROVIDES THE SOFTWARE "AS IS," WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING
+// WITHOUT LIMITATION ANY WARRANTIES OR CONDITIONS OF TITLE,
+// NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR
+// PURPOSE.  YOU ARE SOLELY RESPONSIBLE FOR DETERMINING THE
+// APPROPRIATENESS OF USING OR REDISTRIBUTING THE SOFTWARE (WHERE
+// ALLOWED), AND ASSUME ANY RISKS ASSOCIATED WITH YOUR EXERCISE OF
+// PERMISSIONS UNDER THIS AGREEMENT.
+//
+// This software may be covered by US patent #10,324,889. Rights
+// to use these patents is included in the license agreements.
+// See LICENSE.txt for more information.
+// *********************************************************
+
+/////////////////////////////////////////////////////////////////////////
+// pulse2_tb.v : Testbench for the PULSE2 peripheral
+//
+//  Registers are
+//    Addr=0,1    Period in steps of 10 ns
+//    Addr=2,3    Pulse 1 width in steps of 10 ns
+//    Addr=8      Trigger configuration.  2 is gate mode
+//    Addr=9,10   Burst count
+//
+//  The test procedure is as follows:
+//  - Set bus lines and trigger to default state
+//  - Set a period of 200 ns, a pulse 1 width of 50 ns, gate mode,
+//    and a burst of 5
+//  - Open the gate for about two periods then close it
+//  - Open the gate for about one period then close it
+//  - Open the gate and leave it open
+//  - Verify that 5 pulses were sent in total
+//  - Verify that the peripheral asks to send the burst status
+//  - Verify that the burst is done
+//
+ 
+`timescale 1ns/1ns
+
+module pulse2_tb;
+    // direction is relative to the DUT
+    reg    clk;              // system clock
+    reg    rdwr;             // direction of this transfer. Read=1; Write=0
+    reg    strobe;           // true on full valid command
+    reg    [3:0] our_addr;   // high byte of our assigned address
+    reg    [11:0] addr;      // address of target peripheral
+    reg    busy_in;          // ==1 if a previous peripheral is busy
+    wire   busy_out;         // ==our busy state if our address, pass through otherwise
+    reg    addr_match_in;    // ==1 if a previous peripheral claims the address
+    wire   addr_match_out;   // ==1 if we claim the above address, pass through otherwise
+    reg    [7:0] datin ;     // Data INto the peripheral;
+    wire   [7:0] datout ;    // Data OUTput from the peripheral, = datin if not us.
+    reg    trig;             // Trigger input
+    wire   p1p;              // Pulse 1 uninverted
+    wire   p1n;              // Pulse 1 inverted
+    wire   p2p;              // Pulse 2 uninverted
+    wire   p2n;              // Pulse 2 inverted
+    integer pulses;          // number of pulse 1 rising edges
+
+
+    // Add the device under test
+    pulse2 pulse2_dut(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
+          addr_match_in,addr_match_out,datin,datout,trig,p1p,p1n,p2p,p2n);
+
+    // generate the clock(s)
+    initial  clk = 0;
+    always   #25 clk = ~clk;
+
+    // count the pulses
+    initial  pulses = 0;
+    always @(posedge p1p)
+        pulses = pulses + 1;
+
+
+    // Test the device
+    initial
+    begin
+        $dumpfile ("pulse2_tb.xt2");
+        $dumpvars (0, pulse2_tb);
+
+        //  - Set bus lines and trigger to default state
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        trig = 0;
+
+        #500  // some time later ...
+        //  - Set a period of 200 ns, a pulse 1 width of 50 ns, gate mode,
+        //    and a burst of 5
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h201;
+        busy_in = 0; addr_match_in = 0; datin = 8'd20;
+        #50
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h202;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h203;
+        busy_in = 0; addr_match_in = 0; datin = 8'd5;
+        #50
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h208;
+        busy_in = 0; addr_match_in = 0; datin = 8'h02;
+        #50
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h209;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h20a;
+        busy_in = 0; addr_match_in = 0; datin = 8'd5;
+        #50
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+        #500  // some time later ...
+        pulses = 0;
+
+        //  - Open the gate for about two periods then close it
+        trig = 1;
+        #430
+        trig = 0;
+        #1000
+
+        //  - Open the gate for about one period then close it
+        trig = 1;
+        #230
+        trig = 0;
+        #1000
+
+        //  - Open the gate and leave it open
+        trig = 1;
+        #3000
+
+        //  - Verify that 5 pulses were sent in total
+        if (pulses == 5)
+            $display("PASS: pulse2 gated burst count test");
+        else
+            $display("FAIL: pulse2 gated burst count test");
+
+        //  - Verify that the peripheral asks to send the burst status
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h01)
+            $display("PASS: pulse2 burst done poll test");
+        else
+            $display("FAIL: pulse2 burst done poll test");
+
+        //  - Verify that the burst is done
+        rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #10
+        if (datout === 8'h01)
+            $display("PASS: pulse2 burst status test");
+        else
+            $display("FAIL: pulse2 burst status test");
+        #40
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+        #500  // some time later ...
+        $finish;
+    end
+endmodule
+
+
+// this module is a simulation equivalent of the
+// Xilinx DCM_SP as used to make the 100 MHz clock
+module DCM_SP (
+    output  CLK0,          // 0 degree DCM CLK output
+    output  CLK180,        // 180 degree DCM CLK output
+    output  CLK270,        // 270 degree DCM CLK output
+    output  CLK2X,         // 2X DCM CLK output
+    output  CLK2X180,      // 2X, 180 degree DCM CLK out
+    output  CLK90,         // 90 degree DCM CLK output
+    output  CLKDV,         // Divided DCM CLK out (CLKDV_DIVIDE)
+    output  CLKFX,         // DCM CLK synthesis out (M/D)
+    output  CLKFX180,      // 180 degree CLK synthesis out
+    output  LOCKED,        // DCM LOCK status output
+    output  PSDONE,        // Dynamic phase adjust done output
+    output  [7:0] STATUS,  // 8-bit DCM status bits output
+    input   CLKFB,         // DCM clock feedback
+    input   CLKIN,         // Clock input
+    input   PSCLK,         // Dynamic phase adjust clock input
+    input   PSEN,          // Dynamic phase adjust enable input
+    input   PSINCDEC,      // Dynamic phase adjust increment/decrement
+    input   RST);          // DCM asynchronous reset input
+
+    parameter CLKDV_DIVIDE = 2.0;
+    parameter CLKFX_DIVIDE = 1;
+    parameter CLKFX_MULTIPLY = 5;
+    parameter CLKIN_DIVIDE_BY_2 = "FALSE";
+    parameter CLKIN_PERIOD = 60.0;
+    parameter CLKOUT_PHASE_SHIFT = "NONE";
+    parameter CLK_FEEDBACK = "NONE";
+    parameter DESKEW_ADJUST = "SYSTEM_SYNCHRONOUS";
+    parameter DFS_FREQUENCY_MODE = "HIGH";
+    parameter DLL_FREQUENCY_MODE = "HIGH";
+    parameter DUTY_CYCLE_CORRECTION = "TRUE";
+    parameter FACTORY_JF = 16'hC080;
+    parameter PHASE_SHIFT = 0;
+    parameter STARTUP_WAIT = "FALSE";
+
+    reg    fx;              // the 100 MHz clock
+
+    // five times the 50 ns testbench clock
+    initial
+    begin
+        fx = 0;
+        #2;
+        forever #5 fx = ~fx;
+    end
+
+    assign CLKFX = fx;
+    assign CLKFX180 = ~fx;
+    assign LOCKED = 1'b1;
+
+endmodule
+
+
+// this module is a simulation equivalent of the
+// Xilinx ODDR2 DDR output register
+module ODDR2 (
+    output  Q,             // 1-bit DDR output data
+    input   C0,            // 1-bit clock input
+    input   C1,            // 1-bit clock input
+    input   CE,            // 1-bit clock enable input
+    input   D0,            // 1-bit data input (associated with C0)
+    input   D1,            // 1-bit data input (associated with C1)
+    input   R,             // 1-bit reset input
+    input   S);            // 1-bit set input
+
+    parameter DDR_ALIGNMENT = "NONE";
+    parameter INIT = 1'b0;
+    parameter SRTYPE = "SYNC";
+
+    reg    q;               // output register
+
+    initial
+    begin
+        q = INIT;
+    end
+
+    always @(posedge C0)
+        if (CE)
+            q <= D0;
+
+    always @(posedge C1)
+        if (CE)
+            q <= D1;
+
+    assign Q = q;
+
+endmodule
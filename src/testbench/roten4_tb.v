@@ -0,0 +1,312 @@
+// *********************************************************
+// Copyright (c) 2021 Demand Peripherals, Inc.
+//
+// This file is licensed separately for private and commercial
+// use.  See LICENSE.txt which should have accompanied this file
+// for details.  If LICENSE.txt is not available please contact
+// support@demandperipherals.com to receive a copy.
+//
+// In general, you may use, modify, redistribute this code, and
+// use any associated patent(s) as long as
+// 1) the above copyright is included in all redistributions,
+// 2) this notice is included in all source redistributions, and
+// 3) this code or resulting binary is not sold as part of a
+//    commercial product.  See LICENSE.txt for definitions.
+//
+// DPI PROVIDES THE SOFTWARE "AS IS," WITHOUT WARRANTIES OR
+// CONDITIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING
+// WITHOUT LIMITATION ANY WARRANTIES OR CONDITIONS OF TITLE,
+// NON-INFRINGEMENT, MERCHANTABILITY, OR FITNESS FOR A PARTICULAR
+// PURPOSE.  YOU ARE SOLELY RESPONSIBLE FOR DETERMINING THE
+// APPROPRIATENESS OF USING OR REDISTRIBUTING THE SOFTWARE (WHERE
+// ALLOWED), AND ASSUME ANY RISKS ASSOCIATED WITH YOUR EXERCISE OF
+// PERMISSIONS UNDER THIS AGREEMENT.
+//
+// This software may be covered by US patent #10,324,889. Rights
+// to use these patents is included in the license agreements.
+// See LICENSE.txt for more information.
+// *********************************************************
+
+/////////////////////////////////////////////////////////////////////////
+// roten4_tb.v : Testbench for the ROTEN4 peripheral
+//
+//  Registers are
+//    Addr=0-3    Saturated 7 bit count of encoders 0 to 3
+//    Addr=4      Output values
+//    Addr=6      Configuration.  Bit 0 set sends Regs 16-31
+//    Addr=8      Scan dwell time in sysclks
+//    Addr=16+4n  Signed 16 bit count of encoder n, high byte
+//    Addr=17+4n  Signed 16 bit count of encoder n, low byte
+//
+//  ROTEN4 counts four quadrature encoders on the inputs of an io8
+//  card.  The serial input from the card, pin8, is modeled from the
+//  bit the peripheral is reading.  Encoder n is on inputs 2n and 2n+1.
+//
+//  The test procedure is as follows:
+//  - Set bus lines and inputs to default state
+//  - Set a one sysclk dwell so the card scans quickly
+//  - Turn encoder 0 up 5 steps
+//  - Verify that a poll asks to send 4 bytes
+//  - Read Regs 0 to 3 and verify encoder 0 reads 5
+//  - Verify that peripheral does not respond to a poll
+//  - Turn encoder 1 up 70 steps
+//  - Read Regs 0 to 3 and verify encoder 1 reads the saturated 63
+//  - Verify that a poll asks to send the rest
+//  - Read Regs 0 to 3 and verify encoder 1 reads the remaining 7
+//  - Set the outputs to a5 and turn on extended mode
+//  - Turn encoder 2 down 3 steps
+//  - Verify that a poll asks to send 16 bytes
+//  - Read the output register (ends the autosend)
+//  - Verify that the read gave the register and the counts are kept
+//  - Read the 16 bytes in order and verify encoder 2 is -3
+//  - Verify that peripheral does not respond to a poll
+//
+ 
+`timescale 1ns/1ns
+
+module roten4_tb;
+    // direction is relative to the DUT
+    reg    clk;              // system clock
+    reg    rdwr;             // direction of this transfer. Read=1; Write=0
+    reg    strobe;           // true on full valid command
+    reg    [3:0] our_addr;   // high byte of our assigned address
+    reg    [11:0] addr;      // address of target peripheral
+    reg    busy_in;          // ==1 if a previous peripheral is busy
+    wire   busy_out;         // ==our busy state if our address, pass through otherwise
+    reg    addr_match_in;    // ==1 if a previous peripheral claims the address
+    wire   addr_match_out;   // ==1 if we claim the above address, pass through otherwise
+    reg    [7:0] datin ;     // Data INto the peripheral;
+    wire   [7:0] datout ;    // Data OUTput from the peripheral, = datin if not us.
+    reg    u10clk;           // 10 microsecond clock pulse
+    reg    m1clk;            // 1 millisecond clock pulse
+    wire   pin2;             // Pin2 to the io8 card.  Clock control and data.
+    wire   pin4;             // Pin4 to the io8 card.  Clock control.
+    wire   pin6;             // Pin6 to the io8 card.  Clock control.
+    wire   pin8;             // Serial data from the io8
+    reg    [7:0] inputs;     // the encoder inputs on the io8 card
+    reg    [127:0] upbytes;  // autosend bytes read from the peripheral
+    reg    [7:0] rdval;      // a register read from the peripheral
+    integer k;               // step or byte count
+
+
+    // Add the device under test
+    roten4 roten4_dut(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
+          addr_match_in,addr_match_out,datin,datout,
+          u10clk,m1clk,pin2,pin4,pin6,pin8);
+
+    // generate the clock(s)
+    initial  clk = 0;
+    always   #25 clk = ~clk;
+    initial  u10clk = 0;
+    initial  m1clk = 0;
+
+    // the io8 card input shift register
+    assign pin8 = inputs[roten4_dut.bst];
+
+    // {b,a} encoder inputs for each quadrature phase.  Counting up
+    // the phases turns the encoder up.
+    function [1:0] quadph;
+        input [1:0] ph;
+        quadph = (ph == 0) ? 2'b00 : (ph == 1) ? 2'b10 : (ph == 2) ? 2'b11 : 2'b01;
+    endfunction
+
+
+    // Test the device
+    initial
+    begin
+        $dumpfile ("roten4_tb.xt2");
+        $dumpvars (0, roten4_tb);
+
+        //  - Set bus lines and inputs to default state
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        inputs = 8'h00;
+
+        #500  // some time later ...
+        //  - Set a one sysclk dwell so the card scans quickly
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h208;
+        busy_in = 0; addr_match_in = 0; datin = 8'h01;
+        #50
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+        //  - Turn encoder 0 up 5 steps
+        for (k = 1; k <= 5; k = k + 1)
+        begin
+            inputs[1:0] = quadph(k);
+            #10000;
+        end
+
+        //  - Verify that a poll asks to send 4 bytes
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h04)
+            $display("PASS: roten4 poll test");
+        else
+            $display("FAIL: roten4 poll test");
+
+        //  - Read Regs 0 to 3 and verify encoder 0 reads 5.  Sample
+        //    before the clock edge since a read changes the count.
+        for (k = 0; k < 4; k = k + 1)
+        begin
+            rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h200 + k;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #10
+            if (k == 0)
+                rdval = datout;
+            #40
+            rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #50;
+        end
+        if (rdval === 8'h05)
+            $display("PASS: roten4 count test");
+        else
+            $display("FAIL: roten4 count test");
+
+        //  - Verify that peripheral does not respond to a poll
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h00)
+            $display("PASS: roten4 count cleared test");
+        else
+            $display("FAIL: roten4 count cleared test");
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+
+        // Test that a saturated read keeps the rest of the count
+        //  - Turn encoder 1 up 70 steps
+        for (k = 1; k <= 70; k = k + 1)
+        begin
+            inputs[3:2] = quadph(k);
+            #10000;
+        end
+
+        //  - Read Regs 0 to 3 and verify encoder 1 reads the saturated 63
+        for (k = 0; k < 4; k = k + 1)
+        begin
+            rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h200 + k;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #10
+            if (k == 1)
+                rdval = datout;
+            #40
+            rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #50;
+        end
+        if (rdval === 8'h3f)
+            $display("PASS: roten4 saturated count test");
+        else
+            $display("FAIL: roten4 saturated count test");
+
+        //  - Verify that a poll asks to send the rest
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h04)
+            $display("PASS: roten4 count remainder poll test");
+        else
+            $display("FAIL: roten4 count remainder poll test");
+
+        //  - Read Regs 0 to 3 and verify encoder 1 reads the remaining 7
+        for (k = 0; k < 4; k = k + 1)
+        begin
+            rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h200 + k;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #10
+            if (k == 1)
+                rdval = datout;
+            #40
+            rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #50;
+        end
+        if (rdval === 8'h07)
+            $display("PASS: roten4 count remainder test");
+        else
+            $display("FAIL: roten4 count remainder test");
+
+
+        // Test the extended autosend
+        //  - Set the outputs to a5 and turn on extended mode
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h204;
+        busy_in = 0; addr_match_in = 0; datin = 8'ha5;
+        #50
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h206;
+        busy_in = 0; addr_match_in = 0; datin = 8'h01;
+        #50
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+        //  - Turn encoder 2 down 3 steps
+        for (k = 1; k <= 3; k = k + 1)
+        begin
+            inputs[5:4] = quadph(4 - k);
+            #10000;
+        end
+
+        //  - Verify that a poll asks to send 16 bytes
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h10)
+            $display("PASS: roten4 extended poll test");
+        else
+            $display("FAIL: roten4 extended poll test");
+
+        //  - Read the output register (ends the autosend)
+        rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h204;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #10
+        if (datout === 8'ha5)
+            $display("PASS: roten4 register read during autosend test");
+        else
+            $display("FAIL: roten4 register read during autosend test");
+        #40
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+
+        //  - Verify that the counts are kept
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h10)
+            $display("PASS: roten4 counts kept test");
+        else
+            $display("FAIL: roten4 counts kept test");
+
+        //  - Read the 16 bytes in order and verify encoder 2 is -3
+        for (k = 0; k < 16; k = k + 1)
+        begin
+            rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h200 + k;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #10
+            upbytes = {upbytes[119:0], datout};
+            #40
+            rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #50;
+        end
+        if ((upbytes[63:48] === 16'hfffd) && (upbytes[127:112] === 16'h0000))
+            $display("PASS: roten4 extended autosend test");
+        else
+            $display("FAIL: roten4 extended autosend test");
+
+        //  - Verify that peripheral does not respond to a poll
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h00)
+            $display("PASS: roten4 autosend done test");
+        else
+            $display("FAIL: roten4 autosend done test");
+
+        #500  // some time later ...
+        $finish;
+    end
+endmodule
@@ -42,6 +42,12 @@
 //      Reg 3:  Bits 0-2: LED control
 //              Bits 4:   Contrast control (has minimal effect)
 //      Reg 4:  Bits 0-5: Character FIFO for the text display
+//      Reg 8:  Event mode.  If bit 0 is set keypad, rotary, and button
+//              changes are queued with a timestamp
+//
+//  The serial input from the tif card, pin8, is modeled from the bit
+//  the peripheral is reading.  Bit 7 is the button, given by btn, and
+//  the keypad and rotary encoder bits are held high.
 //
 //  The test procedure is as follows:
 //  - Test fifo full
@@ -50,6 +56,14 @@
 //    -- delay long enough for the characters to drain from the buffer
 //    -- For loop writing 16 bytes to reg 4, the character FIFO
 //       -- Verify that we do not recognize our address on the last write
+//  - Test button events
+//    -- Start a long tone to keep the shift registers running
+//    -- Turn on event mode and verify there are no events
+//    -- Press the button and verify a poll asks for 3 bytes
+//    -- Read the event mode register (ends the autosend)
+//    -- Verify that the read gave the register and the event is kept
+//    -- Read the event and verify it is a button press
+//    -- Release the button and verify the event and its timestamp
 //
  
 `timescale 1ns/1ns
@@ -73,7 +87,11 @@ module tif_tb;
     wire   pin4;             // Pin4 to the tif card.  Clock control.
     wire   pin6;             // Pin6 to the tif card.  Clock control.
     wire   pin8;             // Serial data from the tif
+    reg    btn;              // Button level, 0 when pressed
+    reg    [47:0] evbytes;   // event bytes read from the peripheral
+    reg    [15:0] tsdown;    // timestamp of the button press
     integer i;               // test loop counter
+    integer k;               // byte count of an event read
 
     // Add the device under test
     tif tif_dut(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,addr_match_in,
@@ -88,6 +106,9 @@ module tif_tb;
     initial  m10clk = 0;
     always   begin #(19 * 50); u1clk = 1; #50; u1clk = 0; end
 
+    // the 74165 on the tif card
+    assign pin8 = (tif_dut.bst[2:0] == 7) ? btn : 1'b1;
+
 
     // Test the device
     initial
@@ -98,6 +119,7 @@ module tif_tb;
         //  - Set bus lines and FPGA pins to default state
         rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
         busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        btn = 1;
 
 
         #500  // some time later ...
@@ -128,6 +150,117 @@ module tif_tb;
         end
         #200
 
+
+        // Test button events
+        //  - Start a long tone to keep the shift registers running
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h202;
+        busy_in = 0; addr_match_in = 0; datin = 8'h1f;
+        #50
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #500000
+
+        //  - Turn on event mode and verify there are no events
+        rdwr = 0; strobe = 1; our_addr = 4'h2; addr = 12'h208;
+        busy_in = 0; addr_match_in = 0; datin = 8'h01;
+        #50
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #500
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h00)
+            $display("PASS: TIF no event check");
+        else
+            $display("FAIL: TIF no event check");
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+
+        //  - Press the button and verify a poll asks for 3 bytes
+        btn = 0;
+        #500000
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h03)
+            $display("PASS: TIF button event poll check");
+        else
+            $display("FAIL: TIF button event poll check");
+
+        //  - Read the event mode register (ends the autosend)
+        rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h208;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #10
+        if (datout === 8'h01)
+            $display("PASS: TIF register read during autosend check");
+        else
+            $display("FAIL: TIF register read during autosend check");
+        #40
+        rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+
+        //  - Verify that the event is kept
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h03)
+            $display("PASS: TIF event kept check");
+        else
+            $display("FAIL: TIF event kept check");
+
+        //  - Read the event and verify it is a button press.  Sample
+        //    before the clock edge since each read moves to the next byte.
+        for (k = 0; k < 3; k = k + 1)
+        begin
+            rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h200 + k;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #10
+            evbytes = {evbytes[39:0], datout};
+            #40
+            rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #50;
+        end
+        tsdown = evbytes[15:0];
+        if (evbytes[23:16] === 8'h61)
+            $display("PASS: TIF button press event check");
+        else
+            $display("FAIL: TIF button press event check");
+
+        //  - Release the button about 1.5 ms after the press
+        #1000000
+        btn = 1;
+        #500000
+        rdwr = 0; strobe = 0; our_addr = 4'h2; addr = 12'h200;
+        busy_in = 0; addr_match_in = 0; datin = 8'h00;
+        #50
+        if (datout === 8'h03)
+            $display("PASS: TIF button release poll check");
+        else
+            $display("FAIL: TIF button release poll check");
+        for (k = 0; k < 3; k = k + 1)
+        begin
+            rdwr = 1; strobe = 1; our_addr = 4'h2; addr = 12'h200 + k;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #10
+            evbytes = {evbytes[39:0], datout};
+            #40
+            rdwr = 1; strobe = 0; our_addr = 4'h2; addr = 12'h000;
+            busy_in = 0; addr_match_in = 0; datin = 8'h00;
+            #50;
+        end
+        if (evbytes[23:16] === 8'h60)
+            $display("PASS: TIF button release event check");
+        else
+            $display("FAIL: TIF button release event check");
+        //  - The timestamps are in milliseconds
+        if (((evbytes[15:0] - tsdown) === 16'd1) || ((evbytes[15:0] - tsdown) === 16'd2))
+            $display("PASS: TIF event timestamp check");
+        else
+            $display("FAIL: TIF event timestamp check");
+
         $finish;
     end
 endmodule
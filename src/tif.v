@@ -43,6 +43,30 @@
 //      Reg 3:  Bits 0-2: LED control 
 //              Bits 4:   Contrast control (has minimal effect)
 //      Reg 4:  Bits 0-5: Character FIFO for the text display
+//      Reg 5:  Framebuffer pointer.  Bits 6-5: row, bits 4-0: column.
+//              Columns 20 to 31 are not stored.  Writes there are
+//              ignored and reads give a space.
+//      Reg 6:  Framebuffer data.  Reads and writes access the character
+//              at the pointer and then move the pointer to the next
+//              column, wrapping to the start of the next row.
+//      Reg 7:  Write a 1 to bit 0 to redraw the whole display
+//      Reg 8:  Event mode.  If bit 0 is set keypad, rotary, and button
+//              changes are queued with a timestamp instead of sending
+//              registers 0 and 1.
+//      Reg 9:  Key repeat delay in units of 10ms.  Zero turns repeat off.
+//      Reg 10: Key repeat interval in units of 10ms.
+//
+//  In event mode each keypad, rotary, or button change is put into a
+//  15 entry FIFO.  Each entry is three bytes.  Bit 7 of the first byte
+//  is set if events were lost to a full FIFO before this one.  Bits 6-5
+//  are the event type and bits 4-0 the event data:
+//      0: key down, data is the scancode.  A held key repeats this
+//         event after the repeat delay and then at the repeat interval.
+//      1: key up, data is the scancode of the released key
+//      2: rotary step, data is +1 (0x01) or -1 (0x1f)
+//      3: button, bit 0 is set on a press and clear on a release
+//  The next two bytes are a millisecond timestamp, high byte first.
+//  See evfifo.v for how the entries are sent to the host.
 //
 //
 //  HOW THIS WORKS
@@ -57,6 +81,20 @@
 //  with keypad scanning.  Of the 8 input lines, 5 are used by the keypad
 //  and 3 by the rotary encoder.
 //
+//      The framebuffer holds the four rows of twenty characters of the
+//  display.  The refresh engine compares each cell with a shadow copy of
+//  what it last sent to the display and sends only the cells that differ,
+//  setting the display address first if the cursor is not already at
+//  the cell.  The host writes characters at a row and column and never
+//  needs to track the cursor or re-send unchanged text.  Characters in
+//  the FIFO go out before the framebuffer and may move the cursor, so the
+//  engine sets the address again after any FIFO character.  The FIFO is
+//  still used for display commands such as initialization.  A 2x16
+//  display uses the upper left part of the framebuffer.
+//      The framebuffer and shadow hold only the 80 cells of the display.
+//  Both are single port distributed RAMs.  A host access to Reg 6 uses
+//  the framebuffer for that clock and the refresh engine waits.
+//
 //      
 //  The cabling from the Baseboard to the tif has ringing on
 //  all of the lines at any transition.  To overcome this we
@@ -147,6 +185,38 @@ module tif(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     tifsr16 fifo08(dout[08],faddr,fsclk,datin[04]);    // SR
     reg    [3:0] depth;      // Depth of FIFO usage.  
     reg    [1:0] xferst;     // FIFO to display transfer state
+    wire   [8:0] lcdout;     // RS and data to the display
+    wire   lcdbusy;          // ==1 if sending a FIFO or framebuffer character
+
+    // Framebuffer and refresh engine
+    reg    [7:0] fb[79:0];   // Characters as row*20 + column
+    reg    [7:0] shadow[79:0]; // Characters as last sent to the display
+    reg    [6:0] fbptr;      // Host pointer into the framebuffer as {row,col}
+    reg    [6:0] fbscan;     // Refresh engine pointer into the framebuffer
+    wire   fbhost;           // ==1 on a host access to the framebuffer data
+    wire   [6:0] fbcell;     // Framebuffer cell of this clock's access
+    wire   [7:0] fbdata;     // Framebuffer character at fbcell
+    wire   [6:0] fbnext;     // Cell after fbscan
+    wire   [6:0] ddaddr;     // Display address of the fbscan cell
+    reg    [6:0] lcdaddr;    // Display cursor address
+    reg    curvalid;         // ==1 if lcdaddr matches the display cursor
+    reg    fball;            // ==1 to redraw every cell in this pass
+    reg    fbsend;           // ==1 while sending fbchar to the display
+    reg    [8:0] fbchar;     // RS and data of the framebuffer transfer
+
+    // Input event FIFO
+    reg    evmode;           // ==1 to queue input events
+    reg    [9:0] uspre;      // prescale u1clk to milliseconds
+    reg    [15:0] msec;      // millisecond timebase for the timestamps
+    reg    evq;              // ==1 to queue evcode on the next clock
+    reg    [6:0] evcode;     // type and data of the event to queue
+    reg    [7:0] repdelay;   // key repeat delay in 10ms units, 0 is off
+    reg    [7:0] reprate;    // key repeat interval in 10ms units
+    reg    [7:0] repcnt;     // 10ms ticks to the next repeat
+    reg    reppend;          // ==1 if a key repeat event is waiting
+    wire   evlost;           // ==1 if events were lost to a full FIFO
+    wire   evsel;            // ==1 on a poll or read of the event autosend
+    wire   [7:0] evdatout;   // event autosend data to the host
 
     // Addressing and bus interface lines 
     wire   myaddr;           // ==1 if a correct read/write on our address
@@ -170,14 +240,89 @@ module tif(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
         oldB = 0;
         quad = 0;
         contrast = 0;
+        fbptr = 0;
+        fbscan = 0;
+        lcdaddr = 0;
+        curvalid = 0;
+        fball = 0;
+        fbsend = 0;
+        evmode = 0;
+        uspre = 0;
+        msec = 0;
+        evq = 0;
+        repdelay = 0;
+        reprate = 0;
+        repcnt = 0;
+        reppend = 0;
     end
 
     always @(posedge clk)
     begin
         sample <= pin8;
 
+        // Refresh engine.  Send the next changed framebuffer cell when
+        // the FIFO is empty and the keypad is not being scanned.
+        if (~fbsend && (depth == 0) && ~doscan && ~m10clk && ~fbhost)
+        begin
+            if ((fbdata != shadow[fbcell]) || fball)
+            begin
+                fbsend <= 1;
+                if (curvalid && (lcdaddr == ddaddr))
+                begin
+                    fbchar <= {1'b1, fbdata};        // RS=1 for data
+                    shadow[fbcell] <= fbdata;
+                    lcdaddr <= lcdaddr + 7'h01;
+                    fbscan <= fbnext;
+                    if (fbscan == 7'h73)             // last cell
+                        fball <= 0;
+                end
+                else
+                begin
+                    fbchar <= {2'b01, ddaddr};       // Set DDRAM address
+                    lcdaddr <= ddaddr;
+                    curvalid <= 1;
+                end
+            end
+            else
+                fbscan <= fbnext;
+        end
+
+        // Millisecond timestamps.  The event from the last clock or a
+        // pending key repeat goes into the event FIFO.
+        if (u1clk)
+        begin
+            uspre <= (uspre == 10'd999) ? 10'h000 : uspre + 10'h001;
+            if (uspre == 10'd999)
+                msec <= msec + 16'h0001;
+        end
+        if (~evq)
+            reppend <= 0;    // the repeat is queued now
+        evq <= 0;
+
+        // Repeat a held key after the delay and then at the interval
+        if ((scancode == 0) || (repdelay == 0) || ~evmode)
+        begin
+            repcnt <= repdelay;
+            reppend <= 0;
+        end
+        else if (m10clk && (repcnt <= 1))
+        begin
+            repcnt <= (reprate == 0) ? 8'h01 : reprate;
+            reppend <= 1;
+        end
+        else if (m10clk)
+            repcnt <= repcnt - 8'h01;
+
+        // Event mode and key repeat configuration
+        if (strobe && myaddr && ~rdwr && (addr[3:0] == 8))
+            evmode <= datin[0];
+        if (strobe && myaddr && ~rdwr && (addr[3:0] == 9))
+            repdelay <= datin;
+        if (strobe && myaddr && ~rdwr && (addr[3:0] == 10))
+            reprate <= datin;
+
         // reading reg 1 clears the dataready flag
-        if (strobe && rdwr && myaddr && (addr[2:0] == 1))
+        if (strobe && rdwr && myaddr && ~evsel && (addr[3:0] == 1))
         begin
             dataready <= 0;
             datatohost <= 0;
@@ -185,7 +330,7 @@ module tif(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
         end
 
         // Address x010 is for the piezo
-        else if (strobe && ~rdwr && myaddr && (addr[2:0] == 2)) // addr=010
+        else if (strobe && ~rdwr && myaddr && (addr[3:0] == 2)) // addr=010
         begin
             duration <= datin[4:0];
             tone     <= datin[6:5];
@@ -194,14 +339,14 @@ module tif(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
         end
 
         // Address x011 is for the LED control
-        else if (strobe && ~rdwr && myaddr && (addr[2:0] == 3)) // addr=011
+        else if (strobe && ~rdwr && myaddr && (addr[3:0] == 3)) // addr=011
         begin
             ledctrl  <= datin[2:0];
             contrast <= datin[4];
         end
 
         // Add char to the FIFO queue if queue is not full
-        else if (strobe && myaddr && ~rdwr && (addr[2:0] == 4))
+        else if (strobe && myaddr && ~rdwr && (addr[3:0] == 4))
         begin
             // The low nibble of the character has the MSB set.  We
             // latch the low nibble then get the high nibble and R/S
@@ -209,6 +354,7 @@ module tif(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
             // of data on the USB bus but we're kind of stuck with 
             // that since we need 9 bits per character.
             chartmp <= datin[3:0];
+            curvalid <= 0;   // FIFO characters may move the cursor
 
             // FIFO shift clock is strobed now if not full (on MSB == 0)
             if ((depth != 15) && (datin[7] == 1))
@@ -218,11 +364,25 @@ module tif(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
             end
         end
 
+        // Framebuffer pointer, data, and redraw
+        if (strobe && myaddr && ~rdwr && (addr[3:0] == 5))
+            fbptr <= datin[6:0];
+        if (fbhost && ~rdwr && (fbptr[4:0] < 20))
+            fb[fbcell] <= datin;
+        if (fbhost)
+            fbptr <= (fbptr[4:0] == 19) ? {fbptr[6:5] + 2'h1, 5'h00} :
+                                          fbptr + 7'h01;
+        if (strobe && myaddr && ~rdwr && (addr[3:0] == 7) && datin[0])
+        begin
+            fball <= 1;
+            fbscan <= 0;
+        end
+
         // else if host is not rd/wr our regs 
         // Is it time for a keypad scan?
         if (m10clk == 1)
         begin
-            if (depth == 0)
+            if ((depth == 0) && ~fbsend)
                 doscan <= 1;
             // Tell system to send keypad/quadrature if data is ready
             if (dataready)
@@ -237,7 +397,7 @@ module tif(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
 
             // Run state machine for shifting data to/from the 595/165
             // if there are LCD chars to send or if in a keypad scan
-            if ((depth != 0) || (doscan == 1) || (duration != 0))
+            if (lcdbusy || (doscan == 1) || (duration != 0))
             begin
                 if (gst <= 9)
                 begin
@@ -266,11 +426,15 @@ module tif(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                             begin
                                 scancode <= { (scanline[1:0] - 2'h2), ~(bst[2:0]) } ;
                                 dataready <= 1;                // send to host
+                                evq <= 1;
+                                evcode <= { 2'b00, (scanline[1:0] - 2'h2), ~(bst[2:0]) };
                             end
                             else if ((scancode == { (scanline[1:0] - 2'h2), ~(bst[2:0]) }) && (sample == 1))
                             begin  // on row/col of previous close but now it's open
                                 scancode <= 5'h00;
                                 dataready <= 1;                // send to host
+                                evq <= 1;
+                                evcode <= { 2'b01, scancode };
                             end
                         end
 
@@ -296,6 +460,8 @@ module tif(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                                 oldA <= newA;
                                 oldB <= sample;
                                 dataready <= 1;
+                                evq <= 1;
+                                evcode <= 7'h41;
                             end
                             else if (((oldA != newA) && (~(oldA ^ oldB))) ||
                                 ((oldB != sample) && (oldA ^ oldB)))
@@ -304,6 +470,8 @@ module tif(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                                 oldA <= newA;
                                 oldB <= sample;
                                 dataready <= 1;
+                                evq <= 1;
+                                evcode <= 7'h5f;
                             end
                         end
                         else if ((bst[2:0] == 7) && (dataready == 0) && (button != sample))
@@ -311,6 +479,8 @@ module tif(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                             // There is a new state for the rotary encoder button.
                             button <= sample;
                             dataready <= 1;
+                            evq <= 1;
+                            evcode <= { 6'h30, ~sample };
                         end
                     end
                 end
@@ -344,12 +514,16 @@ module tif(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                         // the E line and decrement the FIFO depth.
                         // (no need to worry about the FIFO address -- it is
                         // tied to FIFO depth)
-                        if (depth != 0)
+                        // The framebuffer character goes first if started.
+                        if (lcdbusy)
                         begin
                             xferst <= xferst + 2'h1;
                             if (xferst == 3)
                             begin
-                                depth <= depth - 4'h1;
+                                if (fbsend)
+                                    fbsend <= 0;
+                                else
+                                    depth <= depth - 4'h1;
                             end
                         end
 
@@ -367,6 +541,13 @@ module tif(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                 end
             end
         end
+
+        // Events replace the register autosend in event mode
+        if (evmode)
+        begin
+            dataready <= 0;
+            datatohost <= 0;
+        end
     end
 
     // Select the keypad column to scan (active low)
@@ -380,26 +561,50 @@ module tif(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     // Map the output of the various sub-peripherals to
     // output pins on the two 74595s.
     assign sendbit = 
-        (bst ==  0) ? dout[5] :          // Data 5 (pin 12) on the display
-        (bst ==  1) ? ((depth == 0) ? scancol[1] : dout[2] ) :  // keypad column 1
-        (bst ==  2) ? ((depth == 0) ? scancol[0] : dout[3] ) :  // keypad column 0
-        (bst ==  3) ? ((depth == 0) ? scancol[3] : dout[1] ) :  // keypad column 3
-        (bst ==  4) ? ((depth == 0) ? scancol[2] : dout[0] ) :  // keypad column 2
+        (bst ==  0) ? lcdout[5] :        // Data 5 (pin 12) on the display
+        (bst ==  1) ? ((~lcdbusy) ? scancol[1] : lcdout[2] ) :  // keypad column 1
+        (bst ==  2) ? ((~lcdbusy) ? scancol[0] : lcdout[3] ) :  // keypad column 0
+        (bst ==  3) ? ((~lcdbusy) ? scancol[3] : lcdout[1] ) :  // keypad column 3
+        (bst ==  4) ? ((~lcdbusy) ? scancol[2] : lcdout[0] ) :  // keypad column 2
         (bst ==  5) ? ((xferst == 3'h2) ? 1'b0 : 1'b1) : // E on the display
-        (bst ==  6) ? dout[8] :         // RS on the display
+        (bst ==  6) ? lcdout[8] :       // RS on the display
         (bst ==  7) ? contrast :
         (bst ==  8) ? ~ledctrl[2] :     // User LED2
         (bst ==  9) ? ~ledctrl[1] :     // User LED1
         (bst == 10) ? ((duration != 0) ? piezo : 1'b0) :           // piezo output
         (bst == 11) ? (((duration != 0) && (volumn == 1)) ? ~piezo : 1'b0) :// high volume
         (bst == 12) ? ~ledctrl[0] :     // LED backlight on the display
-        (bst == 13) ? dout[6] :         // Data 6 (pin 13) on the display
-        (bst == 14) ? dout[7] :         // Data 7 (pin 14) on the display
-                      dout[4] ;         // Data 4 (pin 11) on the display
+        (bst == 13) ? lcdout[6] :       // Data 6 (pin 13) on the display
+        (bst == 14) ? lcdout[7] :       // Data 7 (pin 14) on the display
+                      lcdout[4] ;       // Data 4 (pin 11) on the display
+
+    // The display shows the framebuffer character while one is in progress
+    assign lcdbusy = (depth != 0) || fbsend;
+    assign lcdout = (fbsend) ? fbchar : dout;
+
+    // Next cell in the framebuffer and the display address of a cell.
+    // Rows start at display addresses 0x00, 0x40, 0x14, and 0x54.
+    assign fbnext = (fbscan[4:0] == 19) ? {fbscan[6:5] + 2'h1, 5'h00} :
+                                          fbscan + 7'h01;
+    assign ddaddr = (fbscan[6:5] == 0) ? {2'b00, fbscan[4:0]} :
+                    (fbscan[6:5] == 1) ? (7'h40 + {2'b00, fbscan[4:0]}) :
+                    (fbscan[6:5] == 2) ? (7'h14 + {2'b00, fbscan[4:0]}) :
+                                         (7'h54 + {2'b00, fbscan[4:0]});
+
+    // The host and the refresh engine share one framebuffer port.  A
+    // {row,col} pointer is cell row*20 + col.
+    assign fbhost = strobe && myaddr && ~evsel && (addr[3:0] == 6);
+    assign fbcell = rowcol((fbhost) ? fbptr : fbscan);
+    assign fbdata = fb[fbcell];
+
+    function [6:0] rowcol;
+        input [6:0] rc;
+        rowcol = {rc[6:5], 4'h0} + {2'h0, rc[6:5], 2'h0} + {2'h0, rc[4:0]};
+    endfunction
 
 
     // Route FIFO lines
-    assign fsclk = (~clk & strobe & myaddr & ~rdwr & (addr[2:0] == 4)
+    assign fsclk = (~clk & strobe & myaddr & ~rdwr & (addr[3:0] == 4)
                    & (datin[7] == 1) & (depth != 15));
     // Zero indexed addresses.  Look at output of cell addr=0 when the depth is 1.
     assign faddr = depth - 4'h1;
@@ -411,13 +616,24 @@ module tif(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     assign pin6 = ((gst == 2) || (gst == 5) || (gst == 6) || (gst == 7)
                 || (gst == 8) || (gst == 9));
 
-    assign myaddr = (addr[11:8] == our_addr) && (addr[7:3] == 0);
+    // The event FIFO and its autosend
+    evfifo tifev(clk,rdwr,strobe,our_addr,addr,evmode,(evmode && (evq || reppend)),
+            {evlost, ((evq) ? evcode : {2'b00, scancode}), msec},
+            evlost,evsel,evdatout);
+
+    assign myaddr = (addr[11:8] == our_addr) && ((addr[7:4] == 0) || evsel);
     assign datout = (~myaddr) ? datin :
+                    (evsel) ? evdatout :           // send the queued events
                     (~strobe && myaddr && (datatohost)) ? 8'h02 :  // send up 2 bytes when ready
-                    (strobe && (addr[2:0] == 0)) ?  { ~button, 2'b00, scancode } :
-                    (strobe && (addr[2:0] == 1)) ?  {  2'h0, quad } :
-                    (strobe && (addr[2:0] == 2)) ?  { volumn, tone, duration } :
-                    (strobe && (addr[2:0] == 3)) ?  { 5'b0000, ledctrl } :
+                    (strobe && (addr[3:0] == 0)) ?  { ~button, 2'b00, scancode } :
+                    (strobe && (addr[3:0] == 1)) ?  {  2'h0, quad } :
+                    (strobe && (addr[3:0] == 2)) ?  { volumn, tone, duration } :
+                    (strobe && (addr[3:0] == 3)) ?  { 5'b0000, ledctrl } :
+                    (strobe && (addr[3:0] == 5)) ?  { 1'b0, fbptr } :
+                    (strobe && (addr[3:0] == 6)) ?  ((fbptr[4:0] < 20) ? fbdata : 8'h20) :
+                    (strobe && (addr[3:0] == 8)) ?  { 7'h00, evmode } :
+                    (strobe && (addr[3:0] == 9)) ?  repdelay :
+                    (strobe && (addr[3:0] == 10)) ? reprate :
                     8'h00 ; 
 
     // Loop in-to-out where appropriate
@@ -426,8 +642,9 @@ module tif(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     // We tell the host the FIFO is full by refusing to accept
     // characters, which we do my refusing to recognize our own address
     assign addr_match_out = addr_match_in |
-                            (myaddr && (addr[2:0] != 4)) |
-                            (myaddr && (addr[2:0] == 4) && (depth != 15));
+                            (myaddr && (addr[3:0] != 4)) |
+                            (myaddr && (addr[3:0] == 4) && (depth != 15)) |
+                            (myaddr && evsel);
     //assign addr_match_out = myaddr | addr_match_in;
 
 endmodule
@@ -35,6 +35,17 @@
 //      Reg 0:  read-only, low byte of 12 bit timer
 //      Reg 1:  read-only, sensor ID and upper 4 bits of timer
 //      Reg 2:  enable register
+//      Reg 3:  echo timeout in units of 160 us.  A ping that has not
+//              ended by this time is reported with the timeout value.
+//              Zero, the default, uses the full 40 ms.
+//      Reg 4:  ping holdoff in milliseconds.  If non-zero the next
+//              ping starts this long after the previous reading is
+//              sent instead of on the fixed 60 ms schedule.
+//      Reg 5:  median filter length.  3 or 5 reports the median of
+//              the last 3 or 5 readings of each sensor.  The default
+//              of 0 (or 1) reports every raw reading.  A write clears
+//              the history of every sensor and drops a reading that is
+//              being filtered.
 //
 //
 //  HOW THIS WORKS
@@ -47,7 +58,10 @@
 //  the pulse width of the echo reply and do an auto-send of
 //  that time up to the host.  To avoid multiple echoes we
 //  ping only one sensor at a time and we do the pings at 60
-//  millisecond intervals.
+//  millisecond intervals.  With a holdoff and echo timeout set the
+//  next ping starts as soon as the sensor is ready, which makes a
+//  sweep of the sensors several times faster.  The median filter
+//  drops single spurious echoes before they reach the host.
 //      The 'snst' variable keeps track of the state machine for
 //  reading the sensors.  The algorithm looks something like this:
 //           EVERY 60 milliseconds
@@ -73,6 +87,8 @@
 //              then increment snid, go to state 5
 //     5    Ready to start next reading.  Find the next enabled sensor.
 //              then go to snst==0
+//     6    Put the reading in the sensor's history and find the
+//              median, then report it and go to state 4
 //
 //
 //
@@ -142,6 +158,29 @@ module us8(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     reg    [11:0] timr;      // timer/counter for 12.8 us and echo times
     reg    gotecho;          // ==1 when and echo is found
     reg    [7:0] enbl;      // Bit is set for enabled sensors
+    reg    [7:0] echotmo;    // echo timeout in 160 us units, 0 for 40 ms
+    wire   tmo;              // ==1 if timr is at the echo timeout
+    reg    [7:0] holdoff;    // ms from a report to the next ping, 0 for 60 ms
+    reg    [6:0] mspre;      // prescale u10clk to milliseconds
+    reg    [7:0] hocnt;      // milliseconds since the last report
+    reg    [11:0] outval;    // the reading sent to the host
+
+    // Median filter
+    reg    [2:0] medlen;     // number of readings in the median
+    reg    [11:0] hist[63:0];   // last readings as {snid, index}
+    reg    [2:0] hidx[7:0];  // next history index for each sensor
+    reg    [2:0] hcnt[7:0];  // readings in the history of each sensor
+    reg    [2:0] fst;        // median filter state
+    reg    [2:0] mi;         // candidate reading in the median search
+    reg    [2:0] mj;         // reading compared to the candidate
+    reg    [2:0] nlt;        // readings less than the candidate
+    reg    [2:0] nle;        // readings less than or equal to the candidate
+    wire   [2:0] mcnt;       // readings to take the median of
+    wire   [11:0] vi;        // candidate reading
+    wire   [11:0] vj;        // reading compared to the candidate
+    wire   [2:0] nlt1;       // nlt including this compare
+    wire   [2:0] nle1;       // nle including this compare
+    integer j;               // loop counter
 
 
     initial
@@ -154,21 +193,67 @@ module us8(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
         dataready = 0;
         timr = 0;
         enbl = 0;
+        echotmo = 0;
+        holdoff = 0;
+        mspre = 0;
+        hocnt = 0;
+        outval = 0;
+        medlen = 0;
+        fst = 0;
+        for (j = 0; j < 8; j = j + 1)
+        begin
+            hidx[j] = 0;
+            hcnt[j] = 0;
+        end
     end
 
     always @(posedge clk)
     begin
         sample <= pin8;
 
+        // Count milliseconds since the last report
+        if (u10clk == 1)
+        begin
+            mspre <= (mspre == 7'd99) ? 7'h00 : mspre + 7'h01;
+            if ((mspre == 7'd99) && (hocnt != 8'hff))
+                hocnt <= hocnt + 8'h01;
+        end
+
         // read of high byte clears the dataready flag
-        if (strobe && rdwr && myaddr && (addr[1:0] == 1))
+        if (strobe && rdwr && myaddr && (addr[2:0] == 1))
         begin
             dataready <= 0;
         end
-        else if (strobe && myaddr && ~rdwr && (addr[1:0] == 2))  // latch data on a write
+        else if (strobe && myaddr && ~rdwr && (addr[2:0] == 2))  // latch data on a write
         begin
             enbl[7:0] <= datin[7:0];
         end
+        else if (strobe && myaddr && ~rdwr && (addr[2:0] == 3))
+        begin
+            echotmo <= datin;
+        end
+        else if (strobe && myaddr && ~rdwr && (addr[2:0] == 4))
+        begin
+            holdoff <= datin;
+        end
+        else if (strobe && myaddr && ~rdwr && (addr[2:0] == 5))
+        begin
+            // A new filter length starts every history over
+            medlen <= datin[2:0];
+            for (j = 0; j < 8; j = j + 1)
+            begin
+                hidx[j] <= 0;
+                hcnt[j] <= 0;
+            end
+            // Drop a median search in progress.  The history it was
+            // reading is gone.
+            if ((snst == 6) && (fst != 0))
+            begin
+                fst <= 0;
+                hocnt <= 0;
+                snst <= 4;
+            end
+        end
 
         // else if host is not reading our regs
         else
@@ -177,12 +262,64 @@ module us8(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
             if (m10clk == 1)
                 mscntr <= (mscntr == 0) ? 3'h5 : (mscntr - 3'h1);
 
+            // SNST==6  Add the reading to the history and find the median.
+            // The median is the reading with fewer than half of the others
+            // below it and at least half at or below it.
+            if (snst == 6)
+            begin
+                if (fst == 0)
+                begin
+                    if ((medlen == 3) || (medlen == 5))
+                    begin
+                        hist[{snid, hidx[snid]}] <= timr;
+                        hidx[snid] <= (hidx[snid] == medlen - 3'h1) ? 3'h0 : hidx[snid] + 3'h1;
+                        if (hcnt[snid] != medlen)
+                            hcnt[snid] <= hcnt[snid] + 3'h1;
+                        mi <= 0;
+                        mj <= 0;
+                        nlt <= 0;
+                        nle <= 0;
+                        fst <= 1;
+                    end
+                    else
+                    begin
+                        outval <= timr;
+                        dataready <= 1;
+                        hocnt <= 0;
+                        snst <= 4;
+                    end
+                end
+                else if (mj != mcnt - 3'h1)
+                begin
+                    mj <= mj + 3'h1;
+                    nlt <= nlt1;
+                    nle <= nle1;
+                end
+                else if (((nlt1 <= ((mcnt - 3'h1) >> 1)) && (nle1 > ((mcnt - 3'h1) >> 1))) ||
+                         (mi == mcnt - 3'h1))
+                begin
+                    outval <= vi;
+                    dataready <= 1;
+                    hocnt <= 0;
+                    fst <= 0;
+                    snst <= 4;
+                end
+                else
+                begin
+                    mi <= mi + 3'h1;
+                    mj <= 0;
+                    nlt <= 0;
+                    nle <= 0;
+                end
+            end
+
             if (u10clk == 1)
             begin
-                //  SNST==0, wait for 60 ms edge
+                //  SNST==0, wait for 60 ms edge or the end of the holdoff
                 if (snst == 0)
                 begin
-                     if (mscntr == 0)
+                     if (((holdoff == 0) && (mscntr == 0)) ||
+                         ((holdoff != 0) && (hocnt >= holdoff)))
                      begin
                         // clear timer, go to snst state 1
                         timr <= 0;
@@ -207,12 +344,11 @@ module us8(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                         timr <= 0;
                         snst <= 3;
                     end
-                    else if (timr == 12'hfff)
+                    else if (tmo)
                     begin
                         // No high pulse.  Missing sensor?
-                        dataready <= 1;   // report a zero to host
-                        timr <= 0;
-                        snst <= 4;        // go find next snid
+                        timr <= 0;        // report a zero to host
+                        snst <= 6;        // filter, then find next snid
                     end
                     else
                         timr <= timr + 12'h001;
@@ -220,10 +356,9 @@ module us8(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                 // SNST==3 wait for line to go low or for 40 ms
                 else if (snst == 3)
                 begin
-                    if ((~gotecho) | (timr == 12'hfff))
+                    if ((~gotecho) | tmo)
                     begin
-                        dataready <= 1;
-                        snst <= 4;
+                        snst <= 6;
                     end
                     else
                         timr <= timr + 12'h001;
@@ -231,7 +366,7 @@ module us8(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
                 // SNST==4    Wait for mscntr to not be zero and for dataready to be zero
                 else if (snst == 4)
                 begin
-                    if ((mscntr != 0) && ~dataready)
+                    if (((mscntr != 0) || (holdoff != 0)) && ~dataready)
                     begin
                         snid <= snid + 3'h1;
                         snst <= 5;
@@ -284,12 +419,24 @@ module us8(clk,rdwr,strobe,our_addr,addr,busy_in,busy_out,
     assign pin4 = (gst == 7);
     assign pin6 = (gst == 2) || (gst == 5) || (gst == 6) || (gst == 7) || (gst == 8);
 
-    assign myaddr = (addr[11:8] == our_addr) && (addr[7:2] == 0);
+    // Echo timeout and median search
+    assign tmo = (timr == 12'hfff) ||
+                 ((echotmo != 0) && (timr[11:4] >= echotmo));
+    assign mcnt = hcnt[snid];
+    assign vi = hist[{snid, mi}];
+    assign vj = hist[{snid, mj}];
+    assign nlt1 = nlt + ((vj < vi) ? 3'h1 : 3'h0);
+    assign nle1 = nle + ((vj <= vi) ? 3'h1 : 3'h0);
+
+    assign myaddr = (addr[11:8] == our_addr) && (addr[7:3] == 0);
     assign datout = (~myaddr) ? datin :
                     (~strobe && (dataready)) ? 8'h03 :
-                    (strobe && (addr[1:0] == 0)) ? timr[7:0] : 
-                    (strobe && (addr[1:0] == 1)) ? {1'b0,snid,timr[11:8]} :
-                    (strobe && (addr[1:0] == 2)) ? enbl[7:0] :
+                    (strobe && (addr[2:0] == 0)) ? outval[7:0] : 
+                    (strobe && (addr[2:0] == 1)) ? {1'b0,snid,outval[11:8]} :
+                    (strobe && (addr[2:0] == 2)) ? enbl[7:0] :
+                    (strobe && (addr[2:0] == 3)) ? echotmo :
+                    (strobe && (addr[2:0] == 4)) ? holdoff :
+                    (strobe && (addr[2:0] == 5)) ? {5'h00,medlen} :
                     8'h00 ; 
 
     // Loop in-to-out where appropriate